@@ -0,0 +1,363 @@
+/**
+* \file CompactOcTree.h
+* \author Weckyy702 (weckyy702@gmail.com)
+* \brief Header file for CompactOcTree class
+* \date 2023-02-14
+*
+* MIT License
+* Copyright (c) [2023] [Weckyy702 (weckyy702@gmail.com | https://github.com/Weckyy702)]
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+#ifndef RAYCHELCORE_COMPACT_OCTTREE_H
+#define RAYCHELCORE_COMPACT_OCTTREE_H
+
+#include "RaychelCore/OctTree.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace Raychel {
+
+    /**
+    * \brief Read-only snapshot of an OcTree with quantized node bounds
+    *
+    * Every node stores the bounds of its contents relative to the bounds of its parent, quantized to Quantized.
+    * Quantized bounds are always rounded outwards, so queries return exactly the same results as the OcTree they were built from.
+    * Empty nodes are not stored and the children of a node are stored next to each other.
+    *
+    * \tparam Tree OcTree this snapshot is built from
+    * \tparam Quantized unsigned integer type used to store the node bounds. Must be 8 or 16 bits wide
+    *
+    * Elements, nodes and leaf entries are indexed with 32 bits. The constructor throws std::length_error if there are
+    * more of any of them.
+    */
+    template <typename Tree, typename Quantized = std::uint8_t>
+    class CompactOcTree
+    {
+        static_assert(
+            std::unsigned_integral<Quantized> && sizeof(Quantized) <= sizeof(std::uint16_t),
+            "CompactOcTree can only quantize to 8 or 16 bits!");
+
+        using T = typename Tree::ValueType;
+        using Coordinate = typename Tree::CoordinateType;
+        using GetDistance = typename Tree::DistanceFunction;
+        using BoundingBox = BasicBoundingBox<Coordinate>;
+        using Number = details::ElementType<Coordinate>;
+        using TreeNode = typename Tree::Node;
+
+        template <typename Ref, typename Dist>
+        using ClosestItem = typename Tree::template ClosestItem<Ref, Dist>;
+
+        static constexpr auto max_quantized = std::numeric_limits<Quantized>::max();
+        static constexpr std::size_t max_index = std::numeric_limits<std::uint32_t>::max();
+
+        struct Node
+        {
+            //min x, y, z followed by max x, y, z
+            std::array<Quantized, 6> bounds;
+            bool is_leaf;
+            //For leaves, these index entries_. For inner nodes, they index nodes_
+            std::uint32_t first;
+            std::uint32_t count;
+        };
+
+    public:
+        //Throws std::length_error if the tree has more elements, nodes or leaf entries than 32 bit indices can address
+        explicit CompactOcTree(const Tree& tree) : elements_(tree.elements().begin(), tree.elements().end())
+        {
+            _check_index_count(elements_.size());
+
+            const auto& root = tree._root();
+            if (root.size() == 0U)
+                return;
+
+            std::vector<std::optional<BoundingBox>> content_bounds{};
+            _collect_content_bounds(root, content_bounds);
+
+            //Empty leaves do not contribute to the content bounds
+            if (!content_bounds.front().has_value())
+                return;
+
+            root_bounds_ = content_bounds.front();
+
+            nodes_.emplace_back();
+            std::size_t cursor{};
+            _emit(root, cursor, 0U, *root_bounds_, content_bounds);
+        }
+
+        [[nodiscard]] std::size_t size() const noexcept
+        {
+            return elements_.size();
+        }
+
+        [[nodiscard]] std::size_t node_count() const noexcept
+        {
+            return nodes_.size();
+        }
+
+        [[nodiscard]] const auto& elements() const noexcept
+        {
+            return elements_;
+        }
+
+        [[nodiscard]] auto closest_to(const Coordinate& where) const noexcept
+            -> std::optional<ClosestItem<const T&, details::ElementType<Coordinate>>>
+        {
+            if (nodes_.empty()) [[unlikely]]
+                return std::nullopt;
+
+            std::optional<details::ClosestItem<Coordinate>> closest_item{};
+
+            _find_closest(0U, *root_bounds_, where, closest_item);
+
+            if (!closest_item.has_value()) [[unlikely]]
+                return std::nullopt;
+
+            const auto [index, distance] = closest_item.value();
+
+            return ClosestItem<const T&, details::ElementType<Coordinate>>{elements_[index], distance};
+        }
+
+    private:
+        [[nodiscard]] static constexpr Number decode(Quantized value, Number min, Number max) noexcept
+        {
+            //The end points are returned exactly so that a child can always cover its whole parent
+            if (value == 0U)
+                return min;
+            if (value == max_quantized)
+                return max;
+            return min + (max - min) * static_cast<Number>(value) / static_cast<Number>(max_quantized);
+        }
+
+        [[nodiscard]] static Quantized encode_min(Number value, Number min, Number max) noexcept
+        {
+            if (!(max > min))
+                return 0U;
+
+            const auto scaled = std::floor((value - min) / (max - min) * static_cast<Number>(max_quantized));
+            auto result = static_cast<Quantized>(std::clamp(scaled, Number{}, static_cast<Number>(max_quantized)));
+
+            //Make sure that rounding errors in decode() never move the bound inwards
+            while (result != 0U && decode(result, min, max) > value) {
+                --result;
+            }
+            return result;
+        }
+
+        [[nodiscard]] static Quantized encode_max(Number value, Number min, Number max) noexcept
+        {
+            if (!(max > min))
+                return max_quantized;
+
+            const auto scaled = std::ceil((value - min) / (max - min) * static_cast<Number>(max_quantized));
+            auto result = static_cast<Quantized>(std::clamp(scaled, Number{}, static_cast<Number>(max_quantized)));
+
+            while (result != max_quantized && decode(result, min, max) < value) {
+                ++result;
+            }
+            return result;
+        }
+
+        [[nodiscard]] static BoundingBox decode_bounds(const Node& node, const BoundingBox& parent) noexcept
+        {
+            const auto& min = parent.bottom_front_left;
+            const auto& max = parent.top_back_right;
+
+            return BoundingBox{
+                Coordinate{
+                    decode(node.bounds[0], details::get_x(min), details::get_x(max)),
+                    decode(node.bounds[1], details::get_y(min), details::get_y(max)),
+                    decode(node.bounds[2], details::get_z(min), details::get_z(max)),
+                },
+                Coordinate{
+                    decode(node.bounds[3], details::get_x(min), details::get_x(max)),
+                    decode(node.bounds[4], details::get_y(min), details::get_y(max)),
+                    decode(node.bounds[5], details::get_z(min), details::get_z(max)),
+                },
+            };
+        }
+
+        [[nodiscard]] static std::array<Quantized, 6> encode_bounds(const BoundingBox& box, const BoundingBox& parent) noexcept
+        {
+            const auto& min = parent.bottom_front_left;
+            const auto& max = parent.top_back_right;
+
+            return {
+                encode_min(details::get_x(box.bottom_front_left), details::get_x(min), details::get_x(max)),
+                encode_min(details::get_y(box.bottom_front_left), details::get_y(min), details::get_y(max)),
+                encode_min(details::get_z(box.bottom_front_left), details::get_z(min), details::get_z(max)),
+                encode_max(details::get_x(box.top_back_right), details::get_x(min), details::get_x(max)),
+                encode_max(details::get_y(box.top_back_right), details::get_y(min), details::get_y(max)),
+                encode_max(details::get_z(box.top_back_right), details::get_z(min), details::get_z(max)),
+            };
+        }
+
+        [[nodiscard]] static BoundingBox merge(const std::optional<BoundingBox>& a, const BoundingBox& b) noexcept
+        {
+            if (!a.has_value())
+                return b;
+
+            return BoundingBox{
+                Coordinate{
+                    std::min(details::get_x(a->bottom_front_left), details::get_x(b.bottom_front_left)),
+                    std::min(details::get_y(a->bottom_front_left), details::get_y(b.bottom_front_left)),
+                    std::min(details::get_z(a->bottom_front_left), details::get_z(b.bottom_front_left)),
+                },
+                Coordinate{
+                    std::max(details::get_x(a->top_back_right), details::get_x(b.top_back_right)),
+                    std::max(details::get_y(a->top_back_right), details::get_y(b.top_back_right)),
+                    std::max(details::get_z(a->top_back_right), details::get_z(b.top_back_right)),
+                },
+            };
+        }
+
+        //Compute the bounds of the contents of every non-empty node in pre-order
+        static void _collect_content_bounds(const TreeNode& node, std::vector<std::optional<BoundingBox>>& content_bounds)
+        {
+            const auto id = content_bounds.size();
+            content_bounds.emplace_back();
+
+            std::optional<BoundingBox> bounds{};
+            if (!node.has_children()) {
+                const auto& indecies = node.indecies();
+                for (std::size_t i{}; i != indecies.size(); ++i) {
+                    bounds = merge(bounds, indecies.bounding_box_at(i));
+                }
+            } else {
+                for (const auto& child : node.children()) {
+                    if (child.size() == 0U)
+                        continue;
+
+                    const auto child_id = content_bounds.size();
+                    _collect_content_bounds(child, content_bounds);
+                    if (content_bounds[child_id].has_value())
+                        bounds = merge(bounds, *content_bounds[child_id]);
+                }
+            }
+
+            content_bounds[id] = bounds;
+        }
+
+        //Visits the nodes in the same order as _collect_content_bounds()
+        void _emit(
+            const TreeNode& node, std::size_t& cursor, std::size_t slot, const BoundingBox& parent_bounds,
+            const std::vector<std::optional<BoundingBox>>& content_bounds)
+        {
+            const auto& bounds = *content_bounds[cursor++];
+
+            nodes_[slot].bounds = encode_bounds(bounds, parent_bounds);
+            const auto decoded_bounds = decode_bounds(nodes_[slot], parent_bounds);
+
+            if (!node.has_children()) {
+                const auto& indecies = node.indecies();
+                //Element indices fit, the constructor checked the number of elements
+                _check_index_count(entries_.size() + indecies.size());
+
+                nodes_[slot].is_leaf = true;
+                nodes_[slot].first = static_cast<std::uint32_t>(entries_.size());
+                nodes_[slot].count = static_cast<std::uint32_t>(indecies.size());
+
+                for (const auto index : indecies) {
+                    entries_.push_back(static_cast<std::uint32_t>(index));
+                }
+                return;
+            }
+
+            std::size_t child_count{};
+            for (const auto& child : node.children()) {
+                if (child.size() != 0U)
+                    ++child_count;
+            }
+
+            const auto first_child = nodes_.size();
+            _check_index_count(first_child + child_count);
+
+            nodes_[slot].is_leaf = false;
+            nodes_[slot].first = static_cast<std::uint32_t>(first_child);
+            nodes_[slot].count = static_cast<std::uint32_t>(child_count);
+            nodes_.resize(first_child + child_count);
+
+            std::size_t child_slot{first_child};
+            for (const auto& child : node.children()) {
+                if (child.size() == 0U)
+                    continue;
+                _emit(child, cursor, child_slot++, decoded_bounds, content_bounds);
+            }
+        }
+
+        //first + count of every node must fit into 32 bits, too
+        static void _check_index_count(std::size_t count)
+        {
+            if (count > max_index)
+                throw std::length_error{"CompactOcTree: too many elements, nodes or entries for 32 bit indices"};
+        }
+
+        void _find_closest(
+            std::size_t node_index, const BoundingBox& bounds, const Coordinate& where,
+            std::optional<details::ClosestItem<Coordinate>>& maybe_closest_item) const noexcept
+        {
+            const auto& node = nodes_[node_index];
+
+            if (node.is_leaf) {
+                for (std::size_t i{node.first}; i != node.first + node.count; ++i) {
+                    const auto index = entries_[i];
+                    details::offer_closest(maybe_closest_item, index, _get_distance(elements_[index], where));
+                }
+                return;
+            }
+
+            std::array<std::pair<Number, std::size_t>, 8> candidates{};
+            std::array<std::optional<BoundingBox>, 8> child_bounds{};
+            for (std::size_t i{}; i != node.count; ++i) {
+                child_bounds[i] = decode_bounds(nodes_[node.first + i], bounds);
+                candidates[i] = {details::distance_squared_to_box(*child_bounds[i], where), i};
+            }
+            std::sort(
+                candidates.begin(),
+                candidates.begin() + static_cast<std::ptrdiff_t>(node.count),
+                [](const auto& a, const auto& b) { return a.first < b.first; });
+
+            for (std::size_t i{}; i != node.count; ++i) {
+                const auto [lower_bound_squared, child] = candidates[i];
+                if (maybe_closest_item.has_value() && details::is_farther_than(lower_bound_squared, maybe_closest_item->distance))
+                    break;
+                _find_closest(node.first + child, *child_bounds[child], where, maybe_closest_item);
+            }
+        }
+
+        std::vector<T> elements_{};
+        std::vector<Node> nodes_{};
+        std::vector<std::uint32_t> entries_{};
+        std::optional<BoundingBox> root_bounds_{};
+        GetDistance _get_distance{};
+    };
+
+} //namespace Raychel
+
+#endif //!RAYCHELCORE_COMPACT_OCTTREE_H
@@ -0,0 +1,460 @@
+/**
+* \file HugePageAllocator.h
+* \author Weckyy702 (weckyy702@gmail.com)
+* \brief Header file for HugePageAllocator class and NUMA topology helpers
+* \date 2023-02-24
+*
+* MIT License
+* Copyright (c) [2023] [Weckyy702 (weckyy702@gmail.com | https://github.com/Weckyy702)]
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+#ifndef RAYCHELCORE_HUGE_PAGE_ALLOCATOR_H
+#define RAYCHELCORE_HUGE_PAGE_ALLOCATOR_H
+
+#include "RaychelCore/compat.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if RAYCHEL_ACTIVE_OS == RAYCHEL_OS_LINUX
+    #include <linux/mempolicy.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+namespace Raychel {
+
+    enum class NumaPolicy {
+        //Pages are placed on the NUMA node of the thread that first touches them
+        local,
+        //Pages are spread round-robin over all NUMA nodes. If the kernel refuses, e.g. because it was built without NUMA
+        //support, they are placed like with local and numa_interleaving_failed() returns true
+        interleave,
+    };
+
+    enum class HugePageMode {
+        //Ask for transparent huge pages using madvise()
+        transparent,
+        //Use pages from the reserved huge page pool (MAP_HUGETLB). Falls back to transparent huge pages if there are none
+        reserved,
+    };
+
+    namespace details {
+
+        inline constexpr std::size_t huge_page_size = 2U * 1024U * 1024U;
+
+        //Parse a list like "0-3,8,10-11" as found in /sys/devices/system/node
+        [[nodiscard]] inline std::vector<std::size_t> parse_id_list(std::string_view list)
+        {
+            std::vector<std::size_t> ids{};
+
+            const auto parse_number = [&](std::size_t& value) {
+                const auto digits_end = std::min(list.find_first_not_of("0123456789"), list.size());
+                if (digits_end == 0U)
+                    return false;
+                value = std::stoul(std::string{list.substr(0U, digits_end)});
+                list.remove_prefix(digits_end);
+                return true;
+            };
+
+            while (!list.empty()) {
+                std::size_t first{};
+                if (!parse_number(first))
+                    break;
+
+                std::size_t last{first};
+                if (list.starts_with('-')) {
+                    list.remove_prefix(1U);
+                    if (!parse_number(last))
+                        break;
+                }
+
+                for (auto id = first; id <= last; ++id) {
+                    ids.push_back(id);
+                }
+
+                if (!list.starts_with(','))
+                    break;
+                list.remove_prefix(1U);
+            }
+
+            return ids;
+        }
+
+        [[nodiscard]] inline std::vector<std::size_t> read_id_list(const std::string& path)
+        {
+            std::ifstream file{path};
+            std::string list{};
+            if (!std::getline(file, list))
+                return {};
+            return parse_id_list(list);
+        }
+
+        //Set once the kernel refused to interleave a mapping
+        inline std::atomic_bool interleaving_failed{false};
+
+#if RAYCHEL_ACTIVE_OS == RAYCHEL_OS_LINUX
+        //Map size + alignment - page_size bytes and cut off what lies before and after an aligned block of size bytes
+        [[nodiscard]] inline void* map_aligned(std::size_t size, std::size_t alignment, std::size_t page_size, int flags) noexcept
+        {
+            const auto mapped_size = size + alignment - page_size;
+            auto* const mapping = static_cast<std::byte*>(mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, flags, -1, 0));
+            if (static_cast<void*>(mapping) == MAP_FAILED)
+                return nullptr;
+
+            const auto address = reinterpret_cast<std::uintptr_t>(mapping);
+            const auto head = (alignment - address % alignment) % alignment;
+            const auto tail = mapped_size - head - size;
+            if (head != 0U)
+                munmap(mapping, head);
+            if (tail != 0U)
+                munmap(mapping + head + size, tail);
+            return mapping + head;
+        }
+#endif
+
+        //Map size bytes, aligned to alignment. Both have to be multiples of huge_page_size
+        [[nodiscard]] inline void*
+        map_huge_pages(std::size_t size, std::size_t alignment, NumaPolicy policy, HugePageMode mode) noexcept
+        {
+#if RAYCHEL_ACTIVE_OS == RAYCHEL_OS_LINUX
+            void* memory = nullptr;
+
+            if (mode == HugePageMode::reserved) {
+                memory = map_aligned(size, alignment, huge_page_size, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB);
+            }
+
+            if (memory == nullptr) {
+                //Regular mappings are only aligned to regular pages, so we may have to cut off up to a whole alignment
+                memory = map_aligned(size, alignment, 0U, MAP_PRIVATE | MAP_ANONYMOUS);
+                if (memory == nullptr)
+                    return nullptr;
+                madvise(memory, size, MADV_HUGEPAGE);
+            }
+
+            if (policy == NumaPolicy::interleave) {
+                //Nodes that do not exist are ignored by the kernel
+                constexpr unsigned long all_nodes = std::numeric_limits<unsigned long>::max();
+                constexpr auto max_node = std::numeric_limits<unsigned long>::digits;
+                if (syscall(SYS_mbind, memory, size, MPOL_INTERLEAVE, &all_nodes, max_node, 0U) != 0) {
+                    //The memory is still usable, it just ends up on the node that touches it first
+                    interleaving_failed.store(true, std::memory_order_relaxed);
+                }
+            }
+
+            return memory;
+#else
+            if (policy == NumaPolicy::interleave)
+                interleaving_failed.store(true, std::memory_order_relaxed);
+            (void)mode;
+            return ::operator new(size, std::align_val_t{alignment}, std::nothrow);
+#endif
+        }
+
+        inline void unmap_huge_pages(void* memory, std::size_t size, std::size_t alignment) noexcept
+        {
+#if RAYCHEL_ACTIVE_OS == RAYCHEL_OS_LINUX
+            (void)alignment;
+            munmap(memory, size);
+#else
+            (void)size;
+            ::operator delete(memory, std::align_val_t{alignment});
+#endif
+        }
+
+    } // namespace details
+
+    /**
+    * \brief Get the number of NUMA nodes of this machine
+    *
+    * \return The number of NUMA nodes, or 1 if it cannot be determined
+    */
+    [[nodiscard]] inline std::size_t numa_node_count()
+    {
+        if constexpr (active_os == OS::Linux) {
+            const auto nodes = details::read_id_list("/sys/devices/system/node/online");
+            if (!nodes.empty())
+                return nodes.back() + 1U;
+        }
+        return 1U;
+    }
+
+    /**
+    * \brief Get the CPUs that belong to a NUMA node
+    *
+    * \param node Index of the NUMA node
+    * \return The indices of the CPUs, empty if they cannot be determined
+    */
+    [[nodiscard]] inline std::vector<std::size_t> cpus_of_numa_node(std::size_t node)
+    {
+        if constexpr (active_os == OS::Linux) {
+            return details::read_id_list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        }
+        return {};
+    }
+
+    //Get the NUMA node that the calling thread currently runs on
+    [[nodiscard]] inline std::size_t current_numa_node() noexcept
+    {
+#if RAYCHEL_ACTIVE_OS == RAYCHEL_OS_LINUX
+        unsigned int cpu{};
+        unsigned int node{};
+        if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+            return node;
+#endif
+        return 0U;
+    }
+
+    //Whether the kernel refused to interleave the memory of a HugePageAllocator with NumaPolicy::interleave at least once.
+    //Always true on systems other than Linux
+    [[nodiscard]] inline bool numa_interleaving_failed() noexcept
+    {
+        return details::interleaving_failed.load(std::memory_order_relaxed);
+    }
+
+    namespace details {
+
+        /**
+        * \brief Memory pool that hands out small blocks from large huge page backed chunks
+        *
+        * Blocks are grouped into size classes with one free list each. Freed blocks are reused, but chunks are never returned
+        * to the operating system. Blocks that are larger than max_block_size get their own mapping.
+        *
+        * There is one set of chunks and free lists per NUMA node, chosen by the node the allocating thread runs on. That way,
+        * blocks allocated on different nodes never share a huge page, and threads on different nodes do not contend for the
+        * same lock. Freed blocks go back to the node they were allocated on.
+        */
+        template <NumaPolicy Policy, HugePageMode Mode>
+        class HugePagePool
+        {
+            struct FreeBlock
+            {
+                FreeBlock* next;
+            };
+
+        public:
+            static constexpr std::size_t granularity = 64U;
+            static constexpr std::size_t max_fine_block_size = 4096U;
+            static constexpr std::size_t max_block_size = 64U * 1024U;
+            static constexpr std::size_t chunk_size = 16U * huge_page_size;
+
+            [[nodiscard]] static HugePagePool& instance() noexcept
+            {
+                //Never destroyed, so that objects with static storage duration can still free their memory at exit
+                static auto* const pool = new HugePagePool{};
+                return *pool;
+            }
+
+            [[nodiscard]] void* allocate(std::size_t size, std::size_t alignment) noexcept
+            {
+                if (size > max_block_size || alignment > granularity)
+                    return map_huge_pages(_mapping_size(size), huge_page_size, Policy, Mode);
+
+                const auto size_class = _size_class(size);
+                auto& pool = _local_pool();
+
+                std::scoped_lock lock{pool.mutex};
+
+                if (auto* const block = pool.free_lists[size_class]; block != nullptr) {
+                    pool.free_lists[size_class] = block->next;
+                    return block;
+                }
+
+                const auto block_size = _block_size(size_class);
+                if (static_cast<std::size_t>(pool.chunk_end - pool.chunk_position) < block_size) {
+                    auto* const chunk = static_cast<std::byte*>(map_huge_pages(chunk_size, chunk_size, Policy, Mode));
+                    if (chunk == nullptr)
+                        return nullptr;
+                    ::new (chunk) ChunkHeader{&pool};
+                    pool.chunk_position = chunk + granularity;
+                    pool.chunk_end = chunk + chunk_size;
+                }
+
+                auto* const block = pool.chunk_position;
+                pool.chunk_position += block_size;
+                return block;
+            }
+
+            void deallocate(void* memory, std::size_t size, std::size_t alignment) noexcept
+            {
+                if (size > max_block_size || alignment > granularity) {
+                    unmap_huge_pages(memory, _mapping_size(size), huge_page_size);
+                    return;
+                }
+
+                const auto size_class = _size_class(size);
+                auto& pool = _owning_pool(memory);
+
+                std::scoped_lock lock{pool.mutex};
+                pool.free_lists[size_class] = ::new (memory) FreeBlock{pool.free_lists[size_class]};
+            }
+
+            //Index of the NUMA node whose pool memory was allocated from. memory must be a small block
+            [[nodiscard]] std::size_t numa_node_of(const void* memory) noexcept
+            {
+                return static_cast<std::size_t>(&_owning_pool(memory) - pools_.data());
+            }
+
+        private:
+            static constexpr std::size_t fine_class_count = max_fine_block_size / granularity;
+            static constexpr std::size_t class_count = fine_class_count + 4U;
+
+            struct NodePool
+            {
+                std::mutex mutex;
+                std::array<FreeBlock*, class_count> free_lists{};
+                std::byte* chunk_position{};
+                std::byte* chunk_end{};
+            };
+
+            //Stored at the start of every chunk
+            struct ChunkHeader
+            {
+                NodePool* owner;
+            };
+
+            HugePagePool() : pools_(_pool_count())
+            {}
+
+            [[nodiscard]] static std::size_t _pool_count() noexcept
+            {
+                try {
+                    return numa_node_count();
+                } catch (...) {
+                    //Reading the topology failed, everything shares one pool
+                    return 1U;
+                }
+            }
+
+            [[nodiscard]] NodePool& _local_pool() noexcept
+            {
+                const auto node = current_numa_node();
+                return pools_[node < pools_.size() ? node : 0U];
+            }
+
+            [[nodiscard]] static NodePool& _owning_pool(const void* memory) noexcept
+            {
+                //Chunks are aligned to chunk_size, so rounding down finds the start of the one memory is in
+                const auto chunk = reinterpret_cast<std::uintptr_t>(memory) / chunk_size * chunk_size;
+                auto* const header = reinterpret_cast<ChunkHeader*>(chunk); //NOLINT(performance-no-int-to-ptr): see above
+                return *std::launder(header)->owner;
+            }
+
+            //Blocks up to max_fine_block_size come in steps of granularity, larger ones in powers of two
+            [[nodiscard]] static constexpr std::size_t _size_class(std::size_t size) noexcept
+            {
+                if (size <= max_fine_block_size)
+                    return (std::max(size, std::size_t{1U}) - 1U) / granularity;
+
+                std::size_t size_class{fine_class_count};
+                for (auto block_size = max_fine_block_size * 2U; block_size < size; block_size *= 2U) {
+                    ++size_class;
+                }
+                return size_class;
+            }
+
+            [[nodiscard]] static constexpr std::size_t _block_size(std::size_t size_class) noexcept
+            {
+                if (size_class < fine_class_count)
+                    return (size_class + 1U) * granularity;
+                return max_fine_block_size << (size_class - fine_class_count + 1U);
+            }
+
+            [[nodiscard]] static constexpr std::size_t _mapping_size(std::size_t size) noexcept
+            {
+                return (size + huge_page_size - 1U) / huge_page_size * huge_page_size;
+            }
+
+            std::vector<NodePool> pools_;
+        };
+
+    } // namespace details
+
+    /**
+    * \brief Allocator that backs its memory with huge pages
+    *
+    * The allocator is stateless: all allocators with the same policies share one memory pool.
+    * Small allocations, like the children of OcTree nodes, are packed into large chunks so that they share huge pages.
+    * Each NUMA node has its own chunks, so with NumaPolicy::local, threads on different nodes never share a huge page.
+    *
+    * \tparam T Type of the allocated objects
+    * \tparam Policy How the pages are placed on the NUMA nodes of the machine
+    * \tparam Mode What kind of huge pages to use
+    */
+    template <typename T, NumaPolicy Policy = NumaPolicy::local, HugePageMode Mode = HugePageMode::transparent>
+    class HugePageAllocator
+    {
+    public:
+        using value_type = T;
+
+        static constexpr NumaPolicy policy = Policy;
+        static constexpr HugePageMode mode = Mode;
+
+        template <typename U>
+        struct rebind
+        {
+            using other = HugePageAllocator<U, Policy, Mode>;
+        };
+
+        constexpr HugePageAllocator() noexcept = default;
+
+        //NOLINTNEXTLINE(google-explicit-constructor): allocators have to be implicitly convertible to their rebound versions
+        template <typename U>
+        constexpr HugePageAllocator(const HugePageAllocator<U, Policy, Mode>& /*unused*/) noexcept
+        {}
+
+        [[nodiscard]] T* allocate(std::size_t n)
+        {
+            if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+                throw std::bad_array_new_length{};
+
+            auto* const memory = details::HugePagePool<Policy, Mode>::instance().allocate(n * sizeof(T), alignof(T));
+            if (memory == nullptr)
+                throw std::bad_alloc{};
+
+            return static_cast<T*>(memory);
+        }
+
+        void deallocate(T* memory, std::size_t n) noexcept
+        {
+            details::HugePagePool<Policy, Mode>::instance().deallocate(memory, n * sizeof(T), alignof(T));
+        }
+
+        template <typename U>
+        constexpr bool operator==(const HugePageAllocator<U, Policy, Mode>& /*unused*/) const noexcept
+        {
+            return true;
+        }
+    };
+
+} //namespace Raychel
+
+#endif //!RAYCHELCORE_HUGE_PAGE_ALLOCATOR_H
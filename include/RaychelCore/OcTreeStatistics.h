@@ -0,0 +1,316 @@
+/**
+* \file OcTreeStatistics.h
+* \author Weckyy702 (weckyy702@gmail.com)
+* \brief Header file for OcTree query statistics
+* \date 2023-02-21
+*
+* MIT License
+* Copyright (c) [2023] [Weckyy702 (weckyy702@gmail.com | https://github.com/Weckyy702)]
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+#ifndef RAYCHELCORE_OCTREE_STATISTICS_H
+#define RAYCHELCORE_OCTREE_STATISTICS_H
+
+#include "RaychelCore/ClassMacros.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+//Define RAYCHELCORE_OCTREE_STATISTICS to 1 to count the work done by OcTree queries.
+//Everything that depends on it lives in an inline namespace, and OcTree takes a defaulted template parameter of type
+//details::OcTreeStatisticsTag from that namespace, so translation units may use different values
+#ifndef RAYCHELCORE_OCTREE_STATISTICS
+    #define RAYCHELCORE_OCTREE_STATISTICS 0
+#endif
+
+namespace Raychel {
+
+    //Work done by a single OcTree query
+    struct OcTreeQueryStatistics
+    {
+        std::size_t nodes_visited{};
+        std::size_t leaves_scanned{};
+        std::size_t distance_evaluations{};
+        //Deepest level of recursion, the root is at depth 1
+        std::size_t max_depth{};
+    };
+
+    //Work done by all OcTree queries since the last reset
+    struct OcTreeStatistics
+    {
+        std::size_t queries{};
+        std::size_t nodes_visited{};
+        std::size_t leaves_scanned{};
+        std::size_t distance_evaluations{};
+        std::size_t max_depth{};
+        //Most nodes visited by a single query. Useful for finding latency outliers
+        std::size_t max_nodes_visited{};
+    };
+
+    namespace details {
+#if RAYCHELCORE_OCTREE_STATISTICS
+        inline namespace with_octree_statistics {
+#else
+        inline namespace without_octree_statistics {
+#endif
+
+        inline constexpr bool collect_octree_statistics = RAYCHELCORE_OCTREE_STATISTICS;
+
+        //Default template argument of OcTree and StreamingOcTree, see above
+        struct OcTreeStatisticsTag
+        {};
+
+        //Totals of one thread. Only the owning thread writes, so relaxed loads and stores are enough
+        struct OcTreeStatisticsAccumulator
+        {
+            void add(const OcTreeQueryStatistics& query) noexcept
+            {
+                _add(queries, 1U);
+                _add(nodes_visited, query.nodes_visited);
+                _add(leaves_scanned, query.leaves_scanned);
+                _add(distance_evaluations, query.distance_evaluations);
+                _max(max_depth, query.max_depth);
+                _max(max_nodes_visited, query.nodes_visited);
+            }
+
+            void add_to(OcTreeStatistics& statistics) const noexcept
+            {
+                statistics.queries += queries.load(std::memory_order_relaxed);
+                statistics.nodes_visited += nodes_visited.load(std::memory_order_relaxed);
+                statistics.leaves_scanned += leaves_scanned.load(std::memory_order_relaxed);
+                statistics.distance_evaluations += distance_evaluations.load(std::memory_order_relaxed);
+                statistics.max_depth = std::max(statistics.max_depth, max_depth.load(std::memory_order_relaxed));
+                statistics.max_nodes_visited =
+                    std::max(statistics.max_nodes_visited, max_nodes_visited.load(std::memory_order_relaxed));
+            }
+
+            void reset() noexcept
+            {
+                for (auto* counter :
+                     {&queries, &nodes_visited, &leaves_scanned, &distance_evaluations, &max_depth, &max_nodes_visited}) {
+                    counter->store(0U, std::memory_order_relaxed);
+                }
+            }
+
+            std::atomic_size_t queries{};
+            std::atomic_size_t nodes_visited{};
+            std::atomic_size_t leaves_scanned{};
+            std::atomic_size_t distance_evaluations{};
+            std::atomic_size_t max_depth{};
+            std::atomic_size_t max_nodes_visited{};
+
+        private:
+            static void _add(std::atomic_size_t& counter, std::size_t value) noexcept
+            {
+                counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+            }
+
+            static void _max(std::atomic_size_t& counter, std::size_t value) noexcept
+            {
+                if (value > counter.load(std::memory_order_relaxed))
+                    counter.store(value, std::memory_order_relaxed);
+            }
+        };
+
+        class OcTreeStatisticsRegistry
+        {
+        public:
+            void register_thread(OcTreeStatisticsAccumulator* accumulator)
+            {
+                std::scoped_lock lock{mutex_};
+                threads_.push_back(accumulator);
+            }
+
+            //The totals of a thread that exits are kept
+            void retire_thread(OcTreeStatisticsAccumulator* accumulator) noexcept
+            {
+                std::scoped_lock lock{mutex_};
+                accumulator->add_to(retired_);
+                std::erase(threads_, accumulator);
+            }
+
+            [[nodiscard]] OcTreeStatistics collect() noexcept
+            {
+                std::scoped_lock lock{mutex_};
+                auto statistics = retired_;
+                for (const auto* accumulator : threads_) {
+                    accumulator->add_to(statistics);
+                }
+                return statistics;
+            }
+
+            void reset() noexcept
+            {
+                std::scoped_lock lock{mutex_};
+                retired_ = {};
+                for (auto* accumulator : threads_) {
+                    accumulator->reset();
+                }
+            }
+
+        private:
+            std::mutex mutex_;
+            std::vector<OcTreeStatisticsAccumulator*> threads_;
+            OcTreeStatistics retired_{};
+        };
+
+        [[nodiscard]] inline OcTreeStatisticsRegistry& octree_statistics_registry() noexcept
+        {
+            static OcTreeStatisticsRegistry registry{};
+            return registry;
+        }
+
+        class ThreadOcTreeStatistics
+        {
+        public:
+            ThreadOcTreeStatistics()
+            {
+                octree_statistics_registry().register_thread(&accumulator_);
+            }
+
+            RAYCHEL_MAKE_NONCOPY_NONMOVE(ThreadOcTreeStatistics)
+
+            ~ThreadOcTreeStatistics() noexcept
+            {
+                octree_statistics_registry().retire_thread(&accumulator_);
+            }
+
+            void finish_query() noexcept
+            {
+                last_query = current_query;
+                accumulator_.add(current_query);
+            }
+
+            OcTreeQueryStatistics current_query{};
+            OcTreeQueryStatistics last_query{};
+
+        private:
+            OcTreeStatisticsAccumulator accumulator_{};
+        };
+
+        [[nodiscard]] inline ThreadOcTreeStatistics& thread_octree_statistics()
+        {
+            //Make sure the registry outlives the accumulators of all threads
+            (void)octree_statistics_registry();
+            thread_local ThreadOcTreeStatistics statistics{};
+            return statistics;
+        }
+
+        inline void count_octree_node_visit(std::size_t depth) noexcept
+        {
+            if constexpr (collect_octree_statistics) {
+                auto& query = thread_octree_statistics().current_query;
+                ++query.nodes_visited;
+                query.max_depth = std::max(query.max_depth, depth);
+            }
+        }
+
+        inline void count_octree_leaf_scan(std::size_t distance_evaluations) noexcept
+        {
+            if constexpr (collect_octree_statistics) {
+                auto& query = thread_octree_statistics().current_query;
+                ++query.leaves_scanned;
+                query.distance_evaluations += distance_evaluations;
+            }
+        }
+
+        //Marks the duration of one query. Counted work is published when the scope ends
+        struct OcTreeQueryScope
+        {
+            OcTreeQueryScope() noexcept
+            {
+                if constexpr (collect_octree_statistics) {
+                    thread_octree_statistics().current_query = {};
+                }
+            }
+
+            RAYCHEL_MAKE_NONCOPY_NONMOVE(OcTreeQueryScope)
+
+            ~OcTreeQueryScope() noexcept
+            {
+                if constexpr (collect_octree_statistics) {
+                    thread_octree_statistics().finish_query();
+                }
+            }
+        };
+
+#if RAYCHELCORE_OCTREE_STATISTICS
+        } // namespace with_octree_statistics
+#else
+        } // namespace without_octree_statistics
+#endif
+    } // namespace details
+
+#if RAYCHELCORE_OCTREE_STATISTICS
+    inline namespace with_octree_statistics {
+#else
+    inline namespace without_octree_statistics {
+#endif
+
+    /**
+    * \brief Get the work done by the most recent OcTree query on the calling thread
+    *
+    * \return The statistics of the last query, or all zeros if RAYCHELCORE_OCTREE_STATISTICS is not enabled
+    */
+    [[nodiscard]] inline OcTreeQueryStatistics last_octree_query_statistics() noexcept
+    {
+        if constexpr (details::collect_octree_statistics) {
+            return details::thread_octree_statistics().last_query;
+        } else {
+            return {};
+        }
+    }
+
+    /**
+    * \brief Get the work done by all OcTree queries on all threads since the last call to reset_octree_statistics()
+    *
+    * Queries that are still running while this is called may be partially included.
+    *
+    * \return The accumulated statistics, or all zeros if RAYCHELCORE_OCTREE_STATISTICS is not enabled
+    */
+    [[nodiscard]] inline OcTreeStatistics octree_statistics() noexcept
+    {
+        if constexpr (details::collect_octree_statistics) {
+            return details::octree_statistics_registry().collect();
+        } else {
+            return {};
+        }
+    }
+
+    //Should only be called while no queries are running
+    inline void reset_octree_statistics() noexcept
+    {
+        if constexpr (details::collect_octree_statistics) {
+            details::octree_statistics_registry().reset();
+        }
+    }
+
+#if RAYCHELCORE_OCTREE_STATISTICS
+    } // namespace with_octree_statistics
+#else
+    } // namespace without_octree_statistics
+#endif
+
+} //namespace Raychel
+
+#endif //!RAYCHELCORE_OCTREE_STATISTICS_H
@@ -29,21 +29,32 @@
 #define RAYCHELCORE_OCTTREE_H
 
 #include "RaychelCore/ClassMacros.h"
+#include "RaychelCore/OcTreeStatistics.h"
+#include "RaychelCore/compat.h"
 
 #include <algorithm>
+#include <atomic>
+#include <bit>
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <concepts>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <future>
 #include <initializer_list>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <memory>
+#include <new>
 #include <numeric>
 #include <optional>
+#include <span>
+#include <thread>
 #include <type_traits>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -75,6 +86,23 @@ namespace Raychel {
         Coordinate bottom_front_left, top_back_right;
     };
 
+    // clang-format off
+    //Summary of all elements in a subtree, e.g. their total power and centroid.
+    //add() is called once for every node an element is inserted into
+    template <typename A, typename T>
+    concept OcTreeAggregate = std::default_initializable<A> && std::copyable<A> && requires(A a, const T& t)
+    {
+        a.add(t);
+    };
+    // clang-format on
+
+    enum class OcTreePrecision {
+        //Nodes store their bounds in the precision of the coordinates
+        exact,
+        //Nodes store their bounds as floats, rounded outwards. Only element distances are computed in full precision
+        mixed,
+    };
+
     namespace details {
 
         template <MemberCoordinate T>
@@ -208,6 +236,24 @@ namespace Raychel {
             return overlaps_part(a, b) || overlaps_part(b, a);
         }
 
+        //Smallest box that contains both a and b
+        template <Coordinate Coord>
+        [[nodiscard]] constexpr BasicBoundingBox<Coord>
+        union_of(const BasicBoundingBox<Coord>& a, const BasicBoundingBox<Coord>& b)
+        {
+            Coord min{a.bottom_front_left};
+            Coord max{a.top_back_right};
+
+            get_x(min) = std::min(get_x(min), get_x(b.bottom_front_left));
+            get_y(min) = std::min(get_y(min), get_y(b.bottom_front_left));
+            get_z(min) = std::min(get_z(min), get_z(b.bottom_front_left));
+            get_x(max) = std::max(get_x(max), get_x(b.top_back_right));
+            get_y(max) = std::max(get_y(max), get_y(b.top_back_right));
+            get_z(max) = std::max(get_z(max), get_z(b.top_back_right));
+
+            return BasicBoundingBox<Coord>{min, max};
+        }
+
         template <std::size_t ChildIndex, Coordinate Coord>
             requires(ChildIndex < 8U)
         [[nodiscard]] constexpr BasicBoundingBox<Coord> bounding_box_for(
@@ -234,6 +280,56 @@ namespace Raychel {
             return BasicBoundingBox<Coord>{min, max};
         }
 
+        template <Coordinate Coord>
+        [[nodiscard]] constexpr BasicBoundingBox<Coord>
+        bounding_box_for(const BasicBoundingBox<Coord>& bounding_box, const Coord& midpoint, std::size_t child_index) noexcept
+        {
+            switch (child_index) {
+                case 0:
+                    return bounding_box_for<0>(bounding_box, midpoint);
+                case 1:
+                    return bounding_box_for<1>(bounding_box, midpoint);
+                case 2:
+                    return bounding_box_for<2>(bounding_box, midpoint);
+                case 3:
+                    return bounding_box_for<3>(bounding_box, midpoint);
+                case 4:
+                    return bounding_box_for<4>(bounding_box, midpoint);
+                case 5:
+                    return bounding_box_for<5>(bounding_box, midpoint);
+                case 6:
+                    return bounding_box_for<6>(bounding_box, midpoint);
+                default:
+                    return bounding_box_for<7>(bounding_box, midpoint);
+            }
+        }
+
+        //Bitmask of the children of bounding_box that where overlaps. Bit i is set if the child with index i is overlapped
+        template <Coordinate Coord>
+        [[nodiscard]] constexpr std::uint8_t overlapped_children(
+            const BasicBoundingBox<Coord>& bounding_box, const Coord& midpoint, const BasicBoundingBox<Coord>& where) noexcept
+        {
+            if (!overlaps(where, bounding_box))
+                return 0U;
+
+            //Children with bit 0/1/2 of their index set are in the upper half of the x/y/z axis
+            std::uint8_t mask{0b1111'1111U};
+            if (get_x(where.bottom_front_left) > get_x(midpoint))
+                mask &= 0b1010'1010U;
+            if (get_x(where.top_back_right) < get_x(midpoint))
+                mask &= 0b0101'0101U;
+            if (get_y(where.bottom_front_left) > get_y(midpoint))
+                mask &= 0b1100'1100U;
+            if (get_y(where.top_back_right) < get_y(midpoint))
+                mask &= 0b0011'0011U;
+            if (get_z(where.bottom_front_left) > get_z(midpoint))
+                mask &= 0b1111'0000U;
+            if (get_z(where.top_back_right) < get_z(midpoint))
+                mask &= 0b0000'1111U;
+
+            return mask;
+        }
+
         template <Coordinate Coord>
         [[nodiscard]] constexpr std::array<BasicBoundingBox<Coord>, 8>
         subdivide_bounding_box(const BasicBoundingBox<Coord>& bounding_box, const Coord& midpoint) noexcept
@@ -250,6 +346,22 @@ namespace Raychel {
             };
         }
 
+        struct NoAggregate
+        {
+            template <typename T>
+            constexpr void add(const T& /*unused*/) noexcept
+            {}
+        };
+
+        struct AcceptAll
+        {
+            template <typename T>
+            constexpr bool operator()(const T& /*unused*/) const noexcept
+            {
+                return true;
+            }
+        };
+
         struct BoundingBoxFromCoordinate
         {
             template <Coordinate T>
@@ -275,6 +387,220 @@ namespace Raychel {
             return sq(get_x(a) - get_x(b)) + sq(get_y(a) - get_y(b)) + sq(get_z(a) - get_z(b));
         }
 
+        template <Coordinate Coord>
+        [[nodiscard]] constexpr auto distance_squared_to_box(const BasicBoundingBox<Coord>& box, const Coord& c)
+        {
+            using Number = ElementType<Coord>;
+
+            const auto axis_distance = [](Number value, Number min, Number max) -> Number {
+                if (value < min)
+                    return min - value;
+                if (value > max)
+                    return value - max;
+                return Number{};
+            };
+
+            return sq(axis_distance(get_x(c), get_x(box.bottom_front_left), get_x(box.top_back_right))) +
+                   sq(axis_distance(get_y(c), get_y(box.bottom_front_left), get_y(box.top_back_right))) +
+                   sq(axis_distance(get_z(c), get_z(box.bottom_front_left), get_z(box.top_back_right)));
+        }
+
+        template <Coordinate Coord>
+        [[nodiscard]] constexpr auto
+        distance_squared_between_boxes(const BasicBoundingBox<Coord>& a, const BasicBoundingBox<Coord>& b)
+        {
+            using Number = ElementType<Coord>;
+
+            const auto axis_distance = [](Number min_a, Number max_a, Number min_b, Number max_b) -> Number {
+                if (max_a < min_b)
+                    return min_b - max_a;
+                if (max_b < min_a)
+                    return min_a - max_b;
+                return Number{};
+            };
+
+            const auto& a_min = a.bottom_front_left;
+            const auto& a_max = a.top_back_right;
+            const auto& b_min = b.bottom_front_left;
+            const auto& b_max = b.top_back_right;
+
+            return sq(axis_distance(get_x(a_min), get_x(a_max), get_x(b_min), get_x(b_max))) +
+                   sq(axis_distance(get_y(a_min), get_y(a_max), get_y(b_min), get_y(b_max))) +
+                   sq(axis_distance(get_z(a_min), get_z(a_max), get_z(b_min), get_z(b_max)));
+        }
+
+        //Point with single precision coordinates for node bounds with OcTreePrecision::mixed
+        struct FloatPoint
+        {
+            float x, y, z;
+        };
+
+        using FloatBoundingBox = BasicBoundingBox<FloatPoint>;
+
+        template <std::floating_point Number>
+        [[nodiscard]] float round_down_to_float(Number value) noexcept
+        {
+            constexpr auto max = std::numeric_limits<float>::max();
+            if (value > Number{max})
+                return max;
+            if (value < Number{-max})
+                return -std::numeric_limits<float>::infinity();
+
+            auto rounded = static_cast<float>(value);
+            if (Number{rounded} > value)
+                rounded = std::nextafter(rounded, -std::numeric_limits<float>::infinity());
+            return rounded;
+        }
+
+        template <std::floating_point Number>
+        [[nodiscard]] float round_up_to_float(Number value) noexcept
+        {
+            return -round_down_to_float(-value);
+        }
+
+        //The float bounds always contain box
+        template <Coordinate Coord>
+        [[nodiscard]] FloatBoundingBox to_float_bounds(const BasicBoundingBox<Coord>& box) noexcept
+        {
+            const auto& min = box.bottom_front_left;
+            const auto& max = box.top_back_right;
+
+            return FloatBoundingBox{
+                FloatPoint{round_down_to_float(get_x(min)), round_down_to_float(get_y(min)), round_down_to_float(get_z(min))},
+                FloatPoint{round_up_to_float(get_x(max)), round_up_to_float(get_y(max)), round_up_to_float(get_z(max))}};
+        }
+
+        template <Coordinate Coord>
+        [[nodiscard]] BasicBoundingBox<Coord> from_float_bounds(const FloatBoundingBox& box) noexcept
+        {
+            const auto& min = box.bottom_front_left;
+            const auto& max = box.top_back_right;
+
+            return BasicBoundingBox<Coord>{Coord{min.x, min.y, min.z}, Coord{max.x, max.y, max.z}};
+        }
+
+        //Query point rounded in both directions, so that distances to float bounds can be bounded from below
+        struct FloatQuery
+        {
+            FloatPoint down, up;
+        };
+
+        template <Coordinate Coord>
+        [[nodiscard]] FloatQuery to_float_query(const Coord& where) noexcept
+        {
+            const auto x = get_x(where);
+            const auto y = get_y(where);
+            const auto z = get_z(where);
+
+            return FloatQuery{
+                FloatPoint{round_down_to_float(x), round_down_to_float(y), round_down_to_float(z)},
+                FloatPoint{round_up_to_float(x), round_up_to_float(y), round_up_to_float(z)}};
+        }
+
+        //Gap between [min, max] and a value rounded to [down, up]. Rounding away from the box only makes it smaller
+        [[nodiscard]] inline float conservative_gap(float min, float max, float down, float up) noexcept
+        {
+            return std::max(std::max(min - up, down - max), 0.F);
+        }
+
+        //Each of the six float operations of a distance may round up by half an ulp. Scaling down by 16 ulps covers all of them
+        inline constexpr float conservative_scale = 1.F - 0x1p-20F;
+
+        /**
+        * \brief Squared distance from where to box, computed in single precision
+        *
+        * If box contains the exact bounds of a node, the result is never larger than distance_squared_to_box() of the
+        * exact bounds computed in full precision. Nodes that the full precision search would visit are never skipped,
+        * so both searches find the same elements.
+        *
+        * \param query where, rounded by to_float_query()
+        */
+        template <Coordinate Coord>
+        [[nodiscard]] ElementType<Coord>
+        conservative_distance_squared_to_box(const FloatBoundingBox& box, const FloatQuery& query, const Coord& where) noexcept
+        {
+            const auto& min = box.bottom_front_left;
+            const auto& max = box.top_back_right;
+            const auto x = conservative_gap(min.x, max.x, query.down.x, query.up.x);
+            const auto y = conservative_gap(min.y, max.y, query.down.y, query.up.y);
+            const auto z = conservative_gap(min.z, max.z, query.down.z, query.up.z);
+
+            const auto distance_squared = (x * x + y * y + z * z) * conservative_scale;
+            if (distance_squared <= std::numeric_limits<float>::max()) [[likely]]
+                return ElementType<Coord>{distance_squared};
+
+            //Out of float range. Rounding is monotonic, so the widened bounds are still conservative in full precision
+            return distance_squared_to_box(from_float_bounds<Coord>(box), where);
+        }
+
+        //Float bounds of up to eight boxes as a structure of arrays, so that the distances to all of them are computed at once
+        struct FloatBoundingBoxes
+        {
+            //Insert box at position, moving the boxes from position up to count one slot up
+            void insert(std::size_t position, std::size_t count, const FloatBoundingBox& box) noexcept
+            {
+                for (auto* axis : {&min_x, &min_y, &min_z, &max_x, &max_y, &max_z}) {
+                    const auto begin = axis->begin();
+                    std::copy_backward(
+                        begin + static_cast<std::ptrdiff_t>(position),
+                        begin + static_cast<std::ptrdiff_t>(count),
+                        begin + static_cast<std::ptrdiff_t>(count + 1U));
+                }
+                set(position, box);
+            }
+
+            void set(std::size_t position, const FloatBoundingBox& box) noexcept
+            {
+                min_x[position] = box.bottom_front_left.x;
+                min_y[position] = box.bottom_front_left.y;
+                min_z[position] = box.bottom_front_left.z;
+                max_x[position] = box.top_back_right.x;
+                max_y[position] = box.top_back_right.y;
+                max_z[position] = box.top_back_right.z;
+            }
+
+            [[nodiscard]] FloatBoundingBox at(std::size_t position) const noexcept
+            {
+                return FloatBoundingBox{
+                    FloatPoint{min_x[position], min_y[position], min_z[position]},
+                    FloatPoint{max_x[position], max_y[position], max_z[position]}};
+            }
+
+            std::array<float, 8> min_x{}, min_y{}, min_z{};
+            std::array<float, 8> max_x{}, max_y{}, max_z{};
+        };
+
+        //conservative_distance_squared_to_box() for all eight slots of boxes. Unused slots get meaningless distances
+        template <Coordinate Coord>
+        void conservative_distances_squared_to_boxes(
+            const FloatBoundingBoxes& boxes, const FloatQuery& query, const Coord& where,
+            std::array<ElementType<Coord>, 8>& distances_squared) noexcept
+        {
+            //Fixed size and no branches, so that this loop can be vectorized
+            std::array<float, 8> float_distances_squared{};
+            for (std::size_t i{}; i != 8U; ++i) {
+                const auto x = conservative_gap(boxes.min_x[i], boxes.max_x[i], query.down.x, query.up.x);
+                const auto y = conservative_gap(boxes.min_y[i], boxes.max_y[i], query.down.y, query.up.y);
+                const auto z = conservative_gap(boxes.min_z[i], boxes.max_z[i], query.down.z, query.up.z);
+                float_distances_squared[i] = (x * x + y * y + z * z) * conservative_scale;
+            }
+
+            for (std::size_t i{}; i != 8U; ++i) {
+                if (float_distances_squared[i] <= std::numeric_limits<float>::max()) [[likely]] {
+                    distances_squared[i] = ElementType<Coord>{float_distances_squared[i]};
+                } else {
+                    distances_squared[i] = distance_squared_to_box(from_float_bounds<Coord>(boxes.at(i)), where);
+                }
+            }
+        }
+
+        template <typename Number>
+        [[nodiscard]] constexpr bool is_farther_than(Number lower_bound_squared, Number distance)
+        {
+            //Leave some room for the rounding error of distances that were computed using std::sqrt
+            return lower_bound_squared > sq(distance) * (Number{1} + Number{4} * std::numeric_limits<Number>::epsilon());
+        }
+
         struct GetDistanceToPoint
         {
             template <Coordinate Coord, typename ValueType = ElementType<Coord>>
@@ -283,6 +609,90 @@ namespace Raychel {
             {
                 return std::sqrt(distance_squared(a, b));
             }
+
+            template <Coordinate Coord>
+            [[nodiscard]] constexpr auto squared(const Coord& a, const Coord& b) const noexcept
+            {
+                return distance_squared(a, b);
+            }
+        };
+
+        // clang-format off
+        //GetDistance may provide squared(element, where). The search then compares squared distances
+        //and only takes the square root of the final results
+        template <typename D, typename T, typename Coord>
+        concept SquaredDistance = requires(const D& d, const T& t, const Coord& c)
+        {
+            { d.squared(t, c) } -> std::convertible_to<ElementType<Coord>>;
+        };
+
+        //GetDistance may provide lower_bound(bounding_box, where): a cheap lower bound of the distance to any element
+        //with that bounding box. It must not be larger than the distance to the bounding box itself
+        template <typename D, typename Coord>
+        concept DistanceLowerBound = requires(const D& d, const BasicBoundingBox<Coord>& b, const Coord& c)
+        {
+            { d.lower_bound(b, c) } -> std::convertible_to<ElementType<Coord>>;
+        };
+        // clang-format on
+
+        //Searches compare keys instead of distances. A key is the squared distance if GetDistance supports that
+        template <typename GetDistance, typename T, Coordinate Coord>
+        struct DistanceKey
+        {
+            using Number = ElementType<Coord>;
+
+            static constexpr bool is_squared = SquaredDistance<GetDistance, T, Coord>;
+
+            //Elements are only skipped using their bounding box if computing their distance might be expensive
+            static constexpr bool check_lower_bound =
+                DistanceLowerBound<GetDistance, Coord> || !std::is_same_v<GetDistance, GetDistanceToPoint>;
+
+            [[nodiscard]] static constexpr Number of(const GetDistance& get_distance, const T& element, const Coord& where)
+            {
+                if constexpr (is_squared) {
+                    return get_distance.squared(element, where);
+                } else {
+                    return get_distance(element, where);
+                }
+            }
+
+            [[nodiscard]] static constexpr Number from_distance(Number distance) noexcept
+            {
+                if constexpr (is_squared) {
+                    return sq(distance);
+                } else {
+                    return distance;
+                }
+            }
+
+            [[nodiscard]] static Number to_distance(Number key) noexcept
+            {
+                if constexpr (is_squared) {
+                    return std::sqrt(key);
+                } else {
+                    return key;
+                }
+            }
+
+            [[nodiscard]] static constexpr Number
+            lower_bound_squared(const GetDistance& get_distance, const BasicBoundingBox<Coord>& box, const Coord& where)
+            {
+                if constexpr (DistanceLowerBound<GetDistance, Coord>) {
+                    return sq(get_distance.lower_bound(box, where));
+                } else {
+                    return distance_squared_to_box(box, where);
+                }
+            }
+
+            [[nodiscard]] static constexpr bool is_farther_than(Number lower_bound_squared, Number key) noexcept
+            {
+                if constexpr (is_squared) {
+                    //Leave the same room for rounding errors as details::is_farther_than()
+                    return lower_bound_squared > key * (Number{1} + Number{4} * std::numeric_limits<Number>::epsilon());
+                } else {
+                    return details::is_farther_than(lower_bound_squared, key);
+                }
+            }
         };
 
         template <Coordinate Coord>
@@ -297,175 +707,630 @@ namespace Raychel {
             ValueType distance;
         };
 
-        template <std::size_t BucketSize, std::size_t MaxDepth, Coordinate Coordinate, typename GetDistance, typename Tree>
+        //Equally close items are ordered by their index so that the result does not depend on the traversal order
+        template <Coordinate Coord>
+        [[nodiscard]] constexpr bool is_closer(const ClosestItem<Coord>& a, const ClosestItem<Coord>& b) noexcept
+        {
+            return a.distance < b.distance || (a.distance == b.distance && a.index < b.index);
+        }
+
+        template <Coordinate Coord>
+        constexpr void offer_closest(
+            std::optional<ClosestItem<Coord>>& maybe_closest_item, std::size_t index, ElementType<Coord> distance) noexcept
+        {
+            if (!maybe_closest_item.has_value()) [[unlikely]] {
+                maybe_closest_item.emplace(index, distance);
+                return;
+            }
+
+            if (distance < maybe_closest_item->distance ||
+                (distance == maybe_closest_item->distance && index < maybe_closest_item->index)) [[unlikely]] {
+                maybe_closest_item->index = index;
+                maybe_closest_item->distance = distance;
+            }
+        }
+
+        //Whether the max-heap heap holds item. Only the items that are not closer than item are looked at,
+        //because everything below a closer item is closer, too
+        template <Coordinate Coord>
+        [[nodiscard]] constexpr bool heap_contains(
+            const std::vector<ClosestItem<Coord>>& heap, const ClosestItem<Coord>& item, std::size_t position = 0U) noexcept
+        {
+            if (position >= heap.size() || is_closer(heap[position], item))
+                return false;
+            //is_closer() orders by index last, so only the same element is neither closer nor farther
+            if (!is_closer(item, heap[position]))
+                return true;
+            return heap_contains(heap, item, 2U * position + 1U) || heap_contains(heap, item, 2U * position + 2U);
+        }
+
+        //closest_items is a max-heap of at most k items ordered by is_closer().
+        //has_duplicates must be set if elements that overlap more than one leaf can be offered more than once
+        template <Coordinate Coord>
+        constexpr void offer_k_closest(
+            std::vector<ClosestItem<Coord>>& closest_items, std::size_t k, std::size_t index, ElementType<Coord> distance,
+            bool has_duplicates)
+        {
+            const ClosestItem<Coord> item{index, distance};
+
+            if (closest_items.size() == k && !is_closer(item, closest_items.front()))
+                return;
+
+            if (has_duplicates && heap_contains(closest_items, item))
+                return;
+
+            if (closest_items.size() == k) {
+                std::pop_heap(closest_items.begin(), closest_items.end(), is_closer<Coord>);
+                closest_items.pop_back();
+            }
+            closest_items.push_back(item);
+            std::push_heap(closest_items.begin(), closest_items.end(), is_closer<Coord>);
+        }
+
+        //Prefetch the first few cache lines of an object
+        template <typename T>
+        void prefetch(const T* object) noexcept
+        {
+            constexpr std::size_t cache_line_size = 64U;
+            constexpr std::size_t max_cache_lines = 4U;
+
+            const auto* const bytes = reinterpret_cast<const char*>(object);
+            const auto size = std::min(sizeof(T), cache_line_size * max_cache_lines);
+            for (std::size_t offset{}; offset < size; offset += cache_line_size) {
+                RAYCHEL_PREFETCH(bytes + offset);
+            }
+        }
+
+        template <
+            std::size_t BucketSize, std::size_t MaxDepth, Coordinate Coordinate, typename GetDistance, typename Aggregate,
+            typename Allocator, OcTreePrecision Precision, typename Tree>
         class OctNode
         {
+            template <typename U>
+            using AllocatorFor = typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
+
             using BoundingBox = BasicBoundingBox<Coordinate>;
             using Number = ElementType<Coordinate>;
 
+            static constexpr bool is_mixed_precision = Precision == OcTreePrecision::mixed;
+
+            //Bounds used by searches. The exact bounds are only needed while inserting, so they are passed down instead
+            using NodeBounds = std::conditional_t<is_mixed_precision, FloatBoundingBox, BoundingBox>;
+            using NodeQuery = std::conditional_t<is_mixed_precision, FloatQuery, std::monostate>;
+
+            //Leaves store up to BucketSize entries inline. Only leaves at MaxDepth can hold more,
+            //those move all of their entries to the heap
             class IndexContainer
             {
             public:
                 constexpr IndexContainer() = default;
 
-                [[nodiscard]] constexpr bool is_full() const noexcept
+                IndexContainer(const IndexContainer& other)
+                    : overflow_indecies_{other.overflow_indecies_},
+                      overflow_bounding_boxes_{other.overflow_bounding_boxes_},
+                      indecies_{other.indecies_}
                 {
-                    return indecies_.size() >= BucketSize;
+                    _copy_inline_bounding_boxes(other);
                 }
 
-                [[nodiscard]] constexpr std::size_t size() const noexcept
+                IndexContainer(IndexContainer&& other) noexcept
+                    : overflow_indecies_{std::move(other.overflow_indecies_)},
+                      overflow_bounding_boxes_{std::move(other.overflow_bounding_boxes_)},
+                      indecies_{other.indecies_}
                 {
-                    return indecies_.size();
+                    _move_inline_bounding_boxes(std::move(other));
                 }
 
-                constexpr void insert(std::size_t index_in_tree, const BoundingBox& where) noexcept
+                IndexContainer& operator=(const IndexContainer& other)
                 {
-                    indecies_.push_back(index_in_tree);
-                    bounding_boxes_.push_back(where);
+                    if (this != &other) {
+                        _destroy_inline_bounding_boxes();
+                        indecies_ = other.indecies_;
+                        overflow_indecies_ = other.overflow_indecies_;
+                        overflow_bounding_boxes_ = other.overflow_bounding_boxes_;
+                        _copy_inline_bounding_boxes(other);
+                    }
+                    return *this;
                 }
 
-                [[nodiscard]] constexpr BoundingBox bounding_box_at(std::size_t index) const noexcept
+                IndexContainer& operator=(IndexContainer&& other) noexcept
                 {
-                    return bounding_boxes_[index];
+                    if (this != &other) {
+                        _destroy_inline_bounding_boxes();
+                        indecies_ = other.indecies_;
+                        overflow_indecies_ = std::move(other.overflow_indecies_);
+                        overflow_bounding_boxes_ = std::move(other.overflow_bounding_boxes_);
+                        _move_inline_bounding_boxes(std::move(other));
+                    }
+                    return *this;
                 }
 
-                [[nodiscard]] constexpr std::size_t index_at(std::size_t index) const noexcept
+                ~IndexContainer() noexcept
                 {
-                    return indecies_[index];
+                    _destroy_inline_bounding_boxes();
                 }
 
-                [[nodiscard]] constexpr auto begin() const noexcept
+                [[nodiscard]] bool is_full() const noexcept
                 {
-                    return indecies_.begin();
+                    return size() >= BucketSize;
                 }
 
-                [[nodiscard]] constexpr auto end() const noexcept
+                [[nodiscard]] std::size_t size() const noexcept
                 {
-                    return indecies_.end();
+                    return _is_spilled() ? overflow_indecies_.size() : inline_size_;
                 }
 
-            private:
-                std::vector<std::size_t> indecies_{};
-                std::vector<BoundingBox> bounding_boxes_{};
-            };
-
-            class ChildContainer
-            {
-            public:
-                constexpr explicit ChildContainer(
-                    std::array<BoundingBox, 8> bounding_boxes, Tree* parent, std::size_t children_depth)
+                void insert(std::size_t index_in_tree, const BoundingBox& where) noexcept
                 {
-                    nodes_.reserve(8U);
-                    for (std::size_t i{}; i != 8; ++i) {
-                        nodes_.emplace_back(bounding_boxes[i], parent, children_depth);
+                    if (!_is_spilled() && inline_size_ != BucketSize) {
+                        indecies_[inline_size_] = index_in_tree;
+                        std::construct_at(_inline_bounding_box(inline_size_), where);
+                        ++inline_size_;
+                        return;
                     }
+
+                    if (!_is_spilled())
+                        _spill();
+
+                    overflow_indecies_.push_back(index_in_tree);
+                    overflow_bounding_boxes_.push_back(where);
                 }
 
-                [[nodiscard]] constexpr OctNode& operator[](std::size_t i) noexcept
+                [[nodiscard]] const BoundingBox& bounding_box_at(std::size_t index) const noexcept
                 {
-                    return nodes_[i];
+                    if (_is_spilled())
+                        return overflow_bounding_boxes_[index];
+                    return *_inline_bounding_box(index);
                 }
 
-                [[nodiscard]] constexpr const OctNode& operator[](std::size_t i) const noexcept
+                [[nodiscard]] std::size_t index_at(std::size_t index) const noexcept
                 {
-                    return nodes_[i];
+                    return begin()[index];
                 }
 
-                [[nodiscard]] constexpr auto begin() noexcept
+                //Only entries beyond BucketSize are allocated
+                [[nodiscard]] std::size_t allocated_bytes() const noexcept
                 {
-                    return nodes_.begin();
+                    return overflow_indecies_.capacity() * sizeof(std::size_t) +
+                           overflow_bounding_boxes_.capacity() * sizeof(BoundingBox);
                 }
 
-                [[nodiscard]] constexpr auto begin() const noexcept
+                void remap(const std::vector<std::size_t>& new_index_of) noexcept
                 {
-                    return nodes_.begin();
+                    auto* const first = _is_spilled() ? overflow_indecies_.data() : indecies_.data();
+                    for (auto* it = first; it != first + size(); ++it) {
+                        *it = new_index_of[*it];
+                    }
                 }
 
-                [[nodiscard]] constexpr auto end() noexcept
+                [[nodiscard]] const std::size_t* begin() const noexcept
                 {
-                    return nodes_.end();
+                    return _is_spilled() ? overflow_indecies_.data() : indecies_.data();
                 }
 
-                [[nodiscard]] constexpr auto end() const noexcept
+                [[nodiscard]] const std::size_t* end() const noexcept
                 {
-                    return nodes_.end();
+                    return begin() + size();
                 }
 
             private:
-                std::vector<OctNode> nodes_{};
-            };
-
-        public:
-            explicit constexpr OctNode(BoundingBox bounding_box, Tree* parent, std::size_t depth)
-                : tree_{parent},
-                  bounding_box_{std::move(bounding_box)},
-                  midpoint_{midpoint(bounding_box_)},
-                  radius_squared_{std::max({
-                      sq(get_x(bounding_box_.top_back_right) - get_x(bounding_box_.bottom_front_left)),
-                      sq(get_y(bounding_box_.top_back_right) - get_y(bounding_box_.bottom_front_left)),
-                      sq(get_z(bounding_box_.top_back_right) - get_z(bounding_box_.bottom_front_left)),
-                  })},
-                  depth_{depth}
-            {}
+                [[nodiscard]] bool _is_spilled() const noexcept
+                {
+                    return !overflow_indecies_.empty();
+                }
 
-            [[nodiscard]] constexpr BoundingBox bounding_box() const noexcept
-            {
-                return bounding_box_;
-            }
+                [[nodiscard]] BoundingBox* _inline_bounding_box(std::size_t index) noexcept
+                {
+                    return std::launder(reinterpret_cast<BoundingBox*>(bounding_box_storage_.data())) + index;
+                }
 
-            [[nodiscard]] constexpr bool has_children() const noexcept
-            {
-                return std::holds_alternative<ChildContainer>(indecies_or_children_);
-            }
+                [[nodiscard]] const BoundingBox* _inline_bounding_box(std::size_t index) const noexcept
+                {
+                    return std::launder(reinterpret_cast<const BoundingBox*>(bounding_box_storage_.data())) + index;
+                }
 
-            constexpr void insert(std::size_t index_in_tree, const BoundingBox& where) noexcept
-            {
-                ++size_;
+                void _spill() noexcept
+                {
+                    overflow_indecies_.reserve(BucketSize * 2U);
+                    overflow_bounding_boxes_.reserve(BucketSize * 2U);
 
-                if (has_children()) {
-                    _insert_into_children(index_in_tree, where);
-                    return;
+                    for (std::size_t i{}; i != inline_size_; ++i) {
+                        overflow_indecies_.push_back(indecies_[i]);
+                        overflow_bounding_boxes_.push_back(std::move(*_inline_bounding_box(i)));
+                    }
+                    _destroy_inline_bounding_boxes();
                 }
 
-                IndexContainer& bucket = std::get<IndexContainer>(indecies_or_children_);
+                void _copy_inline_bounding_boxes(const IndexContainer& other) noexcept
+                {
+                    for (; inline_size_ != other.inline_size_; ++inline_size_) {
+                        std::construct_at(_inline_bounding_box(inline_size_), *other._inline_bounding_box(inline_size_));
+                    }
+                }
 
-                if (bucket.is_full() && depth_ < MaxDepth) {
-                    _subdivide();
-                    _insert_into_children(index_in_tree, where);
-                    return;
+                void _move_inline_bounding_boxes(IndexContainer&& other) noexcept
+                {
+                    for (; inline_size_ != other.inline_size_; ++inline_size_) {
+                        auto& bounding_box = *other._inline_bounding_box(inline_size_);
+                        std::construct_at(_inline_bounding_box(inline_size_), std::move(bounding_box));
+                    }
+                    other._destroy_inline_bounding_boxes();
                 }
 
-                bucket.insert(index_in_tree, where);
-            }
+                void _destroy_inline_bounding_boxes() noexcept
+                {
+                    std::destroy_n(_inline_bounding_box(0U), inline_size_);
+                    inline_size_ = 0U;
+                }
 
-            [[nodiscard]] constexpr std::size_t size() const noexcept
-            {
-                return size_;
-            }
+                std::size_t inline_size_{};
+                std::vector<std::size_t, AllocatorFor<std::size_t>> overflow_indecies_{};
+                std::vector<BoundingBox, AllocatorFor<BoundingBox>> overflow_bounding_boxes_{};
+                std::array<std::size_t, BucketSize> indecies_{};
+                alignas(BoundingBox) std::array<std::byte, sizeof(BoundingBox) * BucketSize> bounding_box_storage_{};
+            };
 
-            constexpr void
-            find_closest(const Coordinate& where, std::optional<ClosestItem<Coordinate>>& maybe_closest_item) const noexcept
+            //Only children that contain elements are allocated. They are stored in the order of their index
+            class ChildContainer
             {
-                //Bail out if this node is empty
-                if (size() == 0U) [[unlikely]]
-                    return;
+            public:
+                constexpr ChildContainer() = default;
 
-                if (!has_children()) {
-                    _find_closest(where, maybe_closest_item);
-                    return;
+                [[nodiscard]] constexpr std::uint8_t occupancy() const noexcept
+                {
+                    return occupancy_;
                 }
 
-                const auto& children = std::get<ChildContainer>(indecies_or_children_);
-
-                for (const auto& child : children) {
-                    const auto child_distance_squared = distance_squared(child.midpoint_, where);
-                    if (child_distance_squared <= radius_squared_) [[unlikely]] {
-                        child.find_closest(where, maybe_closest_item);
-                    }
+                [[nodiscard]] constexpr std::size_t size() const noexcept
+                {
+                    return nodes_.size();
                 }
-            }
 
-            void debug_print(std::size_t depth) const noexcept
+                [[nodiscard]] constexpr std::size_t capacity() const noexcept
+                {
+                    return nodes_.capacity();
+                }
+
+                //Get the child with the given index, creating it if it does not exist yet
+                [[nodiscard]] constexpr OctNode&
+                get_or_create(std::size_t index, const OctNode& parent, const BoundingBox& bounding_box)
+                {
+                    const auto position = _position(index);
+
+                    if (!_is_occupied(index)) {
+                        occupancy_ |= static_cast<std::uint8_t>(1U << index);
+                        nodes_.emplace(
+                            nodes_.begin() + static_cast<std::ptrdiff_t>(position),
+                            bounding_box,
+                            parent.tree_,
+                            parent.depth_ + 1U);
+                        if constexpr (is_mixed_precision) {
+                            child_bounds_.insert(position, nodes_.size() - 1U, nodes_[position].bounds_);
+                        }
+                    }
+
+                    return nodes_[position];
+                }
+
+                constexpr void set(std::size_t index, OctNode&& node)
+                {
+                    const auto position = _position(index);
+
+                    if (_is_occupied(index)) {
+                        nodes_[position] = std::move(node);
+                        if constexpr (is_mixed_precision) {
+                            child_bounds_.set(position, nodes_[position].bounds_);
+                        }
+                        return;
+                    }
+
+                    occupancy_ |= static_cast<std::uint8_t>(1U << index);
+                    nodes_.insert(nodes_.begin() + static_cast<std::ptrdiff_t>(position), std::move(node));
+                    if constexpr (is_mixed_precision) {
+                        child_bounds_.insert(position, nodes_.size() - 1U, nodes_[position].bounds_);
+                    }
+                }
+
+                //Bounds of the children in the order of the children. Only available with OcTreePrecision::mixed
+                [[nodiscard]] constexpr const auto& child_bounds() const noexcept
+                {
+                    return child_bounds_;
+                }
+
+                [[nodiscard]] constexpr auto begin() noexcept
+                {
+                    return nodes_.begin();
+                }
+
+                [[nodiscard]] constexpr auto begin() const noexcept
+                {
+                    return nodes_.begin();
+                }
+
+                [[nodiscard]] constexpr auto end() noexcept
+                {
+                    return nodes_.end();
+                }
+
+                [[nodiscard]] constexpr auto end() const noexcept
+                {
+                    return nodes_.end();
+                }
+
+            private:
+                [[nodiscard]] constexpr bool _is_occupied(std::size_t index) const noexcept
+                {
+                    return (occupancy_ & (1U << index)) != 0U;
+                }
+
+                //Number of allocated children before the one with the given index
+                [[nodiscard]] constexpr std::size_t _position(std::size_t index) const noexcept
+                {
+                    return static_cast<std::size_t>(std::popcount(static_cast<std::uint8_t>(occupancy_ & ((1U << index) - 1U))));
+                }
+
+                std::vector<OctNode, AllocatorFor<OctNode>> nodes_{};
+                std::uint8_t occupancy_{};
+                //Searches get all lower bounds from here without touching the children themselves
+                [[no_unique_address]] std::conditional_t<is_mixed_precision, FloatBoundingBoxes, std::monostate> child_bounds_{};
+            };
+
+        public:
+            explicit constexpr OctNode(const BoundingBox& bounding_box, Tree* parent, std::size_t depth)
+                : tree_{parent}, bounds_{_to_node_bounds(bounding_box)}, midpoint_{midpoint(bounding_box)}, depth_{depth}
+            {}
+
+            [[nodiscard]] constexpr bool has_children() const noexcept
+            {
+                return std::holds_alternative<ChildContainer>(indecies_or_children_);
+            }
+
+            //Heap memory of this node and all nodes below it, not counting the node itself
+            [[nodiscard]] std::size_t allocated_bytes() const noexcept
+            {
+                if (!has_children())
+                    return indecies().allocated_bytes();
+
+                const auto& children = this->children();
+                auto bytes = children.capacity() * sizeof(OctNode);
+                for (const auto& child : children) {
+                    bytes += child.allocated_bytes();
+                }
+                return bytes;
+            }
+
+            [[nodiscard]] constexpr const ChildContainer& children() const noexcept
+            {
+                return std::get<ChildContainer>(indecies_or_children_);
+            }
+
+            [[nodiscard]] constexpr const IndexContainer& indecies() const noexcept
+            {
+                return std::get<IndexContainer>(indecies_or_children_);
+            }
+
+            //bounding_box are the exact bounds of this node
+            constexpr void insert(std::size_t index_in_tree, const BoundingBox& where, const BoundingBox& bounding_box) noexcept
+            {
+                ++size_;
+
+                if constexpr (!std::is_same_v<Aggregate, NoAggregate>) {
+                    aggregate_.add(tree_->elements_[index_in_tree]);
+                }
+
+                if (has_children()) {
+                    _insert_into_children(index_in_tree, where, bounding_box);
+                    return;
+                }
+
+                IndexContainer& bucket = std::get<IndexContainer>(indecies_or_children_);
+
+                if (bucket.is_full() && depth_ < MaxDepth) {
+                    _subdivide(bounding_box);
+                    _insert_into_children(index_in_tree, where, bounding_box);
+                    return;
+                }
+
+                tree_->_count_stored_entry(bucket.is_full());
+                bucket.insert(index_in_tree, where);
+            }
+
+            [[nodiscard]] constexpr std::size_t size() const noexcept
+            {
+                return size_;
+            }
+
+            [[nodiscard]] constexpr const Aggregate& aggregate() const noexcept
+            {
+                return aggregate_;
+            }
+
+            template <typename Visitor>
+            constexpr void
+            approximate(const Coordinate& where, Number opening_angle, Visitor& visitor, const BoundingBox& bounding_box) const
+            {
+                if (size() == 0U)
+                    return;
+
+                if (!has_children()) {
+                    for (const auto index : indecies()) {
+                        visitor(tree_->elements_[index]);
+                    }
+                    return;
+                }
+
+                //Barnes-Hut criterion: the node is far enough away if its size seen from where is smaller than the opening angle
+                const auto node_size_squared = std::max({
+                    sq(get_x(bounding_box.top_back_right) - get_x(bounding_box.bottom_front_left)),
+                    sq(get_y(bounding_box.top_back_right) - get_y(bounding_box.bottom_front_left)),
+                    sq(get_z(bounding_box.top_back_right) - get_z(bounding_box.bottom_front_left)),
+                });
+                const auto distance_squared_to_center = [&] {
+                    if constexpr (requires { { aggregate_.centroid() } -> std::convertible_to<Coordinate>; }) {
+                        return distance_squared(Coordinate{aggregate_.centroid()}, where);
+                    } else {
+                        return distance_squared(midpoint_, where);
+                    }
+                }();
+
+                if (!contains(bounding_box, where) && node_size_squared < sq(opening_angle) * distance_squared_to_center) {
+                    visitor(aggregate_);
+                    return;
+                }
+
+                _for_each_child_with_bounds(bounding_box, [&](const OctNode& child, const BoundingBox& child_bounding_box) {
+                    child.approximate(where, opening_angle, visitor, child_bounding_box);
+                });
+            }
+
+            /**
+            * \brief Visit all elements that might be closer to where than bound(), closest leaves first
+            *
+            * Distances are passed around as keys, see DistanceKey.
+            *
+            * \param where Point to search around
+            * \param accept Predicate that elements have to satisfy. It is checked before the distance is computed
+            * \param bound Returns the current search radius key, std::nullopt if it is unbounded. May shrink during the search
+            * \param offer Called with the index and distance key of every accepted element that might be within bound()
+            */
+            template <typename Predicate, typename Bound, typename Offer>
+            constexpr void visit_closest(const Coordinate& where, const Predicate& accept, const Bound& bound, Offer& offer) const
+            {
+                _visit_closest(where, _to_node_query(where), accept, bound, offer);
+            }
+
+            template <typename Predicate>
+            constexpr void find_closest(
+                const Coordinate& where, std::optional<ClosestItem<Coordinate>>& maybe_closest_item,
+                const Predicate& accept) const
+            {
+                const auto bound = [&]() -> std::optional<Number> {
+                    if (maybe_closest_item.has_value())
+                        return maybe_closest_item->distance;
+                    return std::nullopt;
+                };
+                auto offer = [&](std::size_t index, Number distance) { offer_closest(maybe_closest_item, index, distance); };
+
+                visit_closest(where, accept, bound, offer);
+            }
+
+            /**
+            * \brief Find the closest element to each point in queries, advancing GroupSize searches in turns
+            *
+            * Every search keeps an explicit stack of nodes. After a search has processed one node,
+            * the next node on its stack is prefetched and the next search takes its turn.
+            * This way, the memory latency of one search overlaps with the work of the others.
+            *
+            * \param root Node to start all searches at
+            * \param queries Points to search around
+            * \param results Receives the closest item of each query. Must have the same size as queries
+            */
+            template <std::size_t GroupSize>
+            static void find_closest_interleaved(
+                const OctNode& root, std::span<const Coordinate> queries,
+                std::span<std::optional<ClosestItem<Coordinate>>> results)
+            {
+                using Key = DistanceKey<GetDistance, typename Tree::ValueType, Coordinate>;
+
+                //Every node is visited in two turns: the first one prefetches the data that the second one works on
+                struct StackEntry
+                {
+                    Number lower_bound_squared;
+                    const OctNode* node;
+                    bool is_prefetched;
+                };
+
+                struct Search
+                {
+                    std::size_t query{};
+                    NodeQuery node_query{};
+                    std::vector<StackEntry> stack{};
+                };
+
+                std::array<Search, GroupSize> searches{};
+                std::size_t active_searches{};
+                std::size_t next_query{};
+
+                const auto start_next_query = [&](Search& search) {
+                    if (next_query == queries.size())
+                        return false;
+
+                    search.query = next_query++;
+                    search.stack.clear();
+                    search.node_query = _to_node_query(queries[search.query]);
+                    search.stack.push_back({root._lower_bound_squared(queries[search.query], search.node_query), &root, false});
+                    return true;
+                };
+
+                const auto step = [&](Search& search) {
+                    const auto& where = queries[search.query];
+                    auto& maybe_closest_item = results[search.query];
+
+                    const auto bound = [&]() -> std::optional<Number> {
+                        if (maybe_closest_item.has_value())
+                            return maybe_closest_item->distance;
+                        return std::nullopt;
+                    };
+                    const auto is_pruned = [&](Number lower_bound_squared) {
+                        return maybe_closest_item.has_value() &&
+                               Key::is_farther_than(lower_bound_squared, maybe_closest_item->distance);
+                    };
+
+                    auto& top = search.stack.back();
+                    if (top.node->size() == 0U || is_pruned(top.lower_bound_squared)) {
+                        search.stack.pop_back();
+                        return;
+                    }
+
+                    if (!top.is_prefetched) {
+                        top.node->_prefetch_contents();
+                        top.is_prefetched = true;
+                        return;
+                    }
+
+                    const auto* const node = top.node;
+                    search.stack.pop_back();
+
+                    if (!node->has_children()) {
+                        auto offer = [&](std::size_t index, Number distance) {
+                            offer_closest(maybe_closest_item, index, distance);
+                        };
+                        node->_scan_leaf(where, AcceptAll{}, bound, offer);
+                        return;
+                    }
+
+                    //Push the farthest child first so that the closest one is visited next
+                    std::array<std::pair<Number, const OctNode*>, 8> candidates{};
+                    const auto candidate_count = node->_sorted_children(where, search.node_query, candidates);
+                    for (auto i = candidate_count; i != 0U; --i) {
+                        const auto [child_lower_bound_squared, child] = candidates[i - 1U];
+                        if (!is_pruned(child_lower_bound_squared))
+                            search.stack.push_back({child_lower_bound_squared, child, false});
+                    }
+                };
+
+                for (; active_searches != GroupSize && start_next_query(searches[active_searches]); ++active_searches) {}
+                root._prefetch();
+
+                while (active_searches != 0U) {
+                    for (std::size_t i{}; i != active_searches;) {
+                        auto& search = searches[i];
+
+                        step(search);
+
+                        if (search.stack.empty() && !start_next_query(search)) {
+                            std::swap(search, searches[--active_searches]);
+                            continue;
+                        }
+
+                        if (const auto& next = search.stack.back(); !next.is_prefetched)
+                            next.node->_prefetch();
+                        ++i;
+                    }
+                }
+            }
+
+            void debug_print(std::size_t depth, const BoundingBox& bounding_box) const noexcept
             {
                 if (size() == 0)
                     return;
@@ -474,10 +1339,10 @@ namespace Raychel {
 
                 std::cerr << "Node{\n";
                 std::cerr << indent << " BoundingBox={\n";
-                std::cerr << indent << "  min={" << get_x(bounding_box_.bottom_front_left) << ", "
-                          << get_y(bounding_box_.bottom_front_left) << ", " << get_z(bounding_box_.bottom_front_left) << "},\n";
-                std::cerr << indent << "  max={" << get_x(bounding_box_.top_back_right) << ", "
-                          << get_y(bounding_box_.top_back_right) << ", " << get_z(bounding_box_.top_back_right) << "}\n";
+                std::cerr << indent << "  min={" << get_x(bounding_box.bottom_front_left) << ", "
+                          << get_y(bounding_box.bottom_front_left) << ", " << get_z(bounding_box.bottom_front_left) << "},\n";
+                std::cerr << indent << "  max={" << get_x(bounding_box.top_back_right) << ", "
+                          << get_y(bounding_box.top_back_right) << ", " << get_z(bounding_box.top_back_right) << "}\n";
                 std::cerr << indent << " },\n";
 
                 if (!has_children()) {
@@ -494,18 +1359,120 @@ namespace Raychel {
                     std::cerr << indent << " Children={\n";
                     const auto& children = std::get<ChildContainer>(indecies_or_children_);
 
-                    std::size_t index{};
-                    for (const auto& child : children) {
-                        ++index;
-                        if (child.size() == 0)
-                            continue;
-                        std::cerr << indent << ' ' << index - 1 << ": ";
-                        child.debug_print(depth + 1);
+                    auto child = children.begin();
+                    for (unsigned occupancy = children.occupancy(); occupancy != 0U; occupancy &= occupancy - 1U) {
+                        const auto child_index = static_cast<std::size_t>(std::countr_zero(occupancy));
+                        std::cerr << indent << ' ' << child_index << ": ";
+                        (child++)->debug_print(depth + 1, bounding_box_for(bounding_box, midpoint_, child_index));
                     }
                 }
                 std::cout << indent << "}\n";
             }
 
+            //Call f with every pair of child nodes (or a node and a child node) that may contain close enough elements
+            template <typename F>
+            static constexpr void
+            for_each_child_pair(const OctNode& a, const OctNode& b, Number max_distance_squared, F&& f) noexcept
+            {
+                if (&a == &b) {
+                    const auto& children = a.children();
+                    for (auto i = children.begin(); i != children.end(); ++i) {
+                        for (auto j = i; j != children.end(); ++j) {
+                            _offer_pair(*i, *j, max_distance_squared, f);
+                        }
+                    }
+                    return;
+                }
+
+                //Descend into the larger node first so that both sides of the pair shrink at a similar rate
+                if (a.has_children() && (!b.has_children() || a.depth_ <= b.depth_)) {
+                    for (const auto& child : a.children()) {
+                        _offer_pair(child, b, max_distance_squared, f);
+                    }
+                    return;
+                }
+
+                for (const auto& child : b.children()) {
+                    _offer_pair(a, child, max_distance_squared, f);
+                }
+            }
+
+            static constexpr void join(
+                const OctNode& a, const OctNode& b, Number max_distance_squared,
+                std::vector<std::pair<std::size_t, std::size_t>>& pairs) noexcept
+            {
+                if (!a.has_children() && !b.has_children()) {
+                    _join_leaves(a, b, max_distance_squared, pairs);
+                    return;
+                }
+
+                for_each_child_pair(a, b, max_distance_squared, [&](const OctNode& child_a, const OctNode& child_b) {
+                    join(child_a, child_b, max_distance_squared, pairs);
+                });
+            }
+
+            /**
+            * \brief Create a node twice as large as old_root, with old_root as one of its children
+            *
+            * The elements of old_root are not inserted again, old_root is moved into place as a whole.
+            *
+            * \param old_root node that becomes the child at old_root_index
+            * \param bounding_box exact bounds of old_root. Replaced by the bounds of the new node
+            * \param old_root_index index of old_root in the new node. Decides in which direction the node grows
+            */
+            [[nodiscard]] static constexpr OctNode
+            grow(OctNode&& old_root, BoundingBox& bounding_box, std::size_t old_root_index) noexcept
+            {
+                const auto old_box = bounding_box;
+
+                //The new midpoint is the corner that old_root shares with all of its new siblings
+                Coordinate min{old_box.bottom_front_left};
+                Coordinate max{old_box.top_back_right};
+                Coordinate new_midpoint{old_box.bottom_front_left};
+
+                const auto grow_axis = [](Number& axis_min, Number& axis_max, Number& axis_midpoint, bool old_is_upper) {
+                    //A flat tree would never grow, so it is given a size of one unit instead
+                    const auto extent = axis_max > axis_min ? axis_max - axis_min : Number{1};
+                    if (old_is_upper) {
+                        axis_midpoint = axis_min;
+                        axis_min -= extent;
+                    } else {
+                        axis_midpoint = axis_max;
+                        axis_max += extent;
+                    }
+                };
+                grow_axis(get_x(min), get_x(max), get_x(new_midpoint), (old_root_index & 1U) != 0U);
+                grow_axis(get_y(min), get_y(max), get_y(new_midpoint), (old_root_index & 2U) != 0U);
+                grow_axis(get_z(min), get_z(max), get_z(new_midpoint), (old_root_index & 4U) != 0U);
+
+                bounding_box = BoundingBox{min, max};
+
+                OctNode new_root{bounding_box, old_root.tree_, 0U};
+                new_root.midpoint_ = new_midpoint;
+                new_root.size_ = old_root.size_;
+                new_root.aggregate_ = old_root.aggregate_;
+
+                old_root.increase_depth();
+
+                ChildContainer children{};
+                children.set(old_root_index, std::move(old_root));
+                new_root.indecies_or_children_.template emplace<ChildContainer>(std::move(children));
+
+                return new_root;
+            }
+
+            constexpr void increase_depth() noexcept
+            {
+                ++depth_;
+
+                if (!has_children())
+                    return;
+
+                for (auto& child : std::get<ChildContainer>(indecies_or_children_)) {
+                    child.increase_depth();
+                }
+            }
+
             constexpr void update_parent(Tree* parent) noexcept
             {
                 tree_ = parent;
@@ -520,71 +1487,293 @@ namespace Raychel {
                 }
             }
 
-        private:
+            //Assign new indecies in the order the leaves are visited. Visiting children by their index gives Morton order
             constexpr void
-            _find_closest(const Coordinate& where, std::optional<ClosestItem<Coordinate>>& maybe_closest_item) const noexcept
+            collect_layout(std::vector<std::size_t>& new_index_of, std::vector<std::size_t>& permutation) const noexcept
+            {
+                if (has_children()) {
+                    for (const auto& child : std::get<ChildContainer>(indecies_or_children_)) {
+                        child.collect_layout(new_index_of, permutation);
+                    }
+                    return;
+                }
+
+                for (const auto index : std::get<IndexContainer>(indecies_or_children_)) {
+                    //Elements that overlap more than one leaf keep the position of the first one
+                    if (new_index_of[index] != std::numeric_limits<std::size_t>::max())
+                        continue;
+                    new_index_of[index] = permutation.size();
+                    permutation.push_back(index);
+                }
+            }
+
+            constexpr void remap_indecies(const std::vector<std::size_t>& new_index_of) noexcept
+            {
+                if (has_children()) {
+                    for (auto& child : std::get<ChildContainer>(indecies_or_children_)) {
+                        child.remap_indecies(new_index_of);
+                    }
+                    return;
+                }
+
+                std::get<IndexContainer>(indecies_or_children_).remap(new_index_of);
+            }
+
+        private:
+            [[nodiscard]] static NodeBounds _to_node_bounds(const BoundingBox& bounding_box) noexcept
+            {
+                if constexpr (is_mixed_precision) {
+                    return to_float_bounds(bounding_box);
+                } else {
+                    return bounding_box;
+                }
+            }
+
+            //Computed once per query, not once per node
+            [[nodiscard]] static NodeQuery _to_node_query(const Coordinate& where) noexcept
+            {
+                if constexpr (is_mixed_precision) {
+                    return to_float_query(where);
+                } else {
+                    return NodeQuery{};
+                }
+            }
+
+            //Lower bound of the squared distance from where to anything in this node
+            [[nodiscard]] Number _lower_bound_squared(const Coordinate& where, const NodeQuery& query) const noexcept
+            {
+                if constexpr (is_mixed_precision) {
+                    return conservative_distance_squared_to_box(bounds_, query, where);
+                } else {
+                    return distance_squared_to_box(bounds_, where);
+                }
+            }
+
+            [[nodiscard]] static Number _distance_squared_between(const OctNode& a, const OctNode& b) noexcept
+            {
+                if constexpr (is_mixed_precision) {
+                    //The float bounds contain the exact ones and rounding is monotonic, so this is never larger than
+                    //the distance between the exact bounds
+                    return distance_squared_between_boxes(
+                        from_float_bounds<Coordinate>(a.bounds_), from_float_bounds<Coordinate>(b.bounds_));
+                } else {
+                    return distance_squared_between_boxes(a.bounds_, b.bounds_);
+                }
+            }
+
+            template <typename F>
+            constexpr void _for_each_child_with_bounds(const BoundingBox& bounding_box, F&& f) const
+            {
+                const auto& children = this->children();
+
+                auto child = children.begin();
+                for (unsigned occupancy = children.occupancy(); occupancy != 0U; occupancy &= occupancy - 1U) {
+                    const auto child_index = static_cast<std::size_t>(std::countr_zero(occupancy));
+                    f(*child++, bounding_box_for(bounding_box, midpoint_, child_index));
+                }
+            }
+
+            template <typename Predicate, typename Bound, typename Offer>
+            constexpr void _visit_closest(
+                const Coordinate& where, const NodeQuery& query, const Predicate& accept, const Bound& bound, Offer& offer) const
+            {
+                using Key = DistanceKey<GetDistance, typename Tree::ValueType, Coordinate>;
+
+                //Bail out if this node is empty
+                if (size() == 0U) [[unlikely]]
+                    return;
+
+                count_octree_node_visit(depth_ + 1U);
+
+                if (!has_children()) {
+                    _scan_leaf(where, accept, bound, offer);
+                    return;
+                }
+
+                //Visit the closest children first so that the others can be skipped more often
+                std::array<std::pair<Number, const OctNode*>, 8> candidates{};
+                const auto candidate_count = _sorted_children(where, query, candidates);
+
+                for (std::size_t i{}; i != candidate_count; ++i) {
+                    const auto [lower_bound_squared, child] = candidates[i];
+                    const auto maybe_bound = bound();
+                    if (maybe_bound.has_value() && Key::is_farther_than(lower_bound_squared, *maybe_bound))
+                        break;
+                    child->_visit_closest(where, query, accept, bound, offer);
+                }
+            }
+
+            //Prefetch the members that are needed to decide what to do with this node
+            void _prefetch() const noexcept
+            {
+                prefetch(this);
+                //The active alternative is usually stored behind the alternatives themselves
+                RAYCHEL_PREFETCH(reinterpret_cast<const char*>(&indecies_or_children_) + sizeof(indecies_or_children_) - 1U);
+            }
+
+            //Prefetch the elements of a leaf, or the bounding boxes of the children of an inner node
+            void _prefetch_contents() const noexcept
+            {
+                if (!has_children()) {
+                    for (const auto index : indecies()) {
+                        prefetch(&tree_->elements_[index]);
+                    }
+                    return;
+                }
+
+                if constexpr (is_mixed_precision) {
+                    prefetch(&children().child_bounds());
+                } else {
+                    for (const auto& child : children()) {
+                        RAYCHEL_PREFETCH(&child.bounds_);
+                    }
+                }
+            }
+
+            template <typename Predicate, typename Bound, typename Offer>
+            constexpr void _scan_leaf(const Coordinate& where, const Predicate& accept, const Bound& bound, Offer& offer) const
             {
-                const auto& indecies = std::get<IndexContainer>(indecies_or_children_);
+                using Key = DistanceKey<GetDistance, typename Tree::ValueType, Coordinate>;
 
-                for (const auto index : indecies) {
-                    const auto distance = _get_distance(tree_->elements_[index], where);
+                const auto& bucket = indecies();
 
-                    if (!maybe_closest_item.has_value()) [[unlikely]] {
-                        maybe_closest_item.emplace(index, distance);
+                std::size_t distance_evaluations{};
+                for (std::size_t i{}; i != bucket.size(); ++i) {
+                    const auto index = bucket.index_at(i);
+                    const auto& element = tree_->elements_[index];
+                    if (!accept(element))
                         continue;
+
+                    //Only compute the exact distance of elements that might beat the current bound
+                    if constexpr (Key::check_lower_bound) {
+                        const auto maybe_bound = bound();
+                        if (maybe_bound.has_value() &&
+                            Key::is_farther_than(
+                                Key::lower_bound_squared(_get_distance, bucket.bounding_box_at(i), where), *maybe_bound))
+                            continue;
                     }
 
-                    if (distance < maybe_closest_item->distance) [[unlikely]] {
-                        maybe_closest_item->index = index;
-                        maybe_closest_item->distance = distance;
+                    offer(index, Key::of(_get_distance, element, where));
+                    ++distance_evaluations;
+                }
+                count_octree_leaf_scan(distance_evaluations);
+            }
+
+            //Store the children of this node in candidates, sorted by their distance to where. Returns the number of children
+            constexpr std::size_t
+            _sorted_children(
+                const Coordinate& where, const NodeQuery& query,
+                std::array<std::pair<Number, const OctNode*>, 8>& candidates) const noexcept
+            {
+                std::size_t candidate_count{};
+                if constexpr (is_mixed_precision) {
+                    std::array<Number, 8> lower_bounds_squared{};
+                    conservative_distances_squared_to_boxes(children().child_bounds(), query, where, lower_bounds_squared);
+                    for (const auto& child : children()) {
+                        candidates[candidate_count] = {lower_bounds_squared[candidate_count], &child};
+                        ++candidate_count;
+                    }
+                } else {
+                    for (const auto& child : children()) {
+                        candidates[candidate_count++] = {child._lower_bound_squared(where, query), &child};
                     }
                 }
+                std::sort(
+                    candidates.begin(),
+                    candidates.begin() + static_cast<std::ptrdiff_t>(candidate_count),
+                    [](const auto& a, const auto& b) { return a.first < b.first; });
+
+                return candidate_count;
             }
 
-            constexpr void _insert_into_children(std::size_t index_in_tree, const BoundingBox& where) noexcept
+            template <typename F>
+            static constexpr void _offer_pair(const OctNode& a, const OctNode& b, Number max_distance_squared, F& f) noexcept
             {
-                auto& children = std::get<ChildContainer>(indecies_or_children_);
+                if (a.size() == 0U || b.size() == 0U)
+                    return;
+                if (&a != &b && _distance_squared_between(a, b) > max_distance_squared)
+                    return;
+                f(a, b);
+            }
 
-                for (auto& child : children) {
-                    if (overlaps(where, child.bounding_box_))
-                        child.insert(index_in_tree, where);
+            static constexpr void _join_leaves(
+                const OctNode& a, const OctNode& b, Number max_distance_squared,
+                std::vector<std::pair<std::size_t, std::size_t>>& pairs) noexcept
+            {
+                const auto& indecies_a = a.indecies();
+                const auto& indecies_b = b.indecies();
+
+                for (std::size_t i{}; i != indecies_a.size(); ++i) {
+                    //Only look at each unordered pair once when joining a leaf with itself
+                    for (std::size_t j{&a == &b ? i + 1 : 0U}; j != indecies_b.size(); ++j) {
+                        const auto index_a = indecies_a.index_at(i);
+                        const auto index_b = indecies_b.index_at(j);
+
+                        //Elements that overlap both leaves would otherwise be paired with themselves
+                        if (index_a == index_b)
+                            continue;
+
+                        if (distance_squared_between_boxes(indecies_a.bounding_box_at(i), indecies_b.bounding_box_at(j)) >
+                            max_distance_squared)
+                            continue;
+
+                        pairs.emplace_back(std::min(index_a, index_b), std::max(index_a, index_b));
+                    }
                 }
             }
 
-            constexpr void _subdivide() noexcept
+            constexpr void
+            _insert_into_children(std::size_t index_in_tree, const BoundingBox& where, const BoundingBox& bounding_box) noexcept
+            {
+                _insert_into(std::get<ChildContainer>(indecies_or_children_), index_in_tree, where, bounding_box);
+            }
+
+            constexpr void _insert_into(
+                ChildContainer& children, std::size_t index_in_tree, const BoundingBox& where,
+                const BoundingBox& bounding_box) noexcept
+            {
+                const auto overlapped = overlapped_children(bounding_box, midpoint_, where);
+                //The entry of this node turns into one entry per overlapped child
+                if (overlapped != 0U)
+                    tree_->_count_duplicate_entries(static_cast<std::size_t>(std::popcount(overlapped)) - 1U);
+
+                for (unsigned mask = overlapped; mask != 0U; mask &= mask - 1U) {
+                    const auto child_index = static_cast<std::size_t>(std::countr_zero(mask));
+                    const auto child_bounding_box = bounding_box_for(bounding_box, midpoint_, child_index);
+                    children.get_or_create(child_index, *this, child_bounding_box)
+                        .insert(index_in_tree, where, child_bounding_box);
+                }
+            }
+
+            constexpr void _subdivide(const BoundingBox& bounding_box) noexcept
             {
                 //Save current items
                 auto items = std::get<IndexContainer>(std::move(indecies_or_children_));
+                tree_->_uncount_stored_entries(items.size());
 
-                //Create children
-                // Create 8 children, each with its own subdivision of the bounding box
-                ChildContainer children{subdivide_bounding_box(bounding_box_, midpoint_), tree_, depth_ + 1};
-
-                // Put the items into the children using their coordinates
-                // TODO: try doing this in one step while initializing the children
+                //Put the items into the children. Children are only created once something is put into them
+                ChildContainer children{};
                 for (std::size_t i{}; i != items.size(); ++i) {
-                    const auto& where = items.bounding_box_at(i);
-
-                    for (auto& child : children) {
-                        if (overlaps(where, child.bounding_box_))
-                            child.insert(items.index_at(i), where);
-                    }
+                    _insert_into(children, items.index_at(i), items.bounding_box_at(i), bounding_box);
                 }
 
                 indecies_or_children_.template emplace<ChildContainer>(std::move(children));
             }
 
-            std::variant<IndexContainer, ChildContainer> indecies_or_children_{};
+            //The small members come first so that traversal only touches the first cache lines of a node
             Tree* tree_;
 
-            BoundingBox bounding_box_;
+            NodeBounds bounds_;
             Coordinate midpoint_;
-            Number radius_squared_;
 
             std::size_t size_{};
             std::size_t depth_{};
 
+            [[no_unique_address]] Aggregate aggregate_{};
+
             GetDistance _get_distance{};
+
+            std::variant<IndexContainer, ChildContainer> indecies_or_children_{};
         };
 
     } // namespace details
@@ -606,18 +1795,111 @@ namespace Raychel {
         return BasicBoundingBox<Coord>{min, max};
     }
 
+    template <typename Tree, typename Quantized>
+    class CompactOcTree;
+
+    enum class OcTreeExecution {
+        sequential,
+        parallel,
+    };
+
+    enum class OcTreeBoundsPolicy {
+        //Elements that do not overlap the bounding box are rejected
+        fixed,
+        //The bounding box is doubled until it contains the whole element
+        grow,
+    };
+
+    enum class OcTreeLayout {
+        insertion_order,
+        morton_order,
+    };
+
+    enum class OcTreeBatchMode {
+        //Queries are answered one after the other
+        sequential,
+        //Several queries are advanced in turns so that their memory accesses overlap
+        interleaved,
+    };
+
+    enum class OcTreeRebuildMode {
+        //The tree is rebuilt by the call that finds it degraded
+        immediate,
+        //The tree is rebuilt on another thread and swapped in by a later call to rebuild_if_needed()
+        background,
+    };
+
+    //Cheap summary of how well the tree fits its elements. Counted while inserting, never by walking the tree
+    struct OcTreeQuality
+    {
+        [[nodiscard]] double duplication() const noexcept
+        {
+            return elements == 0U ? 1.0 : static_cast<double>(stored_entries) / static_cast<double>(elements);
+        }
+
+        [[nodiscard]] double overfull_fraction() const noexcept
+        {
+            return elements == 0U ? 0.0 : static_cast<double>(overfull_entries) / static_cast<double>(elements);
+        }
+
+        [[nodiscard]] double unordered_fraction() const noexcept
+        {
+            return elements == 0U ? 0.0 : static_cast<double>(unordered_elements) / static_cast<double>(elements);
+        }
+
+        std::size_t elements{};
+        //Elements that overlap several leaves are stored once per leaf
+        std::size_t stored_entries{};
+        //Entries beyond the first of each element. Elements outside of the tree may not be stored at all,
+        //so this is not the same as stored_entries - elements
+        std::size_t duplicate_entries{};
+        //Entries beyond BucketSize in leaves that cannot be subdivided any further
+        std::size_t overfull_entries{};
+        //Elements inserted since the tree was last built or reordered. They are not in Morton order
+        std::size_t unordered_elements{};
+    };
+
+    //A tree is degraded once any of the limits is exceeded. Duplication and overfull entries are measured
+    //relative to the quality right after the last build, so a tree that cannot get any better is not rebuilt again
+    struct OcTreeRebuildPolicy
+    {
+        //Smaller trees are never rebuilt
+        std::size_t min_size{1024U};
+        double max_duplication_growth{1.5};
+        double max_overfull_fraction{0.1};
+        double max_unordered_fraction{0.5};
+        OcTreeRebuildMode mode{OcTreeRebuildMode::immediate};
+    };
+
+    //GetDistance must never be less than the euclidean distance to the bounding box of the element.
+    //closest_to() relies on that to skip nodes that cannot contain a closer element.
+    //See details::SquaredDistance and details::DistanceLowerBound for optional members that make searches cheaper
+    //Allocator is used for the elements and, rebound, for the nodes. See HugePageAllocator for large trees
+    //With OcTreePrecision::mixed, nodes of trees with double coordinates are smaller and searches prune them in float.
+    //Queries return exactly the same results as with OcTreePrecision::exact
+    //StatisticsTag is never given explicitly. It keeps translation units with different RAYCHELCORE_OCTREE_STATISTICS
+    //modes from sharing the instantiations of the queries
     template <
         typename T, std::size_t BucketSize = 10, std::size_t MaxDepth = 20, Coordinate Coordinate = T,
         std::invocable<const T&> GetBoundingBox = details::BoundingBoxFromCoordinate,
-        std::invocable<const T&, const Coordinate&> GetDistance = details::GetDistanceToPoint>
-        requires(std::is_invocable_r_v<BasicBoundingBox<Coordinate>, GetBoundingBox, const T&>) && std::copyable<T>
+        std::invocable<const T&, const Coordinate&> GetDistance = details::GetDistanceToPoint,
+        OcTreeAggregate<T> Aggregate = details::NoAggregate, typename Allocator = std::allocator<T>,
+        OcTreePrecision Precision = OcTreePrecision::exact, typename StatisticsTag = details::OcTreeStatisticsTag>
+        requires(std::is_invocable_r_v<BasicBoundingBox<Coordinate>, GetBoundingBox, const T&>) && std::copyable<T> &&
+                (Precision == OcTreePrecision::exact || std::floating_point<details::ElementType<Coordinate>>)
     class OcTree
     {
-        using Node = details::OctNode<BucketSize, MaxDepth, Coordinate, GetDistance, OcTree>;
+        using Node = details::OctNode<BucketSize, MaxDepth, Coordinate, GetDistance, Aggregate, Allocator, Precision, OcTree>;
         using BoundingBox = BasicBoundingBox<Coordinate>;
+        using ValueType = T;
+        using CoordinateType = Coordinate;
+        using DistanceFunction = GetDistance;
 
         friend Node;
 
+        template <typename Tree, typename Quantized>
+        friend class CompactOcTree;
+
         template <typename Ref, typename Dist>
         struct ClosestItem
         {
@@ -625,41 +1907,80 @@ namespace Raychel {
             Dist distance;
         };
 
+        using QueryResult = ClosestItem<const T&, details::ElementType<Coordinate>>;
+        using DistanceKey = details::DistanceKey<GetDistance, T, Coordinate>;
+
     public:
-        constexpr OcTree(const Coordinate& a, const Coordinate& b, std::vector<T> items = {})
-            : root_{make_bounding_box(a, b), this, 0U}, elements_(std::move(items))
+        constexpr OcTree(
+            const Coordinate& a, const Coordinate& b, std::vector<T, Allocator> items = {},
+            OcTreeLayout layout = OcTreeLayout::insertion_order)
+            : bounding_box_{make_bounding_box(a, b)}, root_{bounding_box_, this, 0U}, elements_(std::move(items))
         {
             _build_from_items();
+
+            if (layout == OcTreeLayout::morton_order)
+                optimize_layout();
+
+            built_quality_ = quality();
         }
 
-        constexpr explicit OcTree(std::pair<Coordinate, Coordinate> bounding_box, std::vector<T> items = {})
-            : OcTree{bounding_box.first, bounding_box.second, std::move(items)}
+        constexpr explicit OcTree(
+            std::pair<Coordinate, Coordinate> bounding_box, std::vector<T, Allocator> items = {},
+            OcTreeLayout layout = OcTreeLayout::insertion_order)
+            : OcTree{bounding_box.first, bounding_box.second, std::move(items), layout}
         {}
 
-        constexpr OcTree(const OcTree& other) : root_{other.root_}, elements_{other.elements_}
+        //A background rebuild of other is not copied
+        OcTree(const OcTree& other)
+            : bounding_box_{other.bounding_box_},
+              root_{other.root_},
+              elements_{other.elements_},
+              bounds_policy_{other.bounds_policy_},
+              quality_{other.quality_},
+              built_quality_{other.built_quality_}
         {
             _root().update_parent(this);
         }
 
-        constexpr OcTree& operator=(const OcTree& other)
+        OcTree& operator=(const OcTree& other)
         {
+            bounding_box_ = other.bounding_box_;
             root_ = other.root_;
             elements_ = other.elements_;
+            bounds_policy_ = other.bounds_policy_;
+            quality_ = other.quality_;
+            built_quality_ = other.built_quality_;
+            //A pending rebuild of the old elements would be wrong now
+            pending_rebuild_ = {};
 
             _root().update_parent(this);
 
             return *this;
         }
 
-        constexpr OcTree(OcTree&& other) noexcept : root_{std::move(other.root_)}, elements_{std::move(other.elements_)}
+        OcTree(OcTree&& other) noexcept
+            : bounding_box_{other.bounding_box_},
+              root_{std::move(other.root_)},
+              elements_{std::move(other.elements_)},
+              bounds_policy_{other.bounds_policy_},
+              quality_{other.quality_},
+              built_quality_{other.built_quality_},
+              pending_rebuild_{std::move(other.pending_rebuild_)},
+              rebuild_snapshot_size_{other.rebuild_snapshot_size_}
         {
             _root().update_parent(this);
         }
 
-        constexpr OcTree& operator=(OcTree&& other) noexcept
+        OcTree& operator=(OcTree&& other) noexcept
         {
+            bounding_box_ = other.bounding_box_;
             root_ = std::move(other.root_);
             elements_ = std::move(other.elements_);
+            bounds_policy_ = other.bounds_policy_;
+            quality_ = other.quality_;
+            built_quality_ = other.built_quality_;
+            pending_rebuild_ = std::move(other.pending_rebuild_);
+            rebuild_snapshot_size_ = other.rebuild_snapshot_size_;
 
             _root().update_parent(this);
 
@@ -671,15 +1992,36 @@ namespace Raychel {
             return elements_.size();
         }
 
+        [[nodiscard]] constexpr BoundingBox bounding_box() const noexcept
+        {
+            return bounding_box_;
+        }
+
+        [[nodiscard]] constexpr OcTreeBoundsPolicy bounds_policy() const noexcept
+        {
+            return bounds_policy_;
+        }
+
+        //With OcTreeBoundsPolicy::grow, insert() grows the tree towards elements outside of it instead of rejecting them
+        constexpr void set_bounds_policy(OcTreeBoundsPolicy policy) noexcept
+        {
+            bounds_policy_ = policy;
+        }
+
         constexpr bool insert(T value)
         {
             const auto where = _get_bounding_box(value);
 
-            if (!details::overlaps(where, _root().bounding_box()))
+            if (bounds_policy_ == OcTreeBoundsPolicy::grow) {
+                if (!_grow_to_contain(where))
+                    return false;
+            } else if (!details::overlaps(where, bounding_box_)) {
                 return false;
+            }
 
             elements_.push_back(std::move(value));
-            _root().insert(elements_.size() - 1, where);
+            _root().insert(elements_.size() - 1, where, bounding_box_);
+            ++quality_.unordered_elements;
 
             return true;
         }
@@ -704,27 +2046,362 @@ namespace Raychel {
             return elements_.end();
         }
 
-        [[nodiscard]] constexpr auto closest_to(const Coordinate& where) const noexcept
-            -> std::optional<ClosestItem<const T&, details::ElementType<Coordinate>>>
+        [[nodiscard]] constexpr auto closest_to(const Coordinate& where) const noexcept -> std::optional<QueryResult>
+        {
+            return closest_to(where, details::AcceptAll{});
+        }
+
+        /**
+        * \brief Find the closest element that satisfies a predicate
+        *
+        * The predicate is checked while scanning the leaves, so rejected elements never need a second query.
+        * It receives a reference into the tree, so a specific element can be ignored by comparing addresses.
+        *
+        * \param where Point to search around
+        * \param accept Predicate that the returned element must satisfy
+        * \return The closest accepted element, or std::nullopt if no element was accepted
+        */
+        template <std::predicate<const T&> Predicate>
+        [[nodiscard]] constexpr auto closest_to(const Coordinate& where, const Predicate& accept) const
+            -> std::optional<QueryResult>
         {
             if (size() == 0) [[unlikely]]
                 return std::nullopt;
 
+            [[maybe_unused]] const details::OcTreeQueryScope statistics_scope{};
             std::optional<details::ClosestItem<Coordinate>> closest_item{};
 
-            _root().find_closest(where, closest_item);
+            _root().find_closest(where, closest_item, accept);
 
             if (!closest_item.has_value()) [[unlikely]]
                 return std::nullopt;
 
             const auto [index, distance] = closest_item.value();
 
-            return ClosestItem<const T&, details::ElementType<Coordinate>>{elements_[index], distance};
+            return QueryResult{elements_[index], DistanceKey::to_distance(distance)};
+        }
+
+        /**
+        * \brief Find the closest element to each of the given points
+        *
+        * The results are the same as calling closest_to() for each point. OcTreeBatchMode::interleaved pays off
+        * once the tree no longer fits into the cache, because the searches then mostly wait for memory.
+        *
+        * \tparam GroupSize Number of searches that are advanced in turns with OcTreeBatchMode::interleaved
+        * \param where Points to search around
+        * \param mode How the queries are executed
+        * \return The closest element to each point, in the same order as the points
+        */
+        template <std::size_t GroupSize = 8>
+        [[nodiscard]] std::vector<std::optional<QueryResult>>
+        closest_to_each(std::span<const Coordinate> where, OcTreeBatchMode mode = OcTreeBatchMode::interleaved) const
+        {
+            static_assert(GroupSize != 0U, "At least one search must be active at a time");
+
+            std::vector<std::optional<QueryResult>> results{};
+            results.reserve(where.size());
+
+            if (mode == OcTreeBatchMode::sequential) {
+                for (const auto& point : where) {
+                    results.push_back(closest_to(point));
+                }
+                return results;
+            }
+
+            std::vector<std::optional<details::ClosestItem<Coordinate>>> closest_items(where.size());
+            Node::template find_closest_interleaved<GroupSize>(_root(), where, closest_items);
+
+            for (const auto& maybe_closest_item : closest_items) {
+                if (!maybe_closest_item.has_value()) {
+                    results.emplace_back();
+                    continue;
+                }
+                const auto [index, distance] = *maybe_closest_item;
+                results.emplace_back(QueryResult{elements_[index], DistanceKey::to_distance(distance)});
+            }
+
+            return results;
+        }
+
+        /**
+        * \brief Find the k closest elements that satisfy a predicate
+        *
+        * \param where Point to search around
+        * \param k Maximum number of elements to return
+        * \param accept Predicate that the returned elements must satisfy
+        * \return At most k elements, closest first. Equally close elements are ordered by their position in the tree
+        */
+        template <std::predicate<const T&> Predicate = details::AcceptAll>
+        [[nodiscard]] std::vector<QueryResult>
+        k_closest_to(const Coordinate& where, std::size_t k, const Predicate& accept = {}) const
+        {
+            if (k == 0U)
+                return {};
+
+            [[maybe_unused]] const details::OcTreeQueryScope statistics_scope{};
+            std::vector<details::ClosestItem<Coordinate>> closest_items{};
+            closest_items.reserve(std::min(k, size()));
+
+            const auto bound = [&]() -> std::optional<details::ElementType<Coordinate>> {
+                if (closest_items.size() == k)
+                    return closest_items.front().distance;
+                return std::nullopt;
+            };
+            //Only elements that overlap more than one leaf are offered more than once
+            const auto has_duplicates = quality_.duplicate_entries != 0U;
+            auto offer = [&](std::size_t index, details::ElementType<Coordinate> distance) {
+                details::offer_k_closest(closest_items, k, index, distance, has_duplicates);
+            };
+
+            _root().visit_closest(where, accept, bound, offer);
+
+            std::sort_heap(closest_items.begin(), closest_items.end(), details::is_closer<Coordinate>);
+
+            return _to_query_results(closest_items);
+        }
+
+        /**
+        * \brief Find all elements that satisfy a predicate and are at most radius away from where
+        *
+        * \param where Point to search around
+        * \param radius Maximum distance of the returned elements, as measured by GetDistance
+        * \param accept Predicate that the returned elements must satisfy
+        * \return The elements, closest first. Equally close elements are ordered by their position in the tree
+        */
+        template <std::predicate<const T&> Predicate = details::AcceptAll>
+        [[nodiscard]] std::vector<QueryResult>
+        elements_within(const Coordinate& where, details::ElementType<Coordinate> radius, const Predicate& accept = {}) const
+        {
+            [[maybe_unused]] const details::OcTreeQueryScope statistics_scope{};
+            std::vector<details::ClosestItem<Coordinate>> items{};
+
+            const auto radius_key = DistanceKey::from_distance(radius);
+
+            const auto bound = [&]() -> std::optional<details::ElementType<Coordinate>> { return radius_key; };
+            auto offer = [&](std::size_t index, details::ElementType<Coordinate> distance) {
+                if (distance <= radius_key)
+                    items.emplace_back(index, distance);
+            };
+
+            _root().visit_closest(where, accept, bound, offer);
+
+            //Elements that overlap more than one leaf are found more than once
+            std::sort(items.begin(), items.end(), details::is_closer<Coordinate>);
+            items.erase(
+                std::unique(items.begin(), items.end(), [](const auto& a, const auto& b) { return a.index == b.index; }),
+                items.end());
+
+            return _to_query_results(items);
+        }
+
+        /**
+        * \brief Reorder the elements so that elements in the same leaf are stored next to each other
+        *
+        * Leaves are visited in Morton order, so spatially close leaves also end up close in memory.
+        * Elements that overlap more than one leaf are placed with the first leaf they are found in.
+        * Elements that do not overlap any leaf are moved to the back.
+        *
+        * A pending background rebuild is dropped.
+        *
+        * \return The permutation that was applied: the element now at index i was previously at index permutation[i]
+        */
+        std::vector<std::size_t> optimize_layout()
+        {
+            constexpr auto unassigned = std::numeric_limits<std::size_t>::max();
+
+            //A pending rebuild finds the elements inserted after it started by their index
+            pending_rebuild_ = {};
+
+            std::vector<std::size_t> new_index_of(elements_.size(), unassigned);
+            std::vector<std::size_t> permutation{};
+            permutation.reserve(elements_.size());
+
+            _root().collect_layout(new_index_of, permutation);
+
+            for (std::size_t i{}; i != elements_.size(); ++i) {
+                if (new_index_of[i] == unassigned) {
+                    new_index_of[i] = permutation.size();
+                    permutation.push_back(i);
+                }
+            }
+
+            std::vector<T, Allocator> elements{};
+            elements.reserve(elements_.size());
+            for (const auto old_index : permutation) {
+                elements.push_back(std::move(elements_[old_index]));
+            }
+            elements_ = std::move(elements);
+
+            _root().remap_indecies(new_index_of);
+            quality_.unordered_elements = 0U;
+
+            return permutation;
+        }
+
+        [[nodiscard]] constexpr OcTreeQuality quality() const noexcept
+        {
+            auto quality = quality_;
+            quality.elements = size();
+            return quality;
+        }
+
+        [[nodiscard]] bool needs_rebuild(const OcTreeRebuildPolicy& policy = {}) const noexcept
+        {
+            const auto current = quality();
+            if (current.elements < policy.min_size)
+                return false;
+
+            const auto new_overfull_entries =
+                current.overfull_entries - std::min(current.overfull_entries, built_quality_.overfull_entries);
+            const auto elements = static_cast<double>(current.elements);
+
+            return current.duplication() > built_quality_.duplication() * policy.max_duplication_growth ||
+                   static_cast<double>(new_overfull_entries) / elements > policy.max_overfull_fraction ||
+                   current.unordered_fraction() > policy.max_unordered_fraction;
+        }
+
+        /**
+        * \brief Build the tree again from its elements
+        *
+        * Trees that grow towards their elements are fitted to the elements again, fixed trees keep their bounding box.
+        * Like optimize_layout(), this reorders the elements into Morton order, so indecies into the tree are invalidated.
+        */
+        void rebuild()
+        {
+            //Whatever a pending rebuild would produce is replaced anyway
+            pending_rebuild_ = {};
+            _swap_in(_rebuilt(elements_, bounding_box(), bounds_policy_), elements_.size());
+        }
+
+        /**
+        * \brief Rebuild the tree if it has degraded according to policy
+        *
+        * In OcTreeRebuildMode::background, the first call that finds the tree degraded starts a rebuild from a copy
+        * of the elements on another thread. A later call swaps the new tree in once it is ready, after inserting all
+        * elements that were inserted in the meantime. Queries and inserts may continue until then.
+        * Destroying or reassigning the tree, or calling rebuild() or optimize_layout(), drops a pending rebuild without
+        * waiting for it.
+        *
+        * \return whether the tree was rebuilt by this call. Indecies into the tree are invalidated if it was
+        */
+        bool rebuild_if_needed(const OcTreeRebuildPolicy& policy = {})
+        {
+            if (rebuild_pending()) {
+                if (pending_rebuild_.wait_for(std::chrono::seconds{0}) != std::future_status::ready)
+                    return false;
+
+                _swap_in(std::move(*pending_rebuild_.get()), rebuild_snapshot_size_);
+                return true;
+            }
+
+            if (!needs_rebuild(policy))
+                return false;
+
+            if (policy.mode == OcTreeRebuildMode::immediate) {
+                rebuild();
+                return true;
+            }
+
+            std::packaged_task<std::unique_ptr<OcTree>()> task{
+                [elements = elements_, box = bounding_box(), bounds_policy = bounds_policy_]() mutable {
+                    return std::make_unique<OcTree>(_rebuilt(std::move(elements), box, bounds_policy));
+                }};
+            auto result = task.get_future();
+            //Unlike the future of std::async, this one does not wait for the task when it is dropped
+            std::thread{std::move(task)}.detach();
+
+            pending_rebuild_ = std::move(result);
+            rebuild_snapshot_size_ = elements_.size();
+            return false;
+        }
+
+        //Whether a background rebuild has been started and not swapped in yet
+        [[nodiscard]] bool rebuild_pending() const noexcept
+        {
+            return pending_rebuild_.valid();
+        }
+
+        /**
+        * \brief Find all pairs of elements whose bounding boxes overlap
+        *
+        * \param execution whether independent pairs of subtrees should be processed on multiple threads
+        * \return the indecies (i, j) of all overlapping elements with i < j, sorted in ascending order
+        */
+        [[nodiscard]] std::vector<std::pair<std::size_t, std::size_t>>
+        overlapping_pairs(OcTreeExecution execution = OcTreeExecution::sequential) const
+        {
+            return pairs_within(details::ElementType<Coordinate>{}, execution);
+        }
+
+        /**
+        * \brief Find all pairs of elements whose bounding boxes are at most max_distance apart
+        *
+        * Both sides of the pair are found by descending the tree simultaneously instead of running one query per element.
+        *
+        * \param max_distance maximum distance between the bounding boxes of the elements
+        * \param execution whether independent pairs of subtrees should be processed on multiple threads
+        * \return the indecies (i, j) of all matching elements with i < j, sorted in ascending order
+        */
+        [[nodiscard]] std::vector<std::pair<std::size_t, std::size_t>>
+        pairs_within(details::ElementType<Coordinate> max_distance, OcTreeExecution execution = OcTreeExecution::sequential) const
+        {
+            using IndexPair = std::pair<std::size_t, std::size_t>;
+
+            const auto max_distance_squared = details::sq(max_distance);
+            std::vector<IndexPair> pairs{};
+
+            if (execution == OcTreeExecution::sequential || !_root().has_children()) {
+                Node::join(_root(), _root(), max_distance_squared, pairs);
+            } else {
+                //Split the work into independent pairs of subtrees until there are enough tasks to keep all threads busy
+                const std::size_t thread_count = std::max(std::thread::hardware_concurrency(), 1U);
+
+                std::vector<std::pair<const Node*, const Node*>> tasks{{&_root(), &_root()}};
+                for (std::size_t level{}; level != 3U && tasks.size() < thread_count * 8U; ++level) {
+                    std::vector<std::pair<const Node*, const Node*>> next_tasks{};
+                    for (const auto& [a, b] : tasks) {
+                        if (!a->has_children() && !b->has_children()) {
+                            next_tasks.emplace_back(a, b);
+                            continue;
+                        }
+                        Node::for_each_child_pair(*a, *b, max_distance_squared, [&](const Node& child_a, const Node& child_b) {
+                            next_tasks.emplace_back(&child_a, &child_b);
+                        });
+                    }
+                    tasks = std::move(next_tasks);
+                }
+
+                std::atomic<std::size_t> next_task{0U};
+                std::vector<std::vector<IndexPair>> thread_pairs(thread_count);
+                std::vector<std::thread> threads{};
+                threads.reserve(thread_count);
+
+                for (std::size_t t{}; t != thread_count; ++t) {
+                    threads.emplace_back([&, t] {
+                        for (auto i = next_task++; i < tasks.size(); i = next_task++) {
+                            Node::join(*tasks[i].first, *tasks[i].second, max_distance_squared, thread_pairs[t]);
+                        }
+                    });
+                }
+                for (auto& thread : threads) {
+                    thread.join();
+                }
+
+                for (const auto& partial_pairs : thread_pairs) {
+                    pairs.insert(pairs.end(), partial_pairs.begin(), partial_pairs.end());
+                }
+            }
+
+            //Elements that overlap multiple leaves are found once for every pair of leaves they share
+            std::sort(pairs.begin(), pairs.end());
+            pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+            return pairs;
         }
 
         void debug_print() const noexcept
         {
-            _root().debug_print(0U);
+            _root().debug_print(0U, bounding_box_);
         }
 
         [[nodiscard]] constexpr const auto& elements() const noexcept
@@ -732,7 +2409,36 @@ namespace Raychel {
             return elements_;
         }
 
-        constexpr ~OcTree() noexcept = default;
+        //Bytes allocated through Allocator for the elements and the nodes. The OcTree object itself is not included
+        [[nodiscard]] std::size_t allocated_bytes() const noexcept
+        {
+            return elements_.capacity() * sizeof(T) + _root().allocated_bytes();
+        }
+
+        //Aggregate of all elements in the tree
+        [[nodiscard]] constexpr const Aggregate& aggregate() const noexcept
+        {
+            return _root().aggregate();
+        }
+
+        /**
+        * \brief Visit the tree with far away nodes replaced by their aggregate
+        *
+        * A node is replaced by its aggregate if its largest side divided by its distance to where is less than opening_angle.
+        * The distance is measured to the centroid() of the aggregate if it has one, to the center of the node otherwise.
+        * Elements that overlap multiple leaves are visited once per leaf.
+        *
+        * \param visitor Callable with either a const T& or a const Aggregate&
+        */
+        template <typename Visitor>
+            requires std::invocable<Visitor&, const T&> && std::invocable<Visitor&, const Aggregate&>
+        constexpr void
+        approximate(const Coordinate& where, details::ElementType<Coordinate> opening_angle, Visitor&& visitor) const
+        {
+            _root().approximate(where, opening_angle, visitor, bounding_box_);
+        }
+
+        ~OcTree() noexcept = default;
 
     private:
         [[nodiscard]] constexpr Node& _root() noexcept
@@ -745,19 +2451,127 @@ namespace Raychel {
             return root_;
         }
 
+        [[nodiscard]] std::vector<QueryResult> _to_query_results(const std::vector<details::ClosestItem<Coordinate>>& items) const
+        {
+            std::vector<QueryResult> results{};
+            results.reserve(items.size());
+            for (const auto& [index, distance] : items) {
+                results.push_back(QueryResult{elements_[index], DistanceKey::to_distance(distance)});
+            }
+            return results;
+        }
+
+        [[nodiscard]] static OcTree
+        _rebuilt(std::vector<T, Allocator> elements, BoundingBox bounding_box, OcTreeBoundsPolicy bounds_policy)
+        {
+            if (bounds_policy == OcTreeBoundsPolicy::grow && !elements.empty()) {
+                const GetBoundingBox get_bounding_box{};
+
+                bounding_box = get_bounding_box(elements.front());
+                for (const auto& element : elements) {
+                    bounding_box = details::union_of(bounding_box, get_bounding_box(element));
+                }
+            }
+
+            OcTree tree{
+                bounding_box.bottom_front_left, bounding_box.top_back_right, std::move(elements), OcTreeLayout::morton_order};
+            tree.bounds_policy_ = bounds_policy;
+            return tree;
+        }
+
+        //Elements from rebuilt_size onwards were inserted after the elements of new_tree were copied
+        void _swap_in(OcTree&& new_tree, std::size_t rebuilt_size)
+        {
+            for (std::size_t i{rebuilt_size}; i < elements_.size(); ++i) {
+                new_tree.insert(elements_[i]);
+            }
+
+            *this = std::move(new_tree);
+        }
+
+        constexpr void _count_stored_entry(bool is_overfull) noexcept
+        {
+            ++quality_.stored_entries;
+            if (is_overfull)
+                ++quality_.overfull_entries;
+        }
+
+        constexpr void _count_duplicate_entries(std::size_t count) noexcept
+        {
+            quality_.duplicate_entries += count;
+        }
+
+        constexpr void _uncount_stored_entries(std::size_t count) noexcept
+        {
+            quality_.stored_entries -= count;
+        }
+
         constexpr void _build_from_items() noexcept
         {
             if (elements_.empty())
                 return;
 
             for (std::size_t i{}; i != elements_.size(); ++i) {
-                _root().insert(i, _get_bounding_box(elements_[i]));
+                _root().insert(i, _get_bounding_box(elements_[i]), bounding_box_);
             }
         }
 
-        Node root_{};
-        std::vector<T> elements_{};
+        constexpr bool _grow_to_contain(const BoundingBox& where) noexcept
+        {
+            using Number = details::ElementType<Coordinate>;
+
+            const auto is_finite = [](const Coordinate& c) {
+                if constexpr (std::floating_point<Number>) {
+                    return std::isfinite(details::get_x(c)) && std::isfinite(details::get_y(c)) &&
+                           std::isfinite(details::get_z(c));
+                } else {
+                    return true;
+                }
+            };
+
+            if (!is_finite(where.bottom_front_left) || !is_finite(where.top_back_right))
+                return false;
+
+            //Every step doubles the size of the tree, so this limit is only reached for elements out of the representable range
+            constexpr auto max_steps = std::numeric_limits<Number>::digits + std::numeric_limits<Number>::max_exponent;
+            for (int step{}; step != max_steps; ++step) {
+                const auto& root_box = bounding_box_;
+                if (details::contains(root_box, where.bottom_front_left) && details::contains(root_box, where.top_back_right))
+                    return true;
+
+                //Grow towards the element on every axis. The old root is in the upper half of an axis if the element is below it
+                const auto root_center = details::midpoint(root_box);
+                const auto element_center = details::midpoint(where);
+
+                std::size_t old_root_index{};
+                if (details::get_x(element_center) < details::get_x(root_center))
+                    old_root_index |= 1U;
+                if (details::get_y(element_center) < details::get_y(root_center))
+                    old_root_index |= 2U;
+                if (details::get_z(element_center) < details::get_z(root_center))
+                    old_root_index |= 4U;
+
+                auto new_root = Node::grow(std::move(root_), bounding_box_, old_root_index);
+                root_ = std::move(new_root);
+            }
+
+            return false;
+        }
+
+        //Exact bounds of the root. Nodes only store the bounds that searches need
+        BoundingBox bounding_box_;
+        Node root_;
+        std::vector<T, Allocator> elements_{};
         GetBoundingBox _get_bounding_box{};
+        OcTreeBoundsPolicy bounds_policy_{OcTreeBoundsPolicy::fixed};
+
+        OcTreeQuality quality_{};
+        //Quality right after the last build. Degradation is measured against this
+        OcTreeQuality built_quality_{};
+
+        //OcTree is incomplete here, so the result is held by pointer
+        std::future<std::unique_ptr<OcTree>> pending_rebuild_{};
+        std::size_t rebuild_snapshot_size_{};
     };
 
 } //namespace Raychel
@@ -0,0 +1,120 @@
+/**
+* \file ReplicatedOcTree.h
+* \author Weckyy702 (weckyy702@gmail.com)
+* \brief Header file for ReplicatedOcTree class
+* \date 2023-02-24
+*
+* MIT License
+* Copyright (c) [2023] [Weckyy702 (weckyy702@gmail.com | https://github.com/Weckyy702)]
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+#ifndef RAYCHELCORE_REPLICATED_OCTREE_H
+#define RAYCHELCORE_REPLICATED_OCTREE_H
+
+#include "RaychelCore/HugePageAllocator.h"
+#include "RaychelCore/Raychel_assert.h"
+
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#if RAYCHEL_ACTIVE_OS == RAYCHEL_OS_LINUX
+    #include <sched.h>
+#endif
+
+namespace Raychel {
+
+    /**
+    * \brief Read-only copies of a tree, one per NUMA node
+    *
+    * Each copy is made by a thread that runs on the NUMA node it is meant for, so that its memory is local to that node.
+    * This works best with an allocator that uses NumaPolicy::local, like the default HugePageAllocator, which gives every
+    * NUMA node its own chunks so that no two copies share a huge page.
+    * Queries should go through local() so that they only touch memory of the node they run on.
+    *
+    * \tparam Tree Type of the replicated tree, e.g. an OcTree
+    */
+    template <typename Tree>
+    class ReplicatedOcTree
+    {
+    public:
+        explicit ReplicatedOcTree(const Tree& tree) : replicas_(numa_node_count())
+        {
+            if (replicas_.size() == 1U) {
+                replicas_.front() = std::make_unique<Tree>(tree);
+                return;
+            }
+
+            std::vector<std::thread> threads{};
+            threads.reserve(replicas_.size());
+            for (std::size_t node{}; node != replicas_.size(); ++node) {
+                threads.emplace_back([this, &tree, node] {
+                    _run_on_numa_node(node);
+                    replicas_[node] = std::make_unique<Tree>(tree);
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        }
+
+        [[nodiscard]] std::size_t replica_count() const noexcept
+        {
+            return replicas_.size();
+        }
+
+        [[nodiscard]] const Tree& replica(std::size_t numa_node) const noexcept
+        {
+            RAYCHEL_ASSERT(numa_node < replicas_.size());
+            return *replicas_[numa_node];
+        }
+
+        //Get the copy that belongs to the NUMA node the calling thread runs on
+        [[nodiscard]] const Tree& local() const noexcept
+        {
+            const auto node = current_numa_node();
+            return *replicas_[node < replicas_.size() ? node : 0U];
+        }
+
+    private:
+        static void _run_on_numa_node(std::size_t node)
+        {
+#if RAYCHEL_ACTIVE_OS == RAYCHEL_OS_LINUX
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            for (const auto cpu : cpus_of_numa_node(node)) {
+                if (cpu < CPU_SETSIZE)
+                    CPU_SET(cpu, &cpus);
+            }
+            //If this fails, the copy just ends up wherever the thread runs
+            if (CPU_COUNT(&cpus) != 0)
+                sched_setaffinity(0, sizeof(cpus), &cpus);
+#else
+            (void)node;
+#endif
+        }
+
+        std::vector<std::unique_ptr<Tree>> replicas_;
+    };
+
+} //namespace Raychel
+
+#endif //!RAYCHELCORE_REPLICATED_OCTREE_H
@@ -0,0 +1,311 @@
+/**
+* \file SmallAny.h
+* \author Weckyy702 (weckyy702@gmail.com)
+* \brief Header file for SmallAny and SmallPolymorphic classes
+* \date 2023-04-05
+*
+* MIT License
+* Copyright (c) [2023] [Weckyy702 (weckyy702@gmail.com | https://github.com/Weckyy702)]
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+#ifndef RAYCHELCORE_SMALL_ANY_H
+#define RAYCHELCORE_SMALL_ANY_H
+
+#include "Raychel_assert.h"
+#include "SmallBuffer.h"
+
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace Raychel {
+
+    /**
+    * \brief Value-semantic replacement for std::any that stores objects of up to BufferSize bytes inline
+    *
+    * Checking the type of the stored object compares a single pointer and does not need RTTI.
+    */
+    template <std::size_t BufferSize = 4 * sizeof(void*)>
+    class SmallAny
+    {
+        using Buffer = SmallBuffer<BufferSize>;
+
+    public:
+        SmallAny() noexcept = default;
+
+        //StatisticsTag keeps translation units with different RAYCHELCORE_SMALL_BUFFER_STATISTICS modes apart
+        template <typename T, typename U = std::decay_t<T>, typename StatisticsTag = details::SmallBufferStatisticsTag>
+        requires(!std::is_same_v<U, SmallAny> && std::is_copy_constructible_v<U> && std::is_constructible_v<U, T&&>)
+            SmallAny(T&& value) //NOLINT(google-explicit-constructor): mirror std::any
+        {
+            //Like std::any, arrays and functions are stored as pointers
+            buffer_.emplace(std::in_place_type<U>, std::forward<T>(value));
+        }
+
+        template <
+            typename T, typename... Args, typename U = std::decay_t<T>,
+            typename StatisticsTag = details::SmallBufferStatisticsTag>
+        requires(std::is_copy_constructible_v<U> && std::is_constructible_v<U, Args&&...>) U& emplace(Args&&... args)
+        {
+            return buffer_.emplace(std::in_place_type<U>, std::forward<Args>(args)...);
+        }
+
+        void reset() noexcept
+        {
+            buffer_.reset();
+        }
+
+        [[nodiscard]] bool has_value() const noexcept
+        {
+            return buffer_.has_value();
+        }
+
+        template <typename T>
+        [[nodiscard]] bool holds() const noexcept
+        {
+            return buffer_.template holds<T>();
+        }
+
+        //nullptr if the stored object is not a T
+        template <typename T>
+        [[nodiscard]] T* get_if() noexcept
+        {
+            return holds<T>() ? &buffer_.template unsafe_get_value<T>() : nullptr;
+        }
+
+        template <typename T>
+        [[nodiscard]] const T* get_if() const noexcept
+        {
+            return holds<T>() ? &buffer_.template unsafe_get_value<T>() : nullptr;
+        }
+
+        //The stored object must be a T
+        template <typename T>
+        [[nodiscard]] T& get() noexcept
+        {
+            RAYCHEL_ASSERT(holds<T>());
+            return buffer_.template unsafe_get_value<T>();
+        }
+
+        template <typename T>
+        [[nodiscard]] const T& get() const noexcept
+        {
+            RAYCHEL_ASSERT(holds<T>());
+            return buffer_.template unsafe_get_value<T>();
+        }
+
+        [[nodiscard]] bool is_heap() const noexcept
+        {
+            return buffer_.is_heap();
+        }
+
+    private:
+        Buffer buffer_{};
+    };
+
+    /**
+    * \brief Value-semantic replacement for std::unique_ptr<Base> that stores derived objects of up to BufferSize bytes inline
+    *
+    * Copying a SmallPolymorphic copies the derived object, so only copyable types can be stored.
+    * The stored object is accessed through Base, or through its exact type with get_if() and visit().
+    */
+    template <typename Base, std::size_t BufferSize = 4 * sizeof(void*)>
+        requires(std::is_class_v<Base>)
+    class SmallPolymorphic
+    {
+        using Buffer = SmallBuffer<BufferSize>;
+        using ToBase = const Base* (*)(const Buffer&) noexcept;
+
+    public:
+        SmallPolymorphic() noexcept = default;
+
+        //StatisticsTag keeps translation units with different RAYCHELCORE_SMALL_BUFFER_STATISTICS modes apart
+        template <typename T, typename U = std::remove_cvref_t<T>, typename StatisticsTag = details::SmallBufferStatisticsTag>
+        requires(std::derived_from<U, Base> && std::is_copy_constructible_v<U>)
+            SmallPolymorphic(T&& value) //NOLINT(google-explicit-constructor): mirror std::unique_ptr<Base>
+            : buffer_{std::forward<T>(value)}, to_base_{&_to_base<U>}
+        {}
+
+        SmallPolymorphic(const SmallPolymorphic&) = default;
+
+        SmallPolymorphic(SmallPolymorphic&& other) noexcept
+            : buffer_{std::move(other.buffer_)}, to_base_{std::exchange(other.to_base_, nullptr)}
+        {}
+
+        SmallPolymorphic& operator=(const SmallPolymorphic&) = default;
+
+        SmallPolymorphic& operator=(SmallPolymorphic&& other) noexcept
+        {
+            buffer_ = std::move(other.buffer_);
+            to_base_ = std::exchange(other.to_base_, nullptr);
+            return *this;
+        }
+
+        template <typename T, typename... Args, typename StatisticsTag = details::SmallBufferStatisticsTag>
+        requires(std::derived_from<T, Base> && std::is_copy_constructible_v<T> && std::is_constructible_v<T, Args&&...>)
+            T& emplace(Args&&... args)
+        {
+            //Reset first, so the object stays consistent if the constructor throws
+            reset();
+            auto& object = buffer_.emplace(std::in_place_type<T>, std::forward<Args>(args)...);
+            to_base_ = &_to_base<T>;
+            return object;
+        }
+
+        void reset() noexcept
+        {
+            buffer_.reset();
+            to_base_ = nullptr;
+        }
+
+        [[nodiscard]] bool has_value() const noexcept
+        {
+            return to_base_ != nullptr;
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return has_value();
+        }
+
+        //nullptr if empty
+        [[nodiscard]] Base* get() noexcept
+        {
+            return has_value() ? const_cast<Base*>(to_base_(buffer_)) : nullptr; //NOLINT(cppcoreguidelines-pro-type-const-cast)
+        }
+
+        [[nodiscard]] const Base* get() const noexcept
+        {
+            return has_value() ? to_base_(buffer_) : nullptr;
+        }
+
+        [[nodiscard]] Base& operator*() noexcept
+        {
+            RAYCHEL_ASSERT(has_value());
+            return *get();
+        }
+
+        [[nodiscard]] const Base& operator*() const noexcept
+        {
+            RAYCHEL_ASSERT(has_value());
+            return *get();
+        }
+
+        [[nodiscard]] Base* operator->() noexcept
+        {
+            return &**this;
+        }
+
+        [[nodiscard]] const Base* operator->() const noexcept
+        {
+            return &**this;
+        }
+
+        //Whether the stored object is of exactly type T, not just derived from it
+        template <typename T>
+        [[nodiscard]] bool holds() const noexcept
+        {
+            if constexpr (std::is_abstract_v<T>) {
+                return false;
+            } else {
+                return buffer_.template holds<T>();
+            }
+        }
+
+        template <typename T>
+        [[nodiscard]] T* get_if() noexcept
+        {
+            return holds<T>() ? &buffer_.template unsafe_get_value<T>() : nullptr;
+        }
+
+        template <typename T>
+        [[nodiscard]] const T* get_if() const noexcept
+        {
+            return holds<T>() ? &buffer_.template unsafe_get_value<T>() : nullptr;
+        }
+
+        [[nodiscard]] bool is_heap() const noexcept
+        {
+            return buffer_.is_heap();
+        }
+
+    private:
+        template <typename T>
+        static const Base* _to_base(const Buffer& buffer) noexcept
+        {
+            return &buffer.template unsafe_get_value<T>();
+        }
+
+        Buffer buffer_{};
+        ToBase to_base_{};
+    };
+
+    namespace details {
+
+        template <typename T>
+        struct IsSmallPolymorphic : std::false_type
+        {};
+
+        template <typename Base, std::size_t BufferSize>
+        struct IsSmallPolymorphic<SmallPolymorphic<Base, BufferSize>> : std::true_type
+        {};
+
+        template <typename T, typename... Rest, typename F, typename Value>
+        decltype(auto) visit_as(F& function, Value& value)
+        {
+            if (auto* object = value.template get_if<T>(); object != nullptr)
+                return std::invoke(function, *object);
+
+            if constexpr (sizeof...(Rest) != 0) {
+                return visit_as<Rest...>(function, value);
+            } else if constexpr (IsSmallPolymorphic<std::remove_const_t<Value>>::value) {
+                return std::invoke(function, *value);
+            } else {
+                RAYCHEL_ASSERT_NOT_REACHED;
+            }
+        }
+
+    } // namespace details
+
+    /**
+    * \brief Call function with the object stored in value as its exact type
+    *
+    * The types are checked in order, each check compares a single pointer. Calling function with the exact type
+    * lets the compiler inline it, which can be much faster than going through virtual functions in a hot loop.
+    * function must return the same type for every overload it is called with.
+    *
+    * \tparam Ts Types the stored object may have
+    * \param function Function to call
+    * \param value SmallAny or SmallPolymorphic. A SmallAny must hold one of Ts. A SmallPolymorphic that does not
+    *              is passed to function as a Base&. Neither may be empty
+    * \return The result of calling function
+    */
+    template <typename... Ts, typename F, typename Value>
+    requires(sizeof...(Ts) != 0) decltype(auto) visit(F&& function, Value& value)
+    {
+        RAYCHEL_ASSERT(value.has_value());
+        return details::visit_as<Ts...>(function, value);
+    }
+
+} //namespace Raychel
+
+#endif //!RAYCHELCORE_SMALL_ANY_H
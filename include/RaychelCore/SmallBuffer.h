@@ -30,7 +30,12 @@
 
 #include "ClassMacros.h"
 #include "Raychel_assert.h"
+#include "SmallBufferStatistics.h"
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
 #include <cstddef>
 #include <cstring>
 #include <memory>
@@ -39,51 +44,152 @@
 #include <utility>
 
 namespace Raychel {
+    /**
+    * \brief Whether objects of type T can be moved to a new address by copying their bytes
+    *
+    * True for trivially copyable types. Specialize this for types that do not point into themselves,
+    * e.g. types that only own heap memory, to let SmallBuffer move them with memcpy.
+    */
+    template <typename T>
+    struct is_trivially_relocatable : std::bool_constant<std::is_trivially_copyable_v<T>>
+    {};
+
+    template <typename T>
+    inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+    // clang-format off
+    //Where a SmallBuffer puts objects that do not fit inline. Same interface as std::pmr::memory_resource,
+    //but taken by value so stateless resources add no overhead. deallocate() must not throw
+    template <typename R>
+    concept SmallBufferResource = std::copyable<R> && requires(R r, void* ptr, std::size_t size, std::size_t alignment)
+    {
+        { r.allocate(size, alignment) } -> std::same_as<void*>;
+        r.deallocate(ptr, size, alignment);
+    };
+    // clang-format on
+
+    //Uses the global operator new and operator delete
+    struct NewDeleteResource
+    {
+        [[nodiscard]] static void* allocate(std::size_t size, std::size_t alignment)
+        {
+            if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+                return ::operator new(size, std::align_val_t{alignment});
+            return ::operator new(size);
+        }
+
+        static void deallocate(void* ptr, std::size_t size, std::size_t alignment) noexcept
+        {
+            if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+                ::operator delete(ptr, size, std::align_val_t{alignment});
+                return;
+            }
+            ::operator delete(ptr, size);
+        }
+    };
+
     namespace details {
+        //Everything a SmallBuffer needs to know about the type it stores. There is one static table per type
+        struct SmallBufferOperations
+        {
+            void (*destroy)(void*) noexcept;
+            //nullptr if the type is move-only. Only buffers that are not copyable store such types
+            void (*copy)(const void*, void*);
+            //Move-construct the object at src into dst, then destroy the object at src.
+            //nullptr if the type is trivially relocatable and can simply be copied byte by byte
+            void (*move)(void*, void*) noexcept;
+            std::size_t size;
+            std::size_t alignment;
+            bool is_nothrow_movable;
+        };
+
         template <typename T>
         struct SmallBufferImpl
         {
-            static void do_destroy(void* _ptr, bool do_delete) noexcept
+            static void do_destroy(void* ptr) noexcept
             {
-                auto* ptr = std::launder(reinterpret_cast<T*>(_ptr));
-                ptr->~T();
+                std::launder(reinterpret_cast<T*>(ptr))->~T();
+            }
+
+            static void do_copy([[maybe_unused]] const void* _src, [[maybe_unused]] void* dst)
+            {
+                if constexpr (std::is_copy_constructible_v<T>) {
+                    const auto* src = std::launder(reinterpret_cast<const T*>(_src));
 
-                if (do_delete)
-                    operator delete(ptr);
+                    ::new (dst) T(*src);
+                }
             }
 
-            static void do_copy(const void* _src, void* dst) noexcept
+            static void do_move(void* _src, void* dst) noexcept
             {
-                const auto* src = std::launder(reinterpret_cast<const T*>(_src));
+                auto* src = std::launder(reinterpret_cast<T*>(_src));
 
-                new (dst) T{*src};
+                ::new (dst) T(std::move(*src));
+                src->~T();
             }
+
+            static constexpr SmallBufferOperations operations{
+                &do_destroy,
+                std::is_copy_constructible_v<T> ? &do_copy : nullptr,
+                is_trivially_relocatable_v<T> ? nullptr : &do_move,
+                sizeof(T),
+                alignof(T),
+                std::is_nothrow_move_constructible_v<T> || is_trivially_relocatable_v<T>};
         };
     } // namespace details
 
-    template <std::size_t BufferSize>
+    /**
+    * \brief Type-erased storage for a single object
+    *
+    * Objects of up to BufferSize bytes with an alignment of up to Alignment are stored inline, larger ones on the heap.
+    * Apart from the storage itself, the only overhead is a pointer to the operations of the stored type.
+    * Moving a SmallBuffer never throws, so objects that might throw while being moved are always stored on the heap.
+    * Only copyable objects can be stored, unless IsCopyable is false. The buffer then cannot be copied itself,
+    * see MoveOnlySmallBuffer.
+    *
+    * Objects on the heap are allocated from Resource. A copy uses the resource of the copied buffer,
+    * copy assignment keeps the resource of the target. Moves take the resource along with the object, so they never allocate.
+    */
+    template <
+        std::size_t BufferSize, std::size_t Alignment = alignof(std::max_align_t),
+        SmallBufferResource Resource = NewDeleteResource, bool IsCopyable = true>
+        requires(std::has_single_bit(Alignment))
     class SmallBuffer
     {
-        using DestroyFunction = void (*)(void*, bool) noexcept;
-        using CopyFunction = void (*)(const void*, void*) noexcept;
+        using Operations = details::SmallBufferOperations;
 
     public:
-        SmallBuffer() = default;
+        template <typename T>
+        static constexpr bool stores_inline = sizeof(T) <= BufferSize && alignof(T) <= Alignment &&
+                                              (std::is_nothrow_move_constructible_v<T> || is_trivially_relocatable_v<T>);
 
         template <typename T>
+        static constexpr bool can_store = !IsCopyable || std::is_copy_constructible_v<T>;
+
+        SmallBuffer() = default;
+
+        template <typename T, typename StatisticsTag = details::SmallBufferStatisticsTag>
         requires(!std::is_same_v<std::remove_cvref_t<T>, SmallBuffer>) explicit SmallBuffer(T&& value)
         {
             emplace(std::forward<T>(value));
         }
 
-        SmallBuffer(SmallBuffer&& other) noexcept
-            : do_destroy_{other.do_destroy_}, do_copy_{other.do_copy_}, object_size_(other.object_size_)
+        //The resource is passed like an allocator to the standard containers
+        SmallBuffer(std::allocator_arg_t /*unused*/, Resource resource) noexcept : resource_{std::move(resource)}
+        {}
+
+        template <typename T, typename StatisticsTag = details::SmallBufferStatisticsTag>
+        SmallBuffer(std::allocator_arg_t /*unused*/, Resource resource, T&& value) : resource_{std::move(resource)}
+        {
+            emplace(std::forward<T>(value));
+        }
+
+        SmallBuffer(SmallBuffer&& other) noexcept : resource_{other.resource_}
         {
             _move(std::move(other));
         }
 
-        SmallBuffer(const SmallBuffer& other)
-            : do_destroy_{other.do_destroy_}, do_copy_{other.do_copy_}, object_size_{other.object_size_}
+        SmallBuffer(const SmallBuffer& other) requires IsCopyable : resource_{other.resource_}
         {
             _copy(other);
         }
@@ -94,78 +200,119 @@ namespace Raychel {
                 return *this;
 
             _destroy();
-
-            do_destroy_ = other.do_destroy_;
-            do_copy_ = other.do_copy_;
-            object_size_ = other.object_size_;
-
+            resource_ = other.resource_;
             _move(std::move(other));
 
             return *this;
         }
 
-        SmallBuffer& operator=(const SmallBuffer& other) noexcept
+        SmallBuffer& operator=(const SmallBuffer& other) requires IsCopyable
         {
             if (this == std::addressof(other))
                 return *this;
 
             _destroy();
-
-            do_destroy_ = other.do_destroy_;
-            do_copy_ = other.do_copy_;
-            object_size_ = other.object_size_;
-
             _copy(other);
 
             return *this;
         }
 
-        template <typename T>
-        requires std::is_copy_constructible_v<T> T& emplace(T&& value)
+        template <typename T, typename U = std::remove_cvref_t<T>, typename StatisticsTag = details::SmallBufferStatisticsTag>
+        requires(std::is_constructible_v<U, T&&> && can_store<U>) U& emplace(T&& value)
+        {
+            return emplace(std::in_place_type<U>, std::forward<T>(value));
+        }
+
+        //StatisticsTag is never given explicitly. It puts the RAYCHELCORE_SMALL_BUFFER_STATISTICS mode into the
+        //mangled name, so translation units with different modes never share an instantiation of emplace
+        template <typename U, typename... Args, typename StatisticsTag = details::SmallBufferStatisticsTag>
+        requires(std::is_constructible_v<U, Args&&...> && can_store<U>)
+            U& emplace(std::in_place_type_t<U> /*unused*/, Args&&... args)
         {
-            object_size_ = sizeof(T);
             _destroy();
 
-            if constexpr (sizeof(T) <= BufferSize) {
-                ptr_ = &buffer_;
+            if constexpr (stores_inline<U>) {
+                ::new (storage_.buffer.data()) U(std::forward<Args>(args)...);
             } else {
-                ptr_ = operator new(object_size_);
+                void* ptr = _allocate(details::SmallBufferImpl<U>::operations);
+                try {
+                    ::new (ptr) U(std::forward<Args>(args)...);
+                } catch (...) {
+                    _deallocate(ptr, details::SmallBufferImpl<U>::operations);
+                    throw;
+                }
+                storage_.heap_object = ptr;
             }
+            operations_ = &details::SmallBufferImpl<U>::operations;
+            details::count_small_buffer_store<SmallBuffer, U>(BufferSize, Alignment, !stores_inline<U>);
 
-            ::new (ptr_) T{std::forward<T>(value)};
-            do_destroy_ = details::SmallBufferImpl<T>::do_destroy;
-            do_copy_ = details::SmallBufferImpl<T>::do_copy;
-
-            return unsafe_get_value<T>();
+            return unsafe_get_value<U>();
         }
 
+        //T must be the type of the stored object. Where it lives is known at compile time, so this does not branch
         template <typename T>
         [[nodiscard]] T& unsafe_get_value() noexcept
         {
-            RAYCHEL_ASSERT(ptr_ != nullptr);
-            return *std::launder(reinterpret_cast<T*>(ptr_));
+            RAYCHEL_ASSERT(operations_ != nullptr);
+            if constexpr (stores_inline<T>) {
+                return *std::launder(reinterpret_cast<T*>(storage_.buffer.data()));
+            } else {
+                return *static_cast<T*>(storage_.heap_object);
+            }
         }
 
         template <typename T>
         [[nodiscard]] const T& unsafe_get_value() const noexcept
         {
-            RAYCHEL_ASSERT(ptr_ != nullptr);
-            return *std::launder(reinterpret_cast<const T*>(ptr_));
+            RAYCHEL_ASSERT(operations_ != nullptr);
+            if constexpr (stores_inline<T>) {
+                return *std::launder(reinterpret_cast<const T*>(storage_.buffer.data()));
+            } else {
+                return *static_cast<const T*>(storage_.heap_object);
+            }
         }
 
         [[nodiscard]] void* unsafe_get_ptr() noexcept
         {
-            return ptr_;
+            if (operations_ == nullptr)
+                return nullptr;
+            return is_heap() ? storage_.heap_object : storage_.buffer.data();
         }
 
         [[nodiscard]] const void* unsafe_get_ptr() const noexcept
         {
-            return ptr_;
+            if (operations_ == nullptr)
+                return nullptr;
+            return is_heap() ? storage_.heap_object : storage_.buffer.data();
         }
 
+        //Whether the stored object lives on the heap. False if the buffer is empty
         [[nodiscard]] bool is_heap() const noexcept
         {
-            return ptr_ != &buffer_;
+            return operations_ != nullptr && !_is_inline(*operations_);
+        }
+
+        //Whether the stored object is of exactly type T. This only compares the address of the operations table,
+        //which is unique per type within a program, but may not be across shared library boundaries
+        template <typename T>
+        [[nodiscard]] bool holds() const noexcept
+        {
+            return operations_ == &details::SmallBufferImpl<T>::operations;
+        }
+
+        [[nodiscard]] bool has_value() const noexcept
+        {
+            return operations_ != nullptr;
+        }
+
+        void reset() noexcept
+        {
+            _destroy();
+        }
+
+        [[nodiscard]] const Resource& resource() const noexcept
+        {
+            return resource_;
         }
 
         ~SmallBuffer() noexcept
@@ -174,43 +321,96 @@ namespace Raychel {
         }
 
     private:
+        //Objects that do not fit are allocated on the heap, and the pointer to them is stored instead
+        union Storage
+        {
+            void* heap_object;
+            alignas(Alignment) std::array<std::byte, BufferSize> buffer;
+        };
+
+        //Same as stores_inline<T> for the type the operations belong to
+        [[nodiscard]] static bool _is_inline(const Operations& operations) noexcept
+        {
+            return operations.size <= BufferSize && operations.alignment <= Alignment && operations.is_nothrow_movable;
+        }
+
+        [[nodiscard]] void* _allocate(const Operations& operations)
+        {
+            return resource_.allocate(operations.size, operations.alignment);
+        }
+
+        void _deallocate(void* ptr, const Operations& operations) noexcept
+        {
+            resource_.deallocate(ptr, operations.size, operations.alignment);
+        }
+
+        //Get uninitialized memory for an object with the given operations
+        [[nodiscard]] void* _storage_for(const Operations& operations)
+        {
+            if (_is_inline(operations))
+                return storage_.buffer.data();
+
+            storage_.heap_object = _allocate(operations);
+            return storage_.heap_object;
+        }
+
         void _destroy() noexcept
         {
-            if (ptr_ == nullptr)
+            if (operations_ == nullptr)
                 return;
-            do_destroy_(ptr_, is_heap());
+
+            void* ptr = unsafe_get_ptr();
+            operations_->destroy(ptr);
+            if (is_heap())
+                _deallocate(ptr, *operations_);
+
+            operations_ = nullptr;
         }
 
-        void _copy(const SmallBuffer& other) noexcept
+        void _copy(const SmallBuffer& other)
         {
-            if (!other.is_heap()) {
-                ptr_ = &buffer_;
-            } else {
-                ptr_ = operator new(object_size_);
-            }
+            if (other.operations_ == nullptr)
+                return;
 
-            do_copy_(other.ptr_, ptr_);
+            const auto& operations = *other.operations_;
+            void* ptr = _storage_for(operations);
+            try {
+                operations.copy(other.unsafe_get_ptr(), ptr);
+            } catch (...) {
+                if (!_is_inline(operations))
+                    _deallocate(ptr, operations);
+                throw;
+            }
+            operations_ = &operations;
         }
 
         void _move(SmallBuffer&& other) noexcept
         {
-            if (!other.is_heap()) {
-                ptr_ = &buffer_;
-                std::memcpy(ptr_, other.ptr_, object_size_);
-                std::memset(other.ptr_, 0, object_size_);
+            if (other.operations_ == nullptr)
+                return;
+
+            const auto& operations = *other.operations_;
+            if (!_is_inline(operations)) {
+                storage_.heap_object = other.storage_.heap_object;
+            } else if (operations.move == nullptr) {
+                std::memcpy(storage_.buffer.data(), other.storage_.buffer.data(), operations.size);
             } else {
-                ptr_ = other.ptr_;
+                operations.move(other.storage_.buffer.data(), storage_.buffer.data());
             }
 
-            other.ptr_ = nullptr;
+            operations_ = std::exchange(other.operations_, nullptr);
         }
 
-        void* ptr_{};
-        DestroyFunction do_destroy_{};
-        CopyFunction do_copy_{};
-        std::size_t object_size_{};
-        std::aligned_storage_t<BufferSize> buffer_{};
+        Storage storage_{};
+        const Operations* operations_{};
+        [[no_unique_address]] Resource resource_{};
     };
+
+    //SmallBuffer that can also store move-only objects. It cannot be copied itself
+    template <
+        std::size_t BufferSize, std::size_t Alignment = alignof(std::max_align_t),
+        SmallBufferResource Resource = NewDeleteResource>
+    using MoveOnlySmallBuffer = SmallBuffer<BufferSize, Alignment, Resource, false>;
 } // namespace Raychel
 
 #endif //!RAYCHELCORE_SMALL_BUFFER_H
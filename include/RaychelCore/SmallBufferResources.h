@@ -0,0 +1,185 @@
+/**
+* \file SmallBufferResources.h
+* \author Weckyy702 (weckyy702@gmail.com)
+* \brief Header file for SmallBuffer overflow resources
+* \date 2023-03-30
+*
+* MIT License
+* Copyright (c) [2023] [Weckyy702 (weckyy702@gmail.com | https://github.com/Weckyy702)]
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+#ifndef RAYCHELCORE_SMALL_BUFFER_RESOURCES_H
+#define RAYCHELCORE_SMALL_BUFFER_RESOURCES_H
+
+#include "ClassMacros.h"
+#include "Raychel_assert.h"
+#include "SmallBuffer.h"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+
+namespace Raychel {
+
+    //Allocates from a std::pmr::memory_resource, which must outlive every buffer that uses it
+    class PmrResource
+    {
+    public:
+        PmrResource() noexcept = default;
+
+        //NOLINTNEXTLINE(google-explicit-constructor): mirror std::pmr::polymorphic_allocator
+        PmrResource(std::pmr::memory_resource* resource) noexcept : resource_{resource}
+        {
+            RAYCHEL_ASSERT(resource_ != nullptr);
+        }
+
+        [[nodiscard]] void* allocate(std::size_t size, std::size_t alignment)
+        {
+            return resource_->allocate(size, alignment);
+        }
+
+        void deallocate(void* ptr, std::size_t size, std::size_t alignment) noexcept
+        {
+            resource_->deallocate(ptr, size, alignment);
+        }
+
+        [[nodiscard]] std::pmr::memory_resource* resource() const noexcept
+        {
+            return resource_;
+        }
+
+    private:
+        std::pmr::memory_resource* resource_{std::pmr::get_default_resource()};
+    };
+
+    namespace details {
+
+        //Free lists of recently released blocks, one per power-of-two size class. Only ever touched by the owning thread
+        class ThreadLocalPool
+        {
+        public:
+            static constexpr std::size_t min_block_size = 16U;
+            static constexpr std::size_t size_classes = 7U;
+            static constexpr std::size_t max_block_size = min_block_size << (size_classes - 1U);
+            //Blocks beyond this are returned to operator delete, so a thread that only frees cannot hoard memory
+            static constexpr std::size_t max_cached_blocks = 64U;
+
+            ThreadLocalPool() = default;
+
+            RAYCHEL_MAKE_NONCOPY_NONMOVE(ThreadLocalPool)
+
+            [[nodiscard]] static std::size_t size_class(std::size_t size) noexcept
+            {
+                if (size <= min_block_size)
+                    return 0U;
+                return static_cast<std::size_t>(std::bit_width(size - 1U) - std::bit_width(min_block_size - 1U));
+            }
+
+            [[nodiscard]] void* allocate(std::size_t size)
+            {
+                const auto index = size_class(size);
+                if (auto* block = free_lists_[index]; block != nullptr) {
+                    free_lists_[index] = block->next;
+                    --cached_blocks_[index];
+                    return block;
+                }
+                return ::operator new(min_block_size << index);
+            }
+
+            void deallocate(void* ptr, std::size_t size) noexcept
+            {
+                const auto index = size_class(size);
+                if (cached_blocks_[index] == max_cached_blocks) {
+                    ::operator delete(ptr, min_block_size << index);
+                    return;
+                }
+                free_lists_[index] = ::new (ptr) FreeBlock{free_lists_[index]};
+                ++cached_blocks_[index];
+            }
+
+            ~ThreadLocalPool() noexcept
+            {
+                for (std::size_t index{}; index != size_classes; ++index) {
+                    while (auto* block = free_lists_[index]) {
+                        free_lists_[index] = block->next;
+                        ::operator delete(block, min_block_size << index);
+                    }
+                }
+            }
+
+        private:
+            struct FreeBlock
+            {
+                FreeBlock* next;
+            };
+
+            std::array<FreeBlock*, size_classes> free_lists_{};
+            std::array<std::size_t, size_classes> cached_blocks_{};
+        };
+
+        [[nodiscard]] inline ThreadLocalPool& thread_local_pool() noexcept
+        {
+            thread_local ThreadLocalPool pool{};
+            return pool;
+        }
+
+    } // namespace details
+
+    /**
+    * \brief Recycles small heap blocks through a free list per thread instead of going through the global allocator
+    *
+    * Blocks of up to details::ThreadLocalPool::max_block_size bytes are rounded up to a power of two and kept in a free list
+    * of the calling thread when released, so spills neither lock nor contend. A block may be released on a different thread
+    * than the one that allocated it; it then simply joins the free list of the releasing thread.
+    * Larger or over-aligned objects go to NewDeleteResource.
+    *
+    * Buffers using this resource must not be destroyed after the calling thread's thread_local objects,
+    * i.e. they should not be thread_local themselves.
+    */
+    struct ThreadLocalPoolResource
+    {
+        [[nodiscard]] static void* allocate(std::size_t size, std::size_t alignment)
+        {
+            if (!_is_pooled(size, alignment))
+                return NewDeleteResource::allocate(size, alignment);
+            return details::thread_local_pool().allocate(size);
+        }
+
+        static void deallocate(void* ptr, std::size_t size, std::size_t alignment) noexcept
+        {
+            if (!_is_pooled(size, alignment)) {
+                NewDeleteResource::deallocate(ptr, size, alignment);
+                return;
+            }
+            details::thread_local_pool().deallocate(ptr, size);
+        }
+
+    private:
+        [[nodiscard]] static bool _is_pooled(std::size_t size, std::size_t alignment) noexcept
+        {
+            return size <= details::ThreadLocalPool::max_block_size && alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+        }
+    };
+
+} //namespace Raychel
+
+#endif //!RAYCHELCORE_SMALL_BUFFER_RESOURCES_H
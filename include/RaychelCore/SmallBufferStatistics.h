@@ -0,0 +1,271 @@
+/**
+* \file SmallBufferStatistics.h
+* \author Weckyy702 (weckyy702@gmail.com)
+* \brief Header file for SmallBuffer spill statistics
+* \date 2023-04-08
+*
+* MIT License
+* Copyright (c) [2023] [Weckyy702 (weckyy702@gmail.com | https://github.com/Weckyy702)]
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+#ifndef RAYCHELCORE_SMALL_BUFFER_STATISTICS_H
+#define RAYCHELCORE_SMALL_BUFFER_STATISTICS_H
+
+#include "ClassMacros.h"
+#include "compat.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+//Define RAYCHELCORE_SMALL_BUFFER_STATISTICS to 1 to count how often SmallBuffer::emplace has to allocate.
+//Everything that depends on it lives in an inline namespace, and every function template that may count a store
+//takes a defaulted template parameter of type details::SmallBufferStatisticsTag from that namespace, so translation
+//units may use different values
+#ifndef RAYCHELCORE_SMALL_BUFFER_STATISTICS
+    #define RAYCHELCORE_SMALL_BUFFER_STATISTICS 0
+#endif
+
+namespace Raychel {
+
+    //Objects of one type emplaced into one SmallBuffer instantiation
+    struct SmallBufferSpillStatistics
+    {
+        std::string_view buffer;
+        std::string_view type;
+        std::size_t buffer_size{};
+        std::size_t buffer_alignment{};
+        std::size_t object_size{};
+        std::size_t object_alignment{};
+        //Objects emplaced in total
+        std::size_t stores{};
+        //Objects that had to be allocated on the heap
+        std::size_t spills{};
+    };
+
+    namespace details {
+#if RAYCHELCORE_SMALL_BUFFER_STATISTICS
+        inline namespace with_small_buffer_statistics {
+#else
+        inline namespace without_small_buffer_statistics {
+#endif
+
+        inline constexpr bool collect_small_buffer_statistics = RAYCHELCORE_SMALL_BUFFER_STATISTICS;
+
+        //Default template argument of everything that may count a store, see above
+        struct SmallBufferStatisticsTag
+        {};
+
+        //Readable name of T, taken from the signature of this function
+        template <typename T>
+        [[nodiscard]] std::string_view type_name() noexcept
+        {
+            const std::string_view signature = RAYCHEL_FUNC_NAME;
+#if RAYCHEL_ACTIVE_COMPILER == RAYCHEL_COMPILER_GCC || RAYCHEL_ACTIVE_COMPILER == RAYCHEL_COMPILER_CLANG
+            //GCC: "... [with T = int; ...]", clang: "... [T = int]"
+            const auto start = signature.find("T = ");
+            if (start == std::string_view::npos)
+                return signature;
+
+            auto end = signature.find(';', start);
+            if (end == std::string_view::npos)
+                end = signature.rfind(']');
+            return signature.substr(start + 4U, end - start - 4U);
+#else
+            return signature;
+#endif
+        }
+
+        //One per combination of SmallBuffer instantiation and stored type. Registers itself with the registry.
+        //Trivially destructible, so it can still be read while the registry prints at exit
+        struct SmallBufferSite
+        {
+            explicit SmallBufferSite(const SmallBufferSpillStatistics& _info);
+
+            //stores and spills are only counted below
+            SmallBufferSpillStatistics info;
+            std::atomic_size_t stores{};
+            std::atomic_size_t spills{};
+        };
+
+        class SmallBufferStatisticsRegistry
+        {
+        public:
+            SmallBufferStatisticsRegistry() = default;
+
+            RAYCHEL_MAKE_NONCOPY_NONMOVE(SmallBufferStatisticsRegistry)
+
+            void register_site(SmallBufferSite* site)
+            {
+                std::scoped_lock lock{mutex_};
+                sites_.push_back(site);
+            }
+
+            //Sorted by the number of spills, most first
+            [[nodiscard]] std::vector<SmallBufferSpillStatistics> collect()
+            {
+                std::vector<SmallBufferSpillStatistics> statistics{};
+                {
+                    std::scoped_lock lock{mutex_};
+                    for (const auto* site : sites_) {
+                        auto& entry = statistics.emplace_back(site->info);
+                        entry.stores = site->stores.load(std::memory_order_relaxed);
+                        entry.spills = site->spills.load(std::memory_order_relaxed);
+                    }
+                }
+                std::ranges::stable_sort(statistics, [](const auto& lhs, const auto& rhs) { return lhs.spills > rhs.spills; });
+                return statistics;
+            }
+
+            void reset() noexcept
+            {
+                std::scoped_lock lock{mutex_};
+                for (auto* site : sites_) {
+                    site->stores.store(0U, std::memory_order_relaxed);
+                    site->spills.store(0U, std::memory_order_relaxed);
+                }
+            }
+
+            void print_at_exit(std::ostream& stream) noexcept
+            {
+                std::scoped_lock lock{mutex_};
+                exit_stream_ = &stream;
+            }
+
+            //The registry is constructed when the first site registers itself, so it is destroyed after every
+            //static object that was constructed afterwards and might still use a SmallBuffer while being destroyed
+            ~SmallBufferStatisticsRegistry() noexcept;
+
+        private:
+            std::mutex mutex_;
+            std::vector<SmallBufferSite*> sites_;
+            std::ostream* exit_stream_{};
+        };
+
+        [[nodiscard]] inline SmallBufferStatisticsRegistry& small_buffer_statistics_registry() noexcept
+        {
+            static SmallBufferStatisticsRegistry registry{};
+            return registry;
+        }
+
+        inline SmallBufferSite::SmallBufferSite(const SmallBufferSpillStatistics& _info) : info{_info}
+        {
+            small_buffer_statistics_registry().register_site(this);
+        }
+
+        inline void print_small_buffer_statistics(std::ostream& stream, const std::vector<SmallBufferSpillStatistics>& statistics)
+        {
+            stream << "SmallBuffer statistics, most spills first:\n";
+            for (const auto& entry : statistics) {
+                stream << "  " << entry.buffer << " (" << entry.buffer_size << " bytes, aligned to " << entry.buffer_alignment
+                       << ") <- " << entry.type << " (" << entry.object_size << " bytes, aligned to " << entry.object_alignment
+                       << "): " << entry.spills << " of " << entry.stores << " spilled\n";
+            }
+        }
+
+        inline SmallBufferStatisticsRegistry::~SmallBufferStatisticsRegistry() noexcept
+        {
+            if (exit_stream_ == nullptr)
+                return;
+
+            try {
+                print_small_buffer_statistics(*exit_stream_, collect());
+            } catch (...) {
+                //Nothing sensible to do while the program exits
+            }
+        }
+
+        template <typename Buffer, typename T>
+        void count_small_buffer_store(std::size_t buffer_size, std::size_t buffer_alignment, bool spilled) noexcept
+        {
+            if constexpr (collect_small_buffer_statistics) {
+                //Thread-safe static initialization is enough here, the counters themselves are atomic
+                static SmallBufferSite site{SmallBufferSpillStatistics{
+                    type_name<Buffer>(), type_name<T>(), buffer_size, buffer_alignment, sizeof(T), alignof(T)}};
+
+                site.stores.fetch_add(1U, std::memory_order_relaxed);
+                if (spilled)
+                    site.spills.fetch_add(1U, std::memory_order_relaxed);
+            }
+        }
+
+#if RAYCHELCORE_SMALL_BUFFER_STATISTICS
+        } // namespace with_small_buffer_statistics
+#else
+        } // namespace without_small_buffer_statistics
+#endif
+    } // namespace details
+
+#if RAYCHELCORE_SMALL_BUFFER_STATISTICS
+    inline namespace with_small_buffer_statistics {
+#else
+    inline namespace without_small_buffer_statistics {
+#endif
+
+    /**
+    * \brief Get how often objects of each type had to be allocated on the heap by each SmallBuffer instantiation
+    *
+    * Only SmallBuffer::emplace is counted. Copies of a buffer allocate exactly when the original did.
+    *
+    * \return One entry per instantiation and type since the program started, most spills first.
+    *         Empty if RAYCHELCORE_SMALL_BUFFER_STATISTICS is not enabled
+    */
+    [[nodiscard]] inline std::vector<SmallBufferSpillStatistics> small_buffer_statistics()
+    {
+        if constexpr (details::collect_small_buffer_statistics) {
+            return details::small_buffer_statistics_registry().collect();
+        } else {
+            return {};
+        }
+    }
+
+    inline void reset_small_buffer_statistics() noexcept
+    {
+        if constexpr (details::collect_small_buffer_statistics) {
+            details::small_buffer_statistics_registry().reset();
+        }
+    }
+
+    inline void print_small_buffer_statistics(std::ostream& stream)
+    {
+        details::print_small_buffer_statistics(stream, small_buffer_statistics());
+    }
+
+    //Print the statistics to stream when the program exits. stream must still be usable then, e.g. std::cerr
+    inline void print_small_buffer_statistics_at_exit(std::ostream& stream) noexcept
+    {
+        if constexpr (details::collect_small_buffer_statistics) {
+            details::small_buffer_statistics_registry().print_at_exit(stream);
+        }
+    }
+
+#if RAYCHELCORE_SMALL_BUFFER_STATISTICS
+    } // namespace with_small_buffer_statistics
+#else
+    } // namespace without_small_buffer_statistics
+#endif
+
+} //namespace Raychel
+
+#endif //!RAYCHELCORE_SMALL_BUFFER_STATISTICS_H
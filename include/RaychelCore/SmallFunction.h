@@ -0,0 +1,187 @@
+/**
+* \file SmallFunction.h
+* \author Weckyy702 (weckyy702@gmail.com)
+* \brief Header file for SmallFunction class
+* \date 2023-03-28
+*
+* MIT License
+* Copyright (c) [2023] [Weckyy702 (weckyy702@gmail.com | https://github.com/Weckyy702)]
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+#ifndef RAYCHELCORE_SMALL_FUNCTION_H
+#define RAYCHELCORE_SMALL_FUNCTION_H
+
+#include "Raychel_assert.h"
+#include "SmallBuffer.h"
+
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace Raychel {
+
+    enum class SmallFunctionStorage {
+        //Callables that do not fit into the buffer are stored on the heap
+        inline_or_heap,
+        //Callables that do not fit into the buffer are rejected at compile time
+        inline_only,
+    };
+
+    namespace details {
+
+        template <typename Signature, std::size_t BufferSize, SmallFunctionStorage Storage, bool IsCopyable>
+        class BasicSmallFunction;
+
+        template <typename R, typename... Args, std::size_t BufferSize, SmallFunctionStorage Storage, bool IsCopyable>
+        class BasicSmallFunction<R(Args...), BufferSize, Storage, IsCopyable>
+        {
+            using Buffer = SmallBuffer<BufferSize, alignof(std::max_align_t), NewDeleteResource, IsCopyable>;
+            using Invoker = R (*)(Buffer&, Args&&...);
+
+            template <typename F>
+            static constexpr bool is_callable = !std::is_same_v<F, BasicSmallFunction> && std::is_invocable_r_v<R, F&, Args...>;
+
+            //Only checked for callables, so unrelated types that merely convert to a SmallFunction are never inspected
+            template <typename F>
+            static constexpr bool can_store =
+                std::is_move_constructible_v<F> && (!IsCopyable || std::is_copy_constructible_v<F>) &&
+                (Storage == SmallFunctionStorage::inline_or_heap || Buffer::template stores_inline<F>);
+
+        public:
+            BasicSmallFunction() noexcept = default;
+
+            BasicSmallFunction(std::nullptr_t) noexcept //NOLINT(google-explicit-constructor): mirror std::function
+            {}
+
+            //StatisticsTag keeps translation units with different RAYCHELCORE_SMALL_BUFFER_STATISTICS modes apart
+            template <typename F, typename Callable = std::decay_t<F>, typename StatisticsTag = details::SmallBufferStatisticsTag>
+            requires(is_callable<Callable> && can_store<Callable>)
+                BasicSmallFunction(F&& function) //NOLINT(google-explicit-constructor): mirror std::function
+            {
+                if constexpr (std::is_pointer_v<Callable> || std::is_member_pointer_v<Callable>) {
+                    if (function == nullptr)
+                        return;
+                }
+                buffer_.emplace(std::forward<F>(function));
+                invoker_ = &_invoke<Callable>;
+            }
+
+            BasicSmallFunction(const BasicSmallFunction&) requires IsCopyable = default;
+
+            BasicSmallFunction(BasicSmallFunction&& other) noexcept
+                : buffer_{std::move(other.buffer_)}, invoker_{std::exchange(other.invoker_, nullptr)}
+            {}
+
+            BasicSmallFunction& operator=(const BasicSmallFunction&) requires IsCopyable = default;
+
+            BasicSmallFunction& operator=(BasicSmallFunction&& other) noexcept
+            {
+                buffer_ = std::move(other.buffer_);
+                invoker_ = std::exchange(other.invoker_, nullptr);
+                return *this;
+            }
+
+            BasicSmallFunction& operator=(std::nullptr_t) noexcept
+            {
+                buffer_ = Buffer{};
+                invoker_ = nullptr;
+                return *this;
+            }
+
+            template <typename F, typename Callable = std::decay_t<F>, typename StatisticsTag = details::SmallBufferStatisticsTag>
+            requires(is_callable<Callable> && can_store<Callable>)
+                BasicSmallFunction& operator=(F&& function)
+            {
+                return *this = BasicSmallFunction{std::forward<F>(function)};
+            }
+
+            //Calling an empty SmallFunction is an error
+            R operator()(Args... args) const
+            {
+                RAYCHEL_ASSERT(invoker_ != nullptr);
+                return invoker_(buffer_, std::forward<Args>(args)...);
+            }
+
+            //Whether the callable lives on the heap. Always false for SmallFunctionStorage::inline_only
+            [[nodiscard]] bool is_heap() const noexcept
+            {
+                return buffer_.is_heap();
+            }
+
+            explicit operator bool() const noexcept
+            {
+                return invoker_ != nullptr;
+            }
+
+            friend bool operator==(const BasicSmallFunction& function, std::nullptr_t) noexcept
+            {
+                return !function;
+            }
+
+            ~BasicSmallFunction() noexcept = default;
+
+        private:
+            template <typename F>
+            static R _invoke(Buffer& buffer, Args&&... args)
+            {
+                if constexpr (std::is_void_v<R>) {
+                    std::invoke(buffer.template unsafe_get_value<F>(), std::forward<Args>(args)...);
+                } else {
+                    return std::invoke(buffer.template unsafe_get_value<F>(), std::forward<Args>(args)...);
+                }
+            }
+
+            //Calling a SmallFunction does not change its state as far as the caller can tell, just like std::function
+            mutable Buffer buffer_{};
+            Invoker invoker_{};
+        };
+
+    } // namespace details
+
+    /**
+    * \brief Type-erased callable that stores callables of up to BufferSize bytes inline
+    *
+    * Drop-in replacement for std::function with a configurable inline buffer.
+    * Callables that do not fit are allocated on the heap,
+    * unless Storage is SmallFunctionStorage::inline_only, in which case they do not compile.
+    *
+    * \tparam Signature Signature of the function, e.g. void(int)
+    * \tparam BufferSize Size of the inline buffer in bytes
+    * \tparam Storage Whether callables that do not fit into the buffer may be stored on the heap
+    */
+    template <
+        typename Signature, std::size_t BufferSize = 4 * sizeof(void*),
+        SmallFunctionStorage Storage = SmallFunctionStorage::inline_or_heap>
+    using SmallFunction = details::BasicSmallFunction<Signature, BufferSize, Storage, true>;
+
+    /**
+    * \brief SmallFunction that can also store move-only callables, e.g. lambdas that capture a std::unique_ptr
+    *
+    * It cannot be copied itself.
+    */
+    template <
+        typename Signature, std::size_t BufferSize = 4 * sizeof(void*),
+        SmallFunctionStorage Storage = SmallFunctionStorage::inline_or_heap>
+    using MoveOnlySmallFunction = details::BasicSmallFunction<Signature, BufferSize, Storage, false>;
+
+} //namespace Raychel
+
+#endif //!RAYCHELCORE_SMALL_FUNCTION_H
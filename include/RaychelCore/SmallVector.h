@@ -0,0 +1,551 @@
+/**
+* \file SmallVector.h
+* \author Weckyy702 (weckyy702@gmail.com)
+* \brief Header file for SmallVector class
+* \date 2023-04-02
+*
+* MIT License
+* Copyright (c) [2023] [Weckyy702 (weckyy702@gmail.com | https://github.com/Weckyy702)]
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+#ifndef RAYCHELCORE_SMALL_VECTOR_H
+#define RAYCHELCORE_SMALL_VECTOR_H
+
+#include "Raychel_assert.h"
+#include "SmallBuffer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Raychel {
+
+    /**
+    * \brief Vector that stores up to N elements inline and only allocates once it grows beyond that
+    *
+    * Element access is checked with RAYCHEL_ASSERT, just like AssertingVector.
+    * Elements are moved to new storage byte by byte if they are trivially relocatable, by moving them if that cannot throw,
+    * and by copying them otherwise, so growing has the strong exception guarantee for copyable types.
+    *
+    * Heap storage is allocated from Resource, which is propagated like the resource of SmallBuffer.
+    * Iterators, pointers and references are invalidated whenever the elements move, which includes moving the vector itself.
+    */
+    template <typename T, std::size_t N, SmallBufferResource Resource = NewDeleteResource>
+        requires(N != 0)
+    class SmallVector
+    {
+    public:
+        using value_type = T;
+        using size_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using reference = T&;
+        using const_reference = const T&;
+        using pointer = T*;
+        using const_pointer = const T*;
+        using iterator = T*;
+        using const_iterator = const T*;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+        static constexpr std::size_t inline_capacity = N;
+
+        SmallVector() noexcept = default;
+
+        //The resource is passed like an allocator to the standard containers
+        SmallVector(std::allocator_arg_t /*unused*/, Resource resource) noexcept : resource_{std::move(resource)}
+        {}
+
+        //The constructors below delegate to another one, so the destructor cleans up if they throw
+        explicit SmallVector(std::size_t count) : SmallVector()
+        {
+            resize(count);
+        }
+
+        SmallVector(std::size_t count, const T& value) : SmallVector()
+        {
+            resize(count, value);
+        }
+
+        SmallVector(std::initializer_list<T> values) : SmallVector(values.begin(), values.end())
+        {}
+
+        template <std::input_iterator It, std::sentinel_for<It> Sentinel>
+        SmallVector(It first, Sentinel last) : SmallVector()
+        {
+            if constexpr (std::forward_iterator<It>) {
+                reserve(static_cast<std::size_t>(std::ranges::distance(first, last)));
+            }
+            for (; first != last; ++first) {
+                emplace_back(*first);
+            }
+        }
+
+        SmallVector(const SmallVector& other) : SmallVector(std::allocator_arg, other.resource_)
+        {
+            _copy_from(other);
+        }
+
+        SmallVector(SmallVector&& other) noexcept(is_nothrow_relocatable) : SmallVector(std::allocator_arg, other.resource_)
+        {
+            _take(std::move(other));
+        }
+
+        //Keeps the resource of this vector
+        SmallVector& operator=(const SmallVector& other)
+        {
+            if (this == std::addressof(other))
+                return *this;
+
+            clear();
+            _copy_from(other);
+
+            return *this;
+        }
+
+        //Takes the resource of the other vector
+        SmallVector& operator=(SmallVector&& other) noexcept(is_nothrow_relocatable)
+        {
+            if (this == std::addressof(other))
+                return *this;
+
+            clear();
+            _release_heap();
+            resource_ = other.resource_;
+            _take(std::move(other));
+
+            return *this;
+        }
+
+        SmallVector& operator=(std::initializer_list<T> values)
+        {
+            clear();
+            reserve(values.size());
+            for (const auto& value : values) {
+                emplace_back(value);
+            }
+            return *this;
+        }
+
+        [[nodiscard]] T& at(std::size_t pos) noexcept
+        {
+            RAYCHEL_ASSERT(pos < size_);
+            return data()[pos];
+        }
+
+        [[nodiscard]] const T& at(std::size_t pos) const noexcept
+        {
+            RAYCHEL_ASSERT(pos < size_);
+            return data()[pos];
+        }
+
+        [[nodiscard]] T& operator[](std::size_t pos) noexcept
+        {
+            return at(pos);
+        }
+
+        [[nodiscard]] const T& operator[](std::size_t pos) const noexcept
+        {
+            return at(pos);
+        }
+
+        [[nodiscard]] T& front() noexcept
+        {
+            return at(0U);
+        }
+
+        [[nodiscard]] const T& front() const noexcept
+        {
+            return at(0U);
+        }
+
+        [[nodiscard]] T& back() noexcept
+        {
+            RAYCHEL_ASSERT(size_ != 0U);
+            return data()[size_ - 1U];
+        }
+
+        [[nodiscard]] const T& back() const noexcept
+        {
+            RAYCHEL_ASSERT(size_ != 0U);
+            return data()[size_ - 1U];
+        }
+
+        [[nodiscard]] T* data() noexcept
+        {
+            return is_heap() ? storage_.heap : _inline_data();
+        }
+
+        [[nodiscard]] const T* data() const noexcept
+        {
+            return is_heap() ? storage_.heap : _inline_data();
+        }
+
+        [[nodiscard]] iterator begin() noexcept
+        {
+            return data();
+        }
+
+        [[nodiscard]] const_iterator begin() const noexcept
+        {
+            return data();
+        }
+
+        [[nodiscard]] const_iterator cbegin() const noexcept
+        {
+            return data();
+        }
+
+        [[nodiscard]] iterator end() noexcept
+        {
+            return data() + size_;
+        }
+
+        [[nodiscard]] const_iterator end() const noexcept
+        {
+            return data() + size_;
+        }
+
+        [[nodiscard]] const_iterator cend() const noexcept
+        {
+            return data() + size_;
+        }
+
+        [[nodiscard]] reverse_iterator rbegin() noexcept
+        {
+            return reverse_iterator{end()};
+        }
+
+        [[nodiscard]] const_reverse_iterator rbegin() const noexcept
+        {
+            return const_reverse_iterator{end()};
+        }
+
+        [[nodiscard]] reverse_iterator rend() noexcept
+        {
+            return reverse_iterator{begin()};
+        }
+
+        [[nodiscard]] const_reverse_iterator rend() const noexcept
+        {
+            return const_reverse_iterator{begin()};
+        }
+
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return size_ == 0U;
+        }
+
+        [[nodiscard]] std::size_t size() const noexcept
+        {
+            return size_;
+        }
+
+        [[nodiscard]] std::size_t capacity() const noexcept
+        {
+            return capacity_;
+        }
+
+        //Whether the elements live on the heap
+        [[nodiscard]] bool is_heap() const noexcept
+        {
+            return capacity_ != N;
+        }
+
+        [[nodiscard]] const Resource& resource() const noexcept
+        {
+            return resource_;
+        }
+
+        void reserve(std::size_t new_capacity)
+        {
+            if (new_capacity > capacity_)
+                _reallocate(new_capacity);
+        }
+
+        //Moves the elements back inline if they fit
+        void shrink_to_fit()
+        {
+            if (!is_heap() || size_ == capacity_)
+                return;
+
+            if (size_ > N) {
+                _reallocate(size_);
+                return;
+            }
+
+            T* heap = storage_.heap;
+            try {
+                _relocate(heap, size_, _inline_data());
+            } catch (...) {
+                storage_.heap = heap;
+                throw;
+            }
+            resource_.deallocate(heap, capacity_ * sizeof(T), alignof(T));
+            capacity_ = N;
+        }
+
+        void clear() noexcept
+        {
+            std::destroy_n(data(), size_);
+            size_ = 0U;
+        }
+
+        void push_back(const T& value)
+        {
+            emplace_back(value);
+        }
+
+        void push_back(T&& value)
+        {
+            emplace_back(std::move(value));
+        }
+
+        //The arguments may refer to elements of this vector
+        template <typename... Args>
+        T& emplace_back(Args&&... args)
+        {
+            if (size_ == capacity_)
+                return _grow_and_emplace_back(std::forward<Args>(args)...);
+
+            T* element = ::new (data() + size_) T(std::forward<Args>(args)...);
+            ++size_;
+            return *element;
+        }
+
+        void pop_back() noexcept
+        {
+            RAYCHEL_ASSERT(size_ != 0U);
+            --size_;
+            std::destroy_at(data() + size_);
+        }
+
+        iterator insert(const_iterator pos, T value)
+        {
+            RAYCHEL_ASSERT(pos >= begin() && pos <= end());
+            const auto index = pos - cbegin();
+
+            emplace_back(std::move(value));
+            std::rotate(begin() + index, end() - 1, end());
+
+            return begin() + index;
+        }
+
+        iterator erase(const_iterator pos) noexcept(std::is_nothrow_move_assignable_v<T>)
+        {
+            RAYCHEL_ASSERT(pos >= begin() && pos < end());
+            return erase(pos, pos + 1);
+        }
+
+        iterator erase(const_iterator first, const_iterator last) noexcept(std::is_nothrow_move_assignable_v<T>)
+        {
+            RAYCHEL_ASSERT(first >= begin() && first <= last && last <= end());
+            auto* const first_erased = begin() + (first - cbegin());
+            auto* const last_erased = begin() + (last - cbegin());
+
+            auto* const new_end = std::move(last_erased, end(), first_erased);
+            std::destroy(new_end, end());
+            size_ = static_cast<std::size_t>(new_end - begin());
+
+            return first_erased;
+        }
+
+        void resize(std::size_t new_size)
+        {
+            _resize(new_size, [](T* ptr) { ::new (ptr) T(); });
+        }
+
+        void resize(std::size_t new_size, const T& value)
+        {
+            if (new_size <= capacity_) {
+                _resize(new_size, [&value](T* ptr) { ::new (ptr) T(value); });
+                return;
+            }
+
+            //value might be an element of this vector
+            const T copy{value};
+            _resize(new_size, [&copy](T* ptr) { ::new (ptr) T(copy); });
+        }
+
+        friend bool operator==(const SmallVector& lhs, const SmallVector& rhs)
+        {
+            return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+        }
+
+        ~SmallVector() noexcept
+        {
+            clear();
+            _release_heap();
+        }
+
+    private:
+        static constexpr bool is_nothrow_relocatable = is_trivially_relocatable_v<T> || std::is_nothrow_move_constructible_v<T>;
+
+        union Storage
+        {
+            T* heap;
+            alignas(T) std::array<std::byte, N * sizeof(T)> buffer;
+        };
+
+        [[nodiscard]] T* _inline_data() noexcept
+        {
+            return reinterpret_cast<T*>(storage_.buffer.data());
+        }
+
+        [[nodiscard]] const T* _inline_data() const noexcept
+        {
+            return reinterpret_cast<const T*>(storage_.buffer.data());
+        }
+
+        [[nodiscard]] T* _allocate(std::size_t capacity)
+        {
+            return static_cast<T*>(resource_.allocate(capacity * sizeof(T), alignof(T)));
+        }
+
+        //Frees the heap storage without touching the elements
+        void _release_heap() noexcept
+        {
+            if (!is_heap())
+                return;
+
+            resource_.deallocate(storage_.heap, capacity_ * sizeof(T), alignof(T));
+            capacity_ = N;
+        }
+
+        /**
+        * \brief Move count elements from src to the uninitialized memory at dst, and end the lifetime of the ones at src
+        *
+        * If copying an element throws, the copies made so far are destroyed and src is left untouched
+        */
+        static void _relocate(T* src, std::size_t count, T* dst) noexcept(is_nothrow_relocatable)
+        {
+            if constexpr (is_trivially_relocatable_v<T>) {
+                if (count != 0U)
+                    std::memcpy(static_cast<void*>(dst), static_cast<const void*>(src), count * sizeof(T));
+            } else if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>) {
+                std::uninitialized_move_n(src, count, dst);
+                std::destroy_n(src, count);
+            } else {
+                std::uninitialized_copy_n(src, count, dst);
+                std::destroy_n(src, count);
+            }
+        }
+
+        void _reallocate(std::size_t new_capacity)
+        {
+            T* new_data = _allocate(new_capacity);
+            try {
+                _relocate(data(), size_, new_data);
+            } catch (...) {
+                resource_.deallocate(new_data, new_capacity * sizeof(T), alignof(T));
+                throw;
+            }
+
+            _release_heap();
+            storage_.heap = new_data;
+            capacity_ = new_capacity;
+        }
+
+        template <typename... Args>
+        T& _grow_and_emplace_back(Args&&... args)
+        {
+            const auto new_capacity = std::max(2U * capacity_, size_ + 1U);
+            T* new_data = _allocate(new_capacity);
+
+            //Construct the new element first, the arguments might refer to the old ones
+            try {
+                ::new (new_data + size_) T(std::forward<Args>(args)...);
+            } catch (...) {
+                resource_.deallocate(new_data, new_capacity * sizeof(T), alignof(T));
+                throw;
+            }
+
+            try {
+                _relocate(data(), size_, new_data);
+            } catch (...) {
+                std::destroy_at(new_data + size_);
+                resource_.deallocate(new_data, new_capacity * sizeof(T), alignof(T));
+                throw;
+            }
+
+            _release_heap();
+            storage_.heap = new_data;
+            capacity_ = new_capacity;
+
+            return new_data[size_++];
+        }
+
+        template <typename Construct>
+        void _resize(std::size_t new_size, Construct&& construct)
+        {
+            if (new_size <= size_) {
+                std::destroy(begin() + new_size, end());
+                size_ = new_size;
+                return;
+            }
+
+            reserve(new_size);
+            while (size_ != new_size) {
+                construct(data() + size_);
+                ++size_;
+            }
+        }
+
+        //Expects this vector to be empty
+        void _copy_from(const SmallVector& other)
+        {
+            reserve(other.size_);
+            std::uninitialized_copy_n(other.data(), other.size_, data());
+            size_ = other.size_;
+        }
+
+        //Expects this vector to be empty and to have no heap storage
+        void _take(SmallVector&& other) noexcept(is_nothrow_relocatable)
+        {
+            if (other.is_heap()) {
+                storage_.heap = other.storage_.heap;
+                capacity_ = std::exchange(other.capacity_, N);
+            } else {
+                _relocate(other._inline_data(), other.size_, _inline_data());
+            }
+            size_ = std::exchange(other.size_, 0U);
+        }
+
+        Storage storage_{};
+        std::size_t size_{};
+        std::size_t capacity_{N};
+        [[no_unique_address]] Resource resource_{};
+    };
+
+    //The elements are found through the capacity, not a pointer into the vector, so moving its bytes is fine
+    template <typename T, std::size_t N, SmallBufferResource Resource>
+    struct is_trivially_relocatable<SmallVector<T, N, Resource>>
+        : std::bool_constant<is_trivially_relocatable_v<T> && is_trivially_relocatable_v<Resource>>
+    {};
+
+} //namespace Raychel
+
+#endif //!RAYCHELCORE_SMALL_VECTOR_H
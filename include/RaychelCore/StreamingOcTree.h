@@ -0,0 +1,526 @@
+/**
+* \file StreamingOcTree.h
+* \author Weckyy702 (weckyy702@gmail.com)
+* \brief Header file for StreamingOcTree class
+* \date 2023-02-20
+*
+* MIT License
+* Copyright (c) [2023] [Weckyy702 (weckyy702@gmail.com | https://github.com/Weckyy702)]
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+#ifndef RAYCHELCORE_STREAMING_OCTTREE_H
+#define RAYCHELCORE_STREAMING_OCTTREE_H
+
+#include "RaychelCore/ClassMacros.h"
+#include "RaychelCore/OctTree.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Raychel {
+
+    /**
+    * \brief OcTree variant that keeps its elements in chunk files on disk
+    *
+    * The space inside the bounding box is split into a resident grid of 8^ChunkDepth chunks.
+    * Elements are sorted into chunks by the center of their bounding box and appended to one file per chunk.
+    * Only the bounds and sizes of the chunks stay in memory.
+    * Queries page chunks in on demand and build an OcTree for each of them. Loaded chunks are kept in an LRU cache.
+    * The memory allocated for write buffers and loaded chunks, including the nodes of their trees, stays below the memory
+    * budget between calls. The most recently loaded chunk is the exception, it stays loaded even if it does not fit
+    * next to the write buffers.
+    * While a chunk is read, its file contents are held in memory once more. Room for that, or for the tree of the chunk
+    * if it was loaded before and is larger, is made before reading. The first time a chunk is loaded,
+    * its tree may briefly exceed that room until the other chunks are evicted.
+    * Allocator is used for all of these allocations.
+    *
+    * Elements are written to disk as raw bytes, so T must be trivially copyable. Every tree needs its own directory.
+    * The cache is modified by queries, so a StreamingOcTree must not be queried from multiple threads at once.
+    *
+    * Queries return their result together with a std::error_code, which is set if a chunk file could not be read.
+    * The result is empty in that case.
+    *
+    * StatisticsTag is passed on to the OcTree of each chunk and is never given explicitly.
+    */
+    template <
+        typename T, std::size_t ChunkDepth = 3, std::size_t BucketSize = 10, std::size_t MaxDepth = 20, Coordinate Coordinate = T,
+        std::invocable<const T&> GetBoundingBox = details::BoundingBoxFromCoordinate,
+        std::invocable<const T&, const Coordinate&> GetDistance = details::GetDistanceToPoint,
+        typename Allocator = std::allocator<T>, typename StatisticsTag = details::OcTreeStatisticsTag>
+        requires(std::is_invocable_r_v<BasicBoundingBox<Coordinate>, GetBoundingBox, const T&>) && std::is_trivially_copyable_v<T>
+    class StreamingOcTree
+    {
+        static_assert(ChunkDepth <= 6U, "StreamingOcTree only supports up to 8^6 chunks!");
+
+        using BoundingBox = BasicBoundingBox<Coordinate>;
+        using Number = details::ElementType<Coordinate>;
+        using ChunkTree = OcTree<
+            T, BucketSize, MaxDepth, Coordinate, GetBoundingBox, GetDistance, details::NoAggregate, Allocator,
+            OcTreePrecision::exact, StatisticsTag>;
+        using Elements = std::vector<T, Allocator>;
+        using Bytes = std::vector<std::byte, typename std::allocator_traits<Allocator>::template rebind_alloc<std::byte>>;
+
+        static constexpr std::size_t chunks_per_axis = std::size_t{1} << ChunkDepth;
+        static constexpr std::size_t chunk_count = chunks_per_axis * chunks_per_axis * chunks_per_axis;
+
+        template <typename Value, typename Dist>
+        struct ClosestItem
+        {
+            Value value;
+            Dist distance;
+        };
+
+        template <typename Value>
+        struct QueryResult
+        {
+            Value value;
+            std::error_code ec;
+        };
+
+        using Item = ClosestItem<T, Number>;
+
+        struct Chunk
+        {
+            std::size_t elements_on_disk{};
+            Elements pending{};
+            std::optional<BoundingBox> content_bounds{};
+            std::optional<ChunkTree> loaded{};
+            //Allocated by the tree while it is loaded. Kept after unloading as an estimate for the next load
+            std::size_t tree_bytes{};
+            std::list<std::size_t>::iterator lru_position{};
+        };
+
+    public:
+        /**
+        * \brief Create an empty StreamingOcTree
+        *
+        * \param a one corner of the bounding box
+        * \param b the opposite corner of the bounding box
+        * \param directory directory the chunk files are stored in. Will be created if it does not exist
+        * \param memory_budget maximum number of bytes allocated for write buffers and loaded chunks
+        * \throws std::filesystem::filesystem_error if the directory cannot be created
+        */
+        StreamingOcTree(const Coordinate& a, const Coordinate& b, std::filesystem::path directory, std::size_t memory_budget)
+            : bounding_box_{make_bounding_box(a, b)},
+              directory_{std::move(directory)},
+              memory_budget_{memory_budget},
+              chunks_(chunk_count)
+        {
+            std::filesystem::create_directories(directory_);
+        }
+
+        RAYCHEL_MAKE_NONCOPY_NONMOVE(StreamingOcTree)
+
+        [[nodiscard]] std::size_t size() const noexcept
+        {
+            return size_;
+        }
+
+        //Bytes allocated by the trees of the loaded chunks
+        [[nodiscard]] std::size_t loaded_bytes() const noexcept
+        {
+            return loaded_bytes_;
+        }
+
+        //Bytes allocated for the write buffers, including their unused capacity
+        [[nodiscard]] std::size_t pending_bytes() const noexcept
+        {
+            return pending_bytes_;
+        }
+
+        /**
+        * \brief Insert a single element
+        *
+        * \return whether the element was inserted.
+        *         Fails if the element is outside the bounding box or the write buffers were full and could not be written.
+        *         The element is not part of the tree then
+        */
+        bool insert(const T& value)
+        {
+            const auto where = _get_bounding_box(value);
+
+            if (!details::overlaps(where, bounding_box_))
+                return false;
+
+            const auto chunk_index = _chunk_index(details::midpoint(where));
+            auto& chunk = chunks_[chunk_index];
+
+            //Write buffers never grow past half of the budget, even if writing them fails
+            if (pending_bytes_ + _growth_bytes(chunk.pending) > memory_budget_ / 2U && !flush())
+                return false;
+
+            //The chunk changes, so its cached tree is out of date
+            _unload(chunk_index);
+
+            //Grow the buffer by hand, so that the number of allocated bytes is known
+            const auto growth_bytes = _growth_bytes(chunk.pending);
+            chunk.pending.reserve(chunk.pending.capacity() + growth_bytes / sizeof(T));
+            chunk.pending.push_back(value);
+            chunk.content_bounds = _merge(chunk.content_bounds, where);
+            pending_bytes_ += growth_bytes;
+            ++size_;
+
+            _evict_until(memory_budget_);
+            return true;
+        }
+
+        /**
+        * \brief Insert all elements of a range, e.g. a std::istream_iterator. Memory use stays bounded by the memory budget
+        *
+        * \return whether all elements could be inserted
+        */
+        template <std::input_iterator It, std::sentinel_for<It> Sentinel>
+        bool insert(It first, Sentinel last)
+        {
+            bool all_inserted{true};
+            for (; first != last; ++first) {
+                all_inserted &= insert(*first);
+            }
+            return all_inserted;
+        }
+
+        /**
+        * \brief Append all pending elements to their chunk files
+        *
+        * \return whether all chunk files could be written
+        */
+        bool flush()
+        {
+            bool success{true};
+            for (std::size_t i{}; i != chunk_count; ++i) {
+                success &= _flush(i);
+            }
+            return success;
+        }
+
+        [[nodiscard]] auto closest_to(const Coordinate& where) const -> QueryResult<std::optional<Item>>
+        {
+            return closest_to(where, details::AcceptAll{});
+        }
+
+        //Same as OcTree::closest_to(), but the element is returned by value because its chunk may be evicted later
+        template <std::predicate<const T&> Predicate>
+        [[nodiscard]] auto closest_to(const Coordinate& where, const Predicate& accept) const -> QueryResult<std::optional<Item>>
+        {
+            std::optional<Item> closest_item{};
+            for (const auto& [lower_bound_squared, chunk_index] : _chunks_by_distance(where)) {
+                if (closest_item.has_value() && details::is_farther_than(lower_bound_squared, closest_item->distance))
+                    break;
+
+                std::error_code ec{};
+                const auto* const tree = _load(chunk_index, ec);
+                if (tree == nullptr)
+                    return {std::nullopt, ec};
+
+                const auto maybe_item = tree->closest_to(where, accept);
+                if (maybe_item.has_value() && (!closest_item.has_value() || maybe_item->distance < closest_item->distance))
+                    closest_item.emplace(maybe_item->value, maybe_item->distance);
+            }
+
+            return {closest_item, {}};
+        }
+
+        //Same as OcTree::k_closest_to(). Equally close elements are ordered by the chunk they are stored in
+        template <std::predicate<const T&> Predicate = details::AcceptAll>
+        [[nodiscard]] auto k_closest_to(const Coordinate& where, std::size_t k, const Predicate& accept = {}) const
+            -> QueryResult<std::vector<Item>>
+        {
+            std::vector<Item> closest_items{};
+            if (k == 0U)
+                return {};
+
+            for (const auto& [lower_bound_squared, chunk_index] : _chunks_by_distance(where)) {
+                if (closest_items.size() == k && details::is_farther_than(lower_bound_squared, closest_items.back().distance))
+                    break;
+
+                std::error_code ec{};
+                const auto* const tree = _load(chunk_index, ec);
+                if (tree == nullptr)
+                    return {{}, ec};
+
+                //Every element is stored in exactly one chunk, so the results of different chunks never overlap
+                const auto previous_size = closest_items.size();
+                for (const auto& [value, distance] : tree->k_closest_to(where, k, accept)) {
+                    closest_items.push_back(Item{value, distance});
+                }
+                _merge_sorted(closest_items, previous_size);
+                if (closest_items.size() > k)
+                    closest_items.erase(closest_items.begin() + static_cast<std::ptrdiff_t>(k), closest_items.end());
+            }
+
+            return {std::move(closest_items), {}};
+        }
+
+        //Same as OcTree::elements_within(). Equally close elements are ordered by the chunk they are stored in
+        template <std::predicate<const T&> Predicate = details::AcceptAll>
+        [[nodiscard]] auto elements_within(const Coordinate& where, Number radius, const Predicate& accept = {}) const
+            -> QueryResult<std::vector<Item>>
+        {
+            std::vector<Item> items{};
+            for (const auto& [lower_bound_squared, chunk_index] : _chunks_by_distance(where)) {
+                if (details::is_farther_than(lower_bound_squared, radius))
+                    break;
+
+                std::error_code ec{};
+                const auto* const tree = _load(chunk_index, ec);
+                if (tree == nullptr)
+                    return {{}, ec};
+
+                const auto previous_size = items.size();
+                for (const auto& [value, distance] : tree->elements_within(where, radius, accept)) {
+                    items.push_back(Item{value, distance});
+                }
+                _merge_sorted(items, previous_size);
+            }
+
+            return {std::move(items), {}};
+        }
+
+        ~StreamingOcTree() noexcept
+        {
+            std::error_code ec{};
+            for (std::size_t i{}; i != chunk_count; ++i) {
+                if (chunks_[i].elements_on_disk != 0U)
+                    std::filesystem::remove(_chunk_path(i), ec);
+            }
+        }
+
+    private:
+        [[nodiscard]] std::size_t _chunk_index(const Coordinate& where) const noexcept
+        {
+            const auto cell = [](Number value, Number min, Number max) -> std::size_t {
+                if (!(max > min) || !(value > min))
+                    return 0U;
+                const auto scaled = (value - min) / (max - min) * static_cast<Number>(chunks_per_axis);
+                return std::min(static_cast<std::size_t>(scaled), chunks_per_axis - 1U);
+            };
+
+            const auto& min = bounding_box_.bottom_front_left;
+            const auto& max = bounding_box_.top_back_right;
+
+            const auto x = cell(details::get_x(where), details::get_x(min), details::get_x(max));
+            const auto y = cell(details::get_y(where), details::get_y(min), details::get_y(max));
+            const auto z = cell(details::get_z(where), details::get_z(min), details::get_z(max));
+
+            return x + chunks_per_axis * (y + chunks_per_axis * z);
+        }
+
+        //Chunks that contain elements, ordered by the lower bound of the squared distance of their elements to where
+        [[nodiscard]] std::vector<std::pair<Number, std::size_t>> _chunks_by_distance(const Coordinate& where) const
+        {
+            std::vector<std::pair<Number, std::size_t>> candidates{};
+            for (std::size_t i{}; i != chunk_count; ++i) {
+                if (chunks_[i].content_bounds.has_value())
+                    candidates.emplace_back(details::distance_squared_to_box(*chunks_[i].content_bounds, where), i);
+            }
+            std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+            return candidates;
+        }
+
+        //Both items[0, middle) and items[middle, end) are sorted by distance
+        static void _merge_sorted(std::vector<Item>& items, std::size_t middle)
+        {
+            std::inplace_merge(
+                items.begin(), items.begin() + static_cast<std::ptrdiff_t>(middle), items.end(),
+                [](const Item& a, const Item& b) { return a.distance < b.distance; });
+        }
+
+        //Bytes the next element allocates in a write buffer. Full buffers double their capacity
+        [[nodiscard]] static std::size_t _growth_bytes(const Elements& pending) noexcept
+        {
+            if (pending.size() != pending.capacity())
+                return 0U;
+            return std::max(pending.capacity(), std::size_t{1}) * sizeof(T);
+        }
+
+        [[nodiscard]] std::filesystem::path _chunk_path(std::size_t chunk_index) const
+        {
+            return directory_ / ("chunk_" + std::to_string(chunk_index) + ".bin");
+        }
+
+        [[nodiscard]] static BoundingBox _merge(const std::optional<BoundingBox>& a, const BoundingBox& b) noexcept
+        {
+            if (!a.has_value())
+                return b;
+
+            return BoundingBox{
+                Coordinate{
+                    std::min(details::get_x(a->bottom_front_left), details::get_x(b.bottom_front_left)),
+                    std::min(details::get_y(a->bottom_front_left), details::get_y(b.bottom_front_left)),
+                    std::min(details::get_z(a->bottom_front_left), details::get_z(b.bottom_front_left)),
+                },
+                Coordinate{
+                    std::max(details::get_x(a->top_back_right), details::get_x(b.top_back_right)),
+                    std::max(details::get_y(a->top_back_right), details::get_y(b.top_back_right)),
+                    std::max(details::get_z(a->top_back_right), details::get_z(b.top_back_right)),
+                },
+            };
+        }
+
+        bool _flush(std::size_t chunk_index)
+        {
+            auto& chunk = chunks_[chunk_index];
+            if (chunk.pending.empty())
+                return true;
+
+            //The first write replaces any file that may be left over from an earlier tree
+            const auto mode = std::ios::binary | (chunk.elements_on_disk == 0U ? std::ios::trunc : std::ios::app);
+            std::ofstream file{_chunk_path(chunk_index), mode};
+            file.write(
+                reinterpret_cast<const char*>(chunk.pending.data()), //NOLINT: T is trivially copyable
+                static_cast<std::streamsize>(chunk.pending.size() * sizeof(T)));
+            file.close();
+
+            if (!file) {
+                //Cut off whatever part was written, so that the next write appends to the intact elements
+                std::error_code ec{};
+                std::filesystem::resize_file(_chunk_path(chunk_index), chunk.elements_on_disk * sizeof(T), ec);
+                return false;
+            }
+
+            chunk.elements_on_disk += chunk.pending.size();
+            pending_bytes_ -= chunk.pending.capacity() * sizeof(T);
+            //Release the buffer, clear() would keep its capacity
+            chunk.pending = Elements{};
+
+            return true;
+        }
+
+        //Empty with ec set if the chunk file is missing or shorter than expected
+        [[nodiscard]] std::optional<Elements> _read_chunk(std::size_t chunk_index, std::error_code& ec) const
+        {
+            const auto& chunk = chunks_[chunk_index];
+
+            Elements elements{};
+            elements.reserve(chunk.elements_on_disk + chunk.pending.size());
+
+            if (chunk.elements_on_disk != 0U) {
+                const auto path = _chunk_path(chunk_index);
+                const auto byte_count = chunk.elements_on_disk * sizeof(T);
+
+                const auto file_size = std::filesystem::file_size(path, ec);
+                if (ec)
+                    return std::nullopt;
+
+                Bytes bytes(byte_count);
+                std::ifstream file{path, std::ios::binary};
+                file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(byte_count)); //NOLINT: raw bytes
+                if (file_size < byte_count || !file) {
+                    ec = std::make_error_code(std::errc::io_error);
+                    return std::nullopt;
+                }
+
+                //T does not have to be default constructible, so we cannot read into elements directly
+                std::array<std::byte, sizeof(T)> element_bytes{};
+                for (std::size_t offset{}; offset != byte_count; offset += sizeof(T)) {
+                    std::memcpy(element_bytes.data(), bytes.data() + offset, sizeof(T));
+                    elements.push_back(std::bit_cast<T>(element_bytes));
+                }
+            }
+
+            elements.insert(elements.end(), chunk.pending.begin(), chunk.pending.end());
+
+            return elements;
+        }
+
+        //nullptr with ec set if the chunk file could not be read
+        const ChunkTree* _load(std::size_t chunk_index, std::error_code& ec) const
+        {
+            auto& chunk = chunks_[chunk_index];
+
+            if (chunk.loaded.has_value()) {
+                lru_.splice(lru_.begin(), lru_, chunk.lru_position);
+                return &*chunk.loaded;
+            }
+
+            //Reading holds the file contents and the elements at once. The tree holds the elements and its nodes
+            const auto element_bytes = (chunk.elements_on_disk + chunk.pending.size()) * sizeof(T);
+            const auto read_bytes = chunk.elements_on_disk * sizeof(T) + element_bytes;
+            const auto needed_bytes = std::max(read_bytes, chunk.tree_bytes);
+            _evict_until(memory_budget_ > needed_bytes ? memory_budget_ - needed_bytes : 0U);
+
+            auto maybe_elements = _read_chunk(chunk_index, ec);
+            if (!maybe_elements.has_value())
+                return nullptr;
+
+            //Use the content bounds so that elements reaching out of the chunk are still found
+            const auto& bounds = *chunk.content_bounds;
+            chunk.loaded.emplace(
+                bounds.bottom_front_left, bounds.top_back_right, std::move(*maybe_elements), OcTreeLayout::morton_order);
+            chunk.tree_bytes = chunk.loaded->allocated_bytes();
+            lru_.push_front(chunk_index);
+            chunk.lru_position = lru_.begin();
+            loaded_bytes_ += chunk.tree_bytes;
+
+            //The new chunk is never evicted right away, even if it is larger than the budget on its own
+            _evict_until(memory_budget_, 1U);
+
+            return &*chunk.loaded;
+        }
+
+        void _unload(std::size_t chunk_index) const noexcept
+        {
+            auto& chunk = chunks_[chunk_index];
+            if (!chunk.loaded.has_value())
+                return;
+
+            loaded_bytes_ -= chunk.tree_bytes;
+            chunk.loaded.reset();
+            lru_.erase(chunk.lru_position);
+        }
+
+        //The keep most recently used chunks stay loaded
+        void _evict_until(std::size_t budget, std::size_t keep = 0U) const noexcept
+        {
+            while (lru_.size() > keep && loaded_bytes_ + pending_bytes_ > budget) {
+                _unload(lru_.back());
+            }
+        }
+
+        BoundingBox bounding_box_;
+        std::filesystem::path directory_;
+        std::size_t memory_budget_;
+        std::size_t size_{};
+        std::size_t pending_bytes_{};
+
+        mutable std::vector<Chunk> chunks_;
+        mutable std::list<std::size_t> lru_{};
+        mutable std::size_t loaded_bytes_{};
+
+        GetBoundingBox _get_bounding_box{};
+    };
+
+} //namespace Raychel
+
+#endif //!RAYCHELCORE_STREAMING_OCTTREE_H
@@ -34,11 +34,22 @@
     #include <charconv>
 #else
     #pragma message(                                                                                                             \
-        "IMPORTANT: You are using RaychelCore's replacement for std::from_chars. The integer version only supports the bases 8, 10 and 16!")
-    #include <iomanip>
+        "IMPORTANT: You are using RaychelCore's replacement for <charconv>. long double is parsed slowly and can not be formatted!")
+    #include "./charconv_tables.h"
+
+    #include <algorithm>
+    #include <array>
+    #include <cfloat>
+    #include <cstddef>
+    #include <cstdint>
+    #include <cstring>
+    #include <limits>
+    #include <optional>
     #include <sstream>
     #include <string>
+    #include <string_view>
     #include <system_error>
+    #include <type_traits>
 #endif
 
 namespace Raychel {
@@ -80,6 +91,8 @@ namespace Raychel {
 #else
 
     namespace details {
+
+        //Only used for long double, which has no hand-written parser
         template <typename T, typename = std::enable_if_t<std::is_floating_point_v<T>>>
         from_chars_result
         fp_from_chars_impl(char const* const begin, char const* const end, T& value, std::ios::fmtflags format) noexcept
@@ -96,51 +109,1557 @@ namespace Raychel {
             return {begin, std::errc::invalid_argument};
         }
 
-        template <typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
-        from_chars_result int_from_chars_impl(char const* const begin, char const* const end, T& value, int base) noexcept
+        //Floating-point parsing. Decimal numbers with up to 19 significant digits are converted with the Eisel-Lemire
+        //algorithm (see https://arxiv.org/abs/2101.11408), which always rounds them correctly. Longer numbers are converted
+        //from their first 19 digits as well, unless the remaining digits could change the result. Only then do we fall back
+        //to exact decimal arithmetic. Nothing here allocates
+
+        template <typename T>
+        struct FloatFormat;
+
+        template <>
+        struct FloatFormat<double>
+        {
+            using Bits = std::uint64_t;
+
+            static constexpr int mantissa_bits = 52;
+            static constexpr int minimum_exponent = -1023;
+            static constexpr int infinite_power = 0x7FF;
+
+            //Everything below rounds to zero, everything above to infinity
+            static constexpr int smallest_power_of_ten = -342;
+            static constexpr int largest_power_of_ten = 308;
+
+            //Only in this range can a decimal number be exactly halfway between two floats
+            static constexpr int min_exponent_round_to_even = -4;
+            static constexpr int max_exponent_round_to_even = 23;
+
+            static constexpr int max_exponent_fast_path = 22;
+            static constexpr std::array<double, 23> exact_powers_of_ten{
+                1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        };
+
+        template <>
+        struct FloatFormat<float>
+        {
+            using Bits = std::uint32_t;
+
+            static constexpr int mantissa_bits = 23;
+            static constexpr int minimum_exponent = -127;
+            static constexpr int infinite_power = 0xFF;
+
+            static constexpr int smallest_power_of_ten = -65;
+            static constexpr int largest_power_of_ten = 38;
+
+            static constexpr int min_exponent_round_to_even = -17;
+            static constexpr int max_exponent_round_to_even = 10;
+
+            static constexpr int max_exponent_fast_path = 10;
+            static constexpr std::array<float, 11> exact_powers_of_ten{
+                1e0F, 1e1F, 1e2F, 1e3F, 1e4F, 1e5F, 1e6F, 1e7F, 1e8F, 1e9F, 1e10F};
+        };
+
+        //A float as its biased exponent and its mantissa without the implicit bit
+        struct AdjustedMantissa
+        {
+            std::uint64_t mantissa{};
+            //Negative if the float could not be determined
+            int power2{};
+        };
+
+        struct UInt128
+        {
+            std::uint64_t low{};
+            std::uint64_t high{};
+        };
+
+        [[nodiscard]] inline UInt128 full_multiplication(std::uint64_t lhs, std::uint64_t rhs) noexcept
+        {
+    #if defined(__SIZEOF_INT128__)
+            __extension__ typedef unsigned __int128 uint128; //NOLINT(modernize-use-using): __extension__ needs a typedef
+
+            const auto product = static_cast<uint128>(lhs) * rhs;
+            return {static_cast<std::uint64_t>(product), static_cast<std::uint64_t>(product >> 64U)};
+    #else
+            const auto lhs_low = lhs & 0xFFFF'FFFFU;
+            const auto lhs_high = lhs >> 32U;
+            const auto rhs_low = rhs & 0xFFFF'FFFFU;
+            const auto rhs_high = rhs >> 32U;
+
+            const auto low_low = lhs_low * rhs_low;
+            const auto high_low = lhs_high * rhs_low;
+            const auto low_high = lhs_low * rhs_high;
+            const auto high_high = lhs_high * rhs_high;
+
+            const auto middle = (low_low >> 32U) + (high_low & 0xFFFF'FFFFU) + low_high;
+            return {(middle << 32U) | (low_low & 0xFFFF'FFFFU), high_high + (high_low >> 32U) + (middle >> 32U)};
+    #endif
+        }
+
+        //value must not be 0
+        [[nodiscard]] inline int leading_zeros(std::uint64_t value) noexcept
+        {
+    #if RAYCHEL_ACTIVE_COMPILER == RAYCHEL_COMPILER_GCC || RAYCHEL_ACTIVE_COMPILER == RAYCHEL_COMPILER_CLANG
+            return __builtin_clzll(value);
+    #else
+            int count{};
+            for (auto bit = std::uint64_t{1} << 63U; (value & bit) == 0; bit >>= 1U) {
+                ++count;
+            }
+            return count;
+    #endif
+        }
+
+        [[nodiscard]] constexpr bool is_digit(char c) noexcept
+        {
+            return c >= '0' && c <= '9';
+        }
+
+        [[nodiscard]] constexpr bool is_letter(char c) noexcept
+        {
+            //Setting this bit turns uppercase ASCII letters into lowercase ones
+            const auto lower = c | 0x20;
+            return lower >= 'a' && lower <= 'z';
+        }
+
+        //-1 if c is not a hexadecimal digit
+        [[nodiscard]] constexpr int hex_digit_value(char c) noexcept
+        {
+            if (is_digit(c))
+                return c - '0';
+            const auto lower = c | 0x20;
+            if (lower >= 'a' && lower <= 'f')
+                return lower - 'a' + 10;
+            return -1;
+        }
+
+        //Upper 128 bits of w * 5^q, where the upper Precision bits are exact whenever that can be decided
+        template <int Precision>
+        [[nodiscard]] UInt128 compute_product_approximation(int q, std::uint64_t w) noexcept
+        {
+            const auto index = 2U * static_cast<std::size_t>(q - smallest_power_of_five);
+            constexpr auto precision_mask = std::uint64_t{0xFFFF'FFFF'FFFF'FFFF} >> Precision;
+
+            auto product = full_multiplication(w, power_of_five_128[index]);
+            if ((product.high & precision_mask) == precision_mask) {
+                //The lower half of 5^q might carry into the bits we need
+                const auto low_product = full_multiplication(w, power_of_five_128[index + 1]);
+                product.low += low_product.high;
+                if (low_product.high > product.low)
+                    ++product.high;
+            }
+            return product;
+        }
+
+        //floor(log2(10^q)) + 63
+        [[nodiscard]] constexpr int binary_power(int q) noexcept
+        {
+            return (((152170 + 65536) * q) >> 16) + 63;
+        }
+
+        //Eisel-Lemire: round w * 10^q to the nearest float, ties to even
+        template <typename T>
+        [[nodiscard]] AdjustedMantissa compute_float(std::int64_t q, std::uint64_t w) noexcept
+        {
+            using Format = FloatFormat<T>;
+
+            if (w == 0 || q < Format::smallest_power_of_ten)
+                return {};
+            if (q > Format::largest_power_of_ten)
+                return {0, Format::infinite_power};
+
+            const auto lz = leading_zeros(w);
+            w <<= static_cast<unsigned>(lz);
+            const auto product = compute_product_approximation<Format::mantissa_bits + 3>(static_cast<int>(q), w);
+
+            //The product has its top bit in one of the two highest positions
+            const auto upper_bit = static_cast<int>(product.high >> 63U);
+            const auto shift = static_cast<unsigned>(upper_bit + 64 - Format::mantissa_bits - 3);
+
+            AdjustedMantissa answer{
+                product.high >> shift, binary_power(static_cast<int>(q)) + upper_bit - lz - Format::minimum_exponent};
+
+            if (answer.power2 <= 0) {
+                //Subnormal
+                if (-answer.power2 + 1 >= 64)
+                    return {};
+
+                answer.mantissa >>= static_cast<unsigned>(-answer.power2 + 1);
+                answer.mantissa += answer.mantissa & 1U;
+                answer.mantissa >>= 1U;
+
+                //Rounding up may have produced the smallest normal float
+                answer.power2 = answer.mantissa < (std::uint64_t{1} << Format::mantissa_bits) ? 0 : 1;
+                return answer;
+            }
+
+            //Exactly halfway between two floats, round to even instead of up
+            if (product.low <= 1 && q >= Format::min_exponent_round_to_even && q <= Format::max_exponent_round_to_even &&
+                (answer.mantissa & 3U) == 1 && (answer.mantissa << shift) == product.high) {
+                answer.mantissa &= ~std::uint64_t{1};
+            }
+
+            answer.mantissa += answer.mantissa & 1U;
+            answer.mantissa >>= 1U;
+            if (answer.mantissa >= (std::uint64_t{2} << Format::mantissa_bits)) {
+                answer.mantissa = std::uint64_t{1} << Format::mantissa_bits;
+                ++answer.power2;
+            }
+
+            answer.mantissa &= ~(std::uint64_t{1} << Format::mantissa_bits);
+            if (answer.power2 >= Format::infinite_power)
+                return {0, Format::infinite_power};
+
+            return answer;
+        }
+
+        //Round mantissa * 2^exponent to the nearest float, ties to even. sticky means there are nonzero bits below mantissa
+        template <typename T>
+        [[nodiscard]] AdjustedMantissa binary_to_float(std::uint64_t mantissa, std::int64_t exponent, bool sticky) noexcept
+        {
+            using Format = FloatFormat<T>;
+            constexpr auto hidden_bit = std::uint64_t{1} << Format::mantissa_bits;
+
+            const auto lz = leading_zeros(mantissa);
+            mantissa <<= static_cast<unsigned>(lz);
+
+            auto power2 = exponent + 63 - lz - Format::minimum_exponent;
+            if (power2 >= Format::infinite_power)
+                return {0, Format::infinite_power};
+
+            std::int64_t shift = 63 - Format::mantissa_bits;
+            if (power2 <= 0) {
+                //Subnormal, which has the same exponent as the smallest normal float
+                shift += 1 - power2;
+                power2 = 0;
+            }
+            if (shift > 64)
+                return {};
+
+            const auto dropped = static_cast<unsigned>(shift);
+            auto result = dropped == 64U ? 0U : mantissa >> dropped;
+            const auto remainder = dropped == 64U ? mantissa : mantissa & ((std::uint64_t{1} << dropped) - 1U);
+            const auto half = std::uint64_t{1} << (dropped - 1U);
+            if (remainder > half || (remainder == half && (sticky || (result & 1U) != 0)))
+                ++result;
+
+            if (result == 2 * hidden_bit) {
+                result >>= 1U;
+                if (++power2 >= Format::infinite_power)
+                    return {0, Format::infinite_power};
+            } else if (power2 == 0 && result == hidden_bit) {
+                power2 = 1;
+            }
+
+            return {result & ~hidden_bit, static_cast<int>(power2)};
+        }
+
+        //A decimal number as written, and its first 19 significant digits
+        struct DecimalNumber
+        {
+            //value ~= mantissa * 10^exponent
+            std::uint64_t mantissa{};
+            std::int64_t exponent{};
+            //There were more than 19 significant digits, mantissa only holds the first ones
+            bool too_many_digits{};
+
+            const char* integer_begin{};
+            const char* integer_end{};
+            const char* fraction_begin{};
+            const char* fraction_end{};
+            std::int64_t explicit_exponent{};
+        };
+
+        //Optional sign followed by decimal digits. nullptr if there are no digits
+        [[nodiscard]] inline const char* parse_exponent(const char* ptr, const char* end, std::int64_t& exponent) noexcept
+        {
+            const auto negative = ptr != end && *ptr == '-';
+            if (ptr != end && (*ptr == '-' || *ptr == '+'))
+                ++ptr;
+            if (ptr == end || !is_digit(*ptr))
+                return nullptr;
+
+            std::int64_t value{};
+            for (; ptr != end && is_digit(*ptr); ++ptr) {
+                //Large enough to over- or underflow every float, small enough to never overflow the exponent
+                if (value < 0x1000'0000)
+                    value = 10 * value + (*ptr - '0');
+            }
+            exponent = negative ? -value : value;
+            return ptr;
+        }
+
+        [[nodiscard]] inline from_chars_result
+        parse_decimal(const char* first, const char* end, chars_format fmt, DecimalNumber& number) noexcept
+        {
+            constexpr std::ptrdiff_t max_digits = 19;
+
+            auto* ptr = first;
+            std::uint64_t mantissa{};
+
+            number.integer_begin = ptr;
+            for (; ptr != end && is_digit(*ptr); ++ptr) {
+                //Overflows if there are too many digits, mantissa is recomputed below in that case
+                mantissa = 10 * mantissa + static_cast<std::uint64_t>(*ptr - '0');
+            }
+            number.integer_end = ptr;
+            number.fraction_begin = number.fraction_end = ptr;
+
+            std::int64_t exponent{};
+            if (ptr != end && *ptr == '.') {
+                number.fraction_begin = ++ptr;
+                for (; ptr != end && is_digit(*ptr); ++ptr) {
+                    mantissa = 10 * mantissa + static_cast<std::uint64_t>(*ptr - '0');
+                }
+                number.fraction_end = ptr;
+                exponent = number.fraction_begin - number.fraction_end;
+            }
+
+            auto digit_count = (number.integer_end - number.integer_begin) + (number.fraction_end - number.fraction_begin);
+            if (digit_count == 0)
+                return {first, std::errc::invalid_argument};
+
+            //chars_format::fixed does not allow an exponent, chars_format::scientific requires one
+            auto has_exponent = false;
+            if (fmt != chars_format::fixed && ptr != end && (*ptr == 'e' || *ptr == 'E')) {
+                if (const auto* exponent_end = parse_exponent(ptr + 1, end, number.explicit_exponent); exponent_end != nullptr) {
+                    ptr = exponent_end;
+                    exponent += number.explicit_exponent;
+                    has_exponent = true;
+                }
+            }
+            if (fmt == chars_format::scientific && !has_exponent)
+                return {first, std::errc::invalid_argument};
+
+            if (digit_count > max_digits) {
+                //Leading zeros are not significant
+                for (auto* p = first; p != number.fraction_end && (*p == '0' || *p == '.'); ++p) {
+                    if (*p == '0')
+                        --digit_count;
+                }
+            }
+
+            if (digit_count > max_digits) {
+                number.too_many_digits = true;
+
+                //Take digits until we have 19 of them
+                constexpr std::uint64_t min_19_digit_number{1'000'000'000'000'000'000};
+                mantissa = 0;
+                auto* p = number.integer_begin;
+                for (; mantissa < min_19_digit_number && p != number.integer_end; ++p) {
+                    mantissa = 10 * mantissa + static_cast<std::uint64_t>(*p - '0');
+                }
+                if (mantissa >= min_19_digit_number) {
+                    exponent = (number.integer_end - p) + number.explicit_exponent;
+                } else {
+                    for (p = number.fraction_begin; mantissa < min_19_digit_number && p != number.fraction_end; ++p) {
+                        mantissa = 10 * mantissa + static_cast<std::uint64_t>(*p - '0');
+                    }
+                    exponent = (number.fraction_begin - p) + number.explicit_exponent;
+                }
+            }
+
+            number.mantissa = mantissa;
+            number.exponent = exponent;
+            return {ptr, {}};
+        }
+
+        //The number 0.d1d2d3... * 10^decimal_point. Zero has no digits
+        struct DecimalDigits
+        {
+            const std::uint8_t* digits{};
+            int count{};
+            int decimal_point{};
+
+            //'0' for digits past the end and before the start
+            [[nodiscard]] char operator[](std::int64_t index) const noexcept
+            {
+                return index >= 0 && index < count ? static_cast<char>('0' + digits[index]) : '0';
+            }
+        };
+
+        /**
+        * \brief Decimal number with up to max_digits significant digits that can be multiplied and divided by powers of two
+        *
+        * This is the fallback for the rare numbers that Eisel-Lemire can not round from their first 19 digits. It implements
+        * the "simple decimal conversion" (see https://nigeltao.github.io/blog/2020/parse-number-f64-simple.html).
+        * Every float has at most 767 significant digits, so it can also hold them exactly when formatting with a precision.
+        */
+        class Decimal
         {
-            if (base != 8 && base != 10 && base != 16) {
+        public:
+            //Enough to hold every float exactly, digits beyond this can only make the number slightly larger
+            static constexpr std::size_t max_digits = 800;
+
+            //5^27 is the largest power of five that fits in 64 bits, see _new_digits()
+            static constexpr int max_shift = 27;
+
+            explicit Decimal(const DecimalNumber& number) noexcept
+            {
+                const auto* integer_begin = number.integer_begin;
+                while (integer_begin != number.integer_end && *integer_begin == '0') {
+                    ++integer_begin;
+                }
+                std::int64_t decimal_point = number.integer_end - integer_begin;
+                for (const auto* p = integer_begin; p != number.integer_end; ++p) {
+                    _append(*p);
+                }
+
+                for (const auto* p = number.fraction_begin; p != number.fraction_end; ++p) {
+                    if (digit_count_ == 0 && *p == '0') {
+                        --decimal_point;
+                        continue;
+                    }
+                    _append(*p);
+                }
+
+                //Far beyond the range of every float, but small enough to never overflow
+                decimal_point += number.explicit_exponent;
+                decimal_point_ = static_cast<int>(std::clamp<std::int64_t>(decimal_point, -100'000, 100'000));
+                _trim();
+            }
+
+            explicit Decimal(std::uint64_t value) noexcept
+            {
+                std::array<std::uint8_t, 20> reversed{};
+                std::size_t count{};
+                for (; value != 0; value /= 10) {
+                    reversed[count++] = static_cast<std::uint8_t>(value % 10);
+                }
+                for (; count != 0; --count) {
+                    digits_[digit_count_++] = reversed[count - 1];
+                }
+                decimal_point_ = static_cast<int>(digit_count_);
+                _trim();
+            }
+
+            [[nodiscard]] bool empty() const noexcept
+            {
+                return digit_count_ == 0;
+            }
+
+            [[nodiscard]] DecimalDigits digits() const noexcept
+            {
+                return {digits_.data(), static_cast<int>(digit_count_), decimal_point_};
+            }
+
+            //The number is 0.d1d2d3... * 10^decimal_point
+            [[nodiscard]] int decimal_point() const noexcept
+            {
+                return decimal_point_;
+            }
+
+            [[nodiscard]] std::uint8_t first_digit() const noexcept
+            {
+                return digits_[0];
+            }
+
+            //Multiply by 2^shift, or divide if shift is negative
+            void shift(int shift) noexcept
+            {
+                if (empty())
+                    return;
+
+                for (; shift > max_shift; shift -= max_shift) {
+                    _shift_left(max_shift);
+                }
+                for (; shift < -max_shift; shift += max_shift) {
+                    _shift_right(max_shift);
+                }
+
+                if (shift > 0) {
+                    _shift_left(shift);
+                } else if (shift < 0) {
+                    _shift_right(-shift);
+                }
+            }
+
+            //The integer part, rounded to nearest, ties to even
+            [[nodiscard]] std::uint64_t rounded_integer() const noexcept
+            {
+                if (decimal_point_ > 20)
+                    return std::numeric_limits<std::uint64_t>::max();
+
+                const auto integer_digits = static_cast<std::size_t>(std::max(decimal_point_, 0));
+                std::uint64_t result{};
+                std::size_t i{};
+                for (; i < integer_digits && i < digit_count_; ++i) {
+                    result = 10 * result + digits_[i];
+                }
+                for (; i < integer_digits; ++i) {
+                    result *= 10;
+                }
+
+                if (_should_round_up(integer_digits))
+                    ++result;
+                return result;
+            }
+
+            //Keep the first count digits, rounded to nearest, ties to even
+            void round_to(std::int64_t count) noexcept
+            {
+                if (count < 0) {
+                    //Less than half of the last digit we keep
+                    digit_count_ = 0;
+                    decimal_point_ = 0;
+                    return;
+                }
+                if (static_cast<std::uint64_t>(count) >= digit_count_)
+                    return;
+
+                const auto index = static_cast<std::size_t>(count);
+                const auto round_up = _should_round_up(index);
+                digit_count_ = index;
+                if (round_up) {
+                    while (digit_count_ != 0 && digits_[digit_count_ - 1] == 9) {
+                        --digit_count_;
+                    }
+                    if (digit_count_ == 0) {
+                        //All nines, or nothing was kept
+                        digits_[0] = 1;
+                        digit_count_ = 1;
+                        ++decimal_point_;
+                    } else {
+                        ++digits_[digit_count_ - 1];
+                    }
+                }
+                _trim();
+            }
+
+        private:
+            void _append(char digit) noexcept
+            {
+                if (digit_count_ < max_digits) {
+                    digits_[digit_count_++] = static_cast<std::uint8_t>(digit - '0');
+                } else if (digit != '0') {
+                    truncated_ = true;
+                }
+            }
+
+            void _store(std::size_t index, std::uint64_t digit) noexcept
+            {
+                if (index < max_digits) {
+                    digits_[index] = static_cast<std::uint8_t>(digit);
+                } else if (digit != 0) {
+                    truncated_ = true;
+                }
+            }
+
+            void _trim() noexcept
+            {
+                while (digit_count_ != 0 && digits_[digit_count_ - 1] == 0) {
+                    --digit_count_;
+                }
+                if (digit_count_ == 0)
+                    decimal_point_ = 0;
+            }
+
+            [[nodiscard]] bool _should_round_up(std::size_t index) const noexcept
+            {
+                if (index >= digit_count_)
+                    return false;
+
+                //Exactly halfway, since trailing zeros are trimmed. Truncated digits make the number slightly larger
+                if (digits_[index] == 5 && index + 1 == digit_count_)
+                    return truncated_ || (index != 0 && digits_[index - 1] % 2 == 1);
+
+                return digits_[index] >= 5;
+            }
+
+            //Multiplying by 2^shift adds as many digits as 2^shift has, or one less if our digits are less than those of 5^shift
+            [[nodiscard]] std::size_t _new_digits(int shift) const noexcept
+            {
+                std::uint64_t power_of_five{1};
+                for (int i{}; i != shift; ++i) {
+                    power_of_five *= 5;
+                }
+
+                std::array<std::uint8_t, 20> five_digits{};
+                std::size_t five_digit_count{};
+                for (; power_of_five != 0; power_of_five /= 10) {
+                    five_digits[five_digit_count++] = static_cast<std::uint8_t>(power_of_five % 10);
+                }
+
+                std::size_t new_digits{};
+                for (auto power_of_two = std::uint64_t{1} << static_cast<unsigned>(shift); power_of_two != 0;
+                     power_of_two /= 10) {
+                    ++new_digits;
+                }
+
+                //five_digits are stored least significant first
+                for (std::size_t i{}; i != five_digit_count; ++i) {
+                    const auto five_digit = five_digits[five_digit_count - 1 - i];
+                    if (i >= digit_count_)
+                        return new_digits - 1;
+                    if (digits_[i] != five_digit)
+                        return digits_[i] < five_digit ? new_digits - 1 : new_digits;
+                }
+                return new_digits;
+            }
+
+            void _shift_left(int shift) noexcept
+            {
+                const auto new_digits = _new_digits(shift);
+
+                auto read = digit_count_;
+                auto write = digit_count_ + new_digits;
+                std::uint64_t n{};
+                while (read != 0) {
+                    n += std::uint64_t{digits_[--read]} << static_cast<unsigned>(shift);
+                    _store(--write, n % 10);
+                    n /= 10;
+                }
+                while (n != 0) {
+                    _store(--write, n % 10);
+                    n /= 10;
+                }
+
+                digit_count_ = std::min(digit_count_ + new_digits, max_digits);
+                decimal_point_ += static_cast<int>(new_digits);
+                _trim();
+            }
+
+            void _shift_right(int shift) noexcept
+            {
+                const auto bits = static_cast<unsigned>(shift);
+                const auto mask = (std::uint64_t{1} << bits) - 1;
+
+                std::size_t read{};
+                std::size_t write{};
+                std::uint64_t n{};
+
+                //Read until the first digit of the result is known
+                for (; (n >> bits) == 0; ++read) {
+                    if (read >= digit_count_) {
+                        if (n == 0) {
+                            digit_count_ = 0;
+                            decimal_point_ = 0;
+                            return;
+                        }
+                        for (; (n >> bits) == 0; ++read) {
+                            n *= 10;
+                        }
+                        break;
+                    }
+                    n = 10 * n + digits_[read];
+                }
+                decimal_point_ -= static_cast<int>(read) - 1;
+
+                for (; read < digit_count_; ++read) {
+                    digits_[write++] = static_cast<std::uint8_t>(n >> bits);
+                    n = 10 * (n & mask) + digits_[read];
+                }
+                while (n != 0) {
+                    const auto digit = n >> bits;
+                    n = 10 * (n & mask);
+                    if (write < max_digits) {
+                        digits_[write++] = static_cast<std::uint8_t>(digit);
+                    } else if (digit != 0) {
+                        truncated_ = true;
+                    }
+                }
+
+                digit_count_ = write;
+                _trim();
+            }
+
+            std::array<std::uint8_t, max_digits> digits_{};
+            std::size_t digit_count_{};
+            int decimal_point_{};
+            //Nonzero digits were dropped
+            bool truncated_{};
+        };
+
+        template <typename T>
+        [[nodiscard]] AdjustedMantissa decimal_to_float(const DecimalNumber& number) noexcept
+        {
+            using Format = FloatFormat<T>;
+            constexpr AdjustedMantissa infinity{0, Format::infinite_power};
+            constexpr auto hidden_bit = std::uint64_t{1} << Format::mantissa_bits;
+
+            //Shifts that keep a number with this many integer digits above 1 (or fractional zeros below 1)
+            constexpr std::array<int, 9> shifts{1, 3, 6, 9, 13, 16, 19, 23, 26};
+            const auto shift_for = [&](int digits) {
+                return digits < static_cast<int>(shifts.size()) ? shifts[static_cast<std::size_t>(digits)] : Decimal::max_shift;
+            };
+
+            Decimal decimal{number};
+            if (decimal.empty() || decimal.decimal_point() < -330)
+                return {};
+            if (decimal.decimal_point() > 310)
+                return infinity;
+
+            //Scale the decimal into [1/2, 1)
+            int exponent{};
+            while (decimal.decimal_point() > 0) {
+                const auto shift = shift_for(decimal.decimal_point());
+                decimal.shift(-shift);
+                exponent += shift;
+            }
+            while (decimal.decimal_point() < 0 || (decimal.decimal_point() == 0 && decimal.first_digit() < 5)) {
+                const auto shift = shift_for(-decimal.decimal_point());
+                decimal.shift(shift);
+                exponent -= shift;
+            }
+
+            //The number is in [1, 2) * 2^exponent now
+            --exponent;
+            constexpr auto smallest_exponent = Format::minimum_exponent + 1;
+            if (exponent < smallest_exponent) {
+                decimal.shift(exponent - smallest_exponent);
+                exponent = smallest_exponent;
+            }
+            if (exponent - Format::minimum_exponent >= Format::infinite_power)
+                return infinity;
+
+            decimal.shift(Format::mantissa_bits + 1);
+            auto mantissa = decimal.rounded_integer();
+            if (mantissa == 2 * hidden_bit) {
+                mantissa >>= 1U;
+                if (++exponent - Format::minimum_exponent >= Format::infinite_power)
+                    return infinity;
+            }
+
+            //Subnormal
+            if ((mantissa & hidden_bit) == 0)
+                return {mantissa, 0};
+
+            return {mantissa & ~hidden_bit, exponent - Format::minimum_exponent};
+        }
+
+        //Clinger's fast path: if both the mantissa and the power of ten are exact floats, a single correctly rounded
+        //multiplication or division gives the correctly rounded result. Needs floats to be evaluated in their own precision
+        template <typename T>
+        [[nodiscard]] bool is_exact(const DecimalNumber& number) noexcept
+        {
+            using Format = FloatFormat<T>;
+            return FLT_EVAL_METHOD == 0 && !number.too_many_digits && number.exponent >= -Format::max_exponent_fast_path &&
+                   number.exponent <= Format::max_exponent_fast_path &&
+                   number.mantissa <= (std::uint64_t{2} << Format::mantissa_bits);
+        }
+
+        template <typename T>
+        [[nodiscard]] T exact_value(const DecimalNumber& number) noexcept
+        {
+            const auto& powers = FloatFormat<T>::exact_powers_of_ten;
+            const auto value = static_cast<T>(number.mantissa);
+            if (number.exponent < 0)
+                return value / powers[static_cast<std::size_t>(-number.exponent)];
+            return value * powers[static_cast<std::size_t>(number.exponent)];
+        }
+
+        template <typename T>
+        [[nodiscard]] AdjustedMantissa decimal_to_float_fast(const DecimalNumber& number) noexcept
+        {
+            auto result = compute_float<T>(number.exponent, number.mantissa);
+
+            //The digits we dropped only matter if they could round the number up to the next float
+            if (number.too_many_digits && result.power2 >= 0) {
+                const auto rounded_up = compute_float<T>(number.exponent, number.mantissa + 1);
+                if (rounded_up.mantissa != result.mantissa || rounded_up.power2 != result.power2)
+                    return decimal_to_float<T>(number);
+            }
+            return result;
+        }
+
+        //Hexadecimal digits with an optional binary exponent, without the "0x" prefix
+        template <typename T>
+        [[nodiscard]] from_chars_result
+        parse_hex_float(const char* first, const char* end, AdjustedMantissa& result, bool& nonzero) noexcept
+        {
+            //Keeps the first 16 significant digits, which are more than any float needs
+            std::uint64_t mantissa{};
+            std::int64_t exponent{};
+            bool sticky{};
+            std::ptrdiff_t digit_count{};
+
+            auto* ptr = first;
+            for (; ptr != end && hex_digit_value(*ptr) >= 0; ++ptr, ++digit_count) {
+                const auto digit = static_cast<std::uint64_t>(hex_digit_value(*ptr));
+                if ((mantissa >> 60U) == 0) {
+                    mantissa = (mantissa << 4U) | digit;
+                } else {
+                    sticky |= digit != 0;
+                    exponent += 4;
+                }
+            }
+            if (ptr != end && *ptr == '.') {
+                for (++ptr; ptr != end && hex_digit_value(*ptr) >= 0; ++ptr, ++digit_count) {
+                    const auto digit = static_cast<std::uint64_t>(hex_digit_value(*ptr));
+                    if ((mantissa >> 60U) == 0) {
+                        mantissa = (mantissa << 4U) | digit;
+                        exponent -= 4;
+                    } else {
+                        sticky |= digit != 0;
+                    }
+                }
+            }
+            if (digit_count == 0)
+                return {first, std::errc::invalid_argument};
+
+            if (ptr != end && (*ptr == 'p' || *ptr == 'P')) {
+                std::int64_t explicit_exponent{};
+                if (const auto* exponent_end = parse_exponent(ptr + 1, end, explicit_exponent); exponent_end != nullptr) {
+                    ptr = exponent_end;
+                    exponent += explicit_exponent;
+                }
+            }
+
+            nonzero = mantissa != 0;
+            result = nonzero ? binary_to_float<T>(mantissa, exponent, sticky) : AdjustedMantissa{};
+            return {ptr, {}};
+        }
+
+        //"inf", "infinity" or "nan" with an optional "(n-char-sequence)", in any case. nullptr if there is none
+        template <typename T>
+        [[nodiscard]] const char* parse_special_float(const char* first, const char* end, bool negative, T& value) noexcept
+        {
+            const auto starts_with = [&](std::string_view word) {
+                if (static_cast<std::size_t>(end - first) < word.size())
+                    return false;
+                for (std::size_t i{}; i != word.size(); ++i) {
+                    if ((first[i] | 0x20) != word[i])
+                        return false;
+                }
+                return true;
+            };
+
+            if (starts_with("nan")) {
+                const auto* ptr = first + 3;
+                if (ptr != end && *ptr == '(') {
+                    for (const auto* p = ptr + 1; p != end && (is_digit(*p) || is_letter(*p) || *p == '_' || *p == ')'); ++p) {
+                        if (*p == ')') {
+                            ptr = p + 1;
+                            break;
+                        }
+                    }
+                }
+                value = negative ? -std::numeric_limits<T>::quiet_NaN() : std::numeric_limits<T>::quiet_NaN();
+                return ptr;
+            }
+
+            if (starts_with("inf")) {
+                value = negative ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::infinity();
+                return first + (starts_with("infinity") ? 8 : 3);
+            }
+
+            return nullptr;
+        }
+
+        template <typename T>
+        [[nodiscard]] from_chars_result
+        store_float(const char* ptr, AdjustedMantissa result, bool negative, bool nonzero, T& value) noexcept
+        {
+            using Format = FloatFormat<T>;
+            using Bits = typename Format::Bits;
+
+            //Overflow to infinity, or underflow to zero
+            if (result.power2 == Format::infinite_power || (nonzero && result.power2 == 0 && result.mantissa == 0))
+                return {ptr, std::errc::result_out_of_range};
+
+            auto bits = static_cast<Bits>(result.mantissa | (static_cast<std::uint64_t>(result.power2) << Format::mantissa_bits));
+            if (negative)
+                bits |= Bits{1} << (8 * sizeof(Bits) - 1);
+
+            std::memcpy(&value, &bits, sizeof(value));
+            return {ptr, {}};
+        }
+
+        template <typename T>
+        [[nodiscard]] from_chars_result float_from_chars(const char* begin, const char* end, T& value, chars_format fmt) noexcept
+        {
+            const auto* first = begin;
+            const auto negative = first != end && *first == '-';
+            if (negative)
+                ++first;
+
+            if (const auto* special_end = parse_special_float(first, end, negative, value); special_end != nullptr)
+                return {special_end, {}};
+
+            if (fmt == chars_format::hex) {
+                AdjustedMantissa result{};
+                bool nonzero{};
+                const auto [ptr, ec] = parse_hex_float<T>(first, end, result, nonzero);
+                if (ec != std::errc{})
+                    return {begin, ec};
+                return store_float(ptr, result, negative, nonzero, value);
+            }
+
+            DecimalNumber number{};
+            const auto [ptr, ec] = parse_decimal(first, end, fmt, number);
+            if (ec != std::errc{})
+                return {begin, ec};
+
+            if (is_exact<T>(number)) {
+                const auto result = exact_value<T>(number);
+                value = negative ? -result : result;
+                return {ptr, {}};
+            }
+
+            return store_float(ptr, decimal_to_float_fast<T>(number), negative, number.mantissa != 0, value);
+        }
+
+        //Integer parsing. Like std::from_chars, we accept no prefix, no '+' and no whitespace. ptr points at the first
+        //character that is not a digit, even if the number is out of range
+
+        //Value of c as a digit in base 36, or 36 if it is no digit at all
+        [[nodiscard]] constexpr unsigned digit_value(char c) noexcept
+        {
+            if (is_digit(c))
+                return static_cast<unsigned>(c - '0');
+            if (is_letter(c))
+                return static_cast<unsigned>((c | 0x20) - 'a' + 10);
+            return 36U;
+        }
+
+        //The first character ends up in the lowest byte, regardless of endianness
+        [[nodiscard]] inline std::uint64_t load_eight_characters(const char* ptr) noexcept
+        {
+            std::uint64_t chunk{};
+            for (unsigned i{}; i != 8U; ++i) {
+                chunk |= std::uint64_t{static_cast<unsigned char>(ptr[i])} << (8U * i);
+            }
+            return chunk;
+        }
+
+        [[nodiscard]] constexpr bool are_eight_digits(std::uint64_t chunk) noexcept
+        {
+            //Digits are 0x30 to 0x39. Adding 6 carries into the upper half of every byte above 0x39
+            constexpr std::uint64_t upper_halves = 0xF0F0F0F0F0F0F0F0;
+            return ((chunk & upper_halves) | (((chunk + 0x0606060606060606) & upper_halves) >> 4U)) == 0x3333333333333333;
+        }
+
+        //Value of eight decimal digits loaded with load_eight_characters, using SWAR (SIMD within a register)
+        [[nodiscard]] constexpr std::uint32_t parse_eight_digits(std::uint64_t chunk) noexcept
+        {
+            constexpr std::uint64_t mask = 0x000000FF000000FF;
+            constexpr std::uint64_t pair_multipliers = 100 + (std::uint64_t{1'000'000} << 32U);
+            constexpr std::uint64_t quad_multipliers = 1 + (std::uint64_t{10'000} << 32U);
+
+            chunk -= 0x3030303030303030;
+            //Every other byte now holds the value of two neighbouring digits
+            chunk = (chunk * 10) + (chunk >> 8U);
+            //Combine those four pairs with their place values in the upper half
+            return static_cast<std::uint32_t>(
+                (((chunk & mask) * pair_multipliers) + (((chunk >> 16U) & mask) * quad_multipliers)) >> 32U);
+        }
+
+        template <typename T>
+        [[nodiscard]] from_chars_result
+        int_from_chars_impl(char const* const begin, char const* const end, T& value, int base) noexcept
+        {
+            //At least as wide as unsigned, so that arithmetic on it is not promoted to int
+            using Unsigned = std::conditional_t<(sizeof(T) < sizeof(unsigned)), unsigned, std::make_unsigned_t<T>>;
+
+            if (base < 2 || base > 36)
                 return {begin, std::errc::invalid_argument};
+
+            const auto* ptr = begin;
+            bool negative{false};
+            if constexpr (std::is_signed_v<T>) {
+                if (ptr != end && *ptr == '-') {
+                    negative = true;
+                    ++ptr;
+                }
             }
 
-            std::istringstream stream{std::string{begin, end}};
-            stream.imbue(std::locale::classic());
-            stream >> std::setbase(base);
+            //The magnitude of the smallest signed value is one more than that of the largest
+            const auto limit = static_cast<Unsigned>(static_cast<Unsigned>(std::numeric_limits<T>::max()) + (negative ? 1U : 0U));
+            const auto radix = static_cast<Unsigned>(base);
+            const auto cutoff = static_cast<Unsigned>(limit / radix);
+            const auto cutoff_digit = static_cast<Unsigned>(limit % radix);
 
-            if (T val; (stream >> val)) {
-                value = val;
-                return {end, {}};
+            const auto* const digits_begin = ptr;
+            Unsigned magnitude{};
+            bool out_of_range{false};
+
+            if (base == 10) {
+                //Eight digits at a time, for as long as that can not wrap around
+                constexpr auto largest_before_chunk = (std::numeric_limits<Unsigned>::max() - 99'999'999U) / 100'000'000U;
+                while (end - ptr >= 8 && magnitude <= largest_before_chunk) {
+                    const auto chunk = load_eight_characters(ptr);
+                    if (!are_eight_digits(chunk))
+                        break;
+                    magnitude = static_cast<Unsigned>(magnitude * 100'000'000U + parse_eight_digits(chunk));
+                    ptr += 8;
+                }
+                out_of_range = magnitude > limit;
             }
 
-            return {begin, std::errc::invalid_argument};
+            for (; ptr != end; ++ptr) {
+                const auto digit = digit_value(*ptr);
+                if (digit >= radix)
+                    break;
+
+                //Keep going to find the end of the number
+                if (out_of_range || magnitude > cutoff || (magnitude == cutoff && digit > cutoff_digit)) {
+                    out_of_range = true;
+                    continue;
+                }
+                magnitude = static_cast<Unsigned>(magnitude * radix + digit);
+            }
+
+            if (ptr == digits_begin)
+                return {begin, std::errc::invalid_argument};
+            if (out_of_range)
+                return {ptr, std::errc::result_out_of_range};
+
+            //Negate in Unsigned, where it can not overflow
+            value = static_cast<T>(negative ? static_cast<Unsigned>(Unsigned{0} - magnitude) : magnitude);
+            return {ptr, {}};
+        }
+
+        //Integer and floating-point formatting
+
+        inline constexpr std::string_view digit_characters = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+        inline constexpr auto decimal_digit_pairs = [] {
+            std::array<char, 200> pairs{};
+            for (std::size_t i{}; i != 100; ++i) {
+                pairs[2 * i] = static_cast<char>('0' + i / 10);
+                pairs[2 * i + 1] = static_cast<char>('0' + i % 10);
+            }
+            return pairs;
+        }();
+
+        template <typename Unsigned>
+        [[nodiscard]] int digit_count(Unsigned value, unsigned base) noexcept
+        {
+            int count{1};
+            for (; value >= base; value = static_cast<Unsigned>(value / base)) {
+                ++count;
+            }
+            return count;
+        }
+
+        //Write the decimal digits of value so that they end at end. Returns where they start
+        template <typename Unsigned>
+        char* write_decimal_backwards(char* end, Unsigned value) noexcept
+        {
+            //Two digits at a time
+            while (value >= 100) {
+                const auto pair = static_cast<std::size_t>(value % 100) * 2;
+                value = static_cast<Unsigned>(value / 100);
+                *--end = decimal_digit_pairs[pair + 1];
+                *--end = decimal_digit_pairs[pair];
+            }
+            if (value >= 10) {
+                const auto pair = static_cast<std::size_t>(value) * 2;
+                *--end = decimal_digit_pairs[pair + 1];
+                *--end = decimal_digit_pairs[pair];
+            } else {
+                *--end = static_cast<char>('0' + value);
+            }
+            return end;
         }
+
+        template <typename T>
+        [[nodiscard]] to_chars_result int_to_chars_impl(char* first, char* last, T value, int base) noexcept
+        {
+            using Unsigned = std::make_unsigned_t<T>;
+
+            if (base < 2 || base > 36)
+                return {first, std::errc::invalid_argument};
+
+            auto magnitude = static_cast<Unsigned>(value);
+            if constexpr (std::is_signed_v<T>) {
+                if (value < 0) {
+                    if (first == last)
+                        return {last, std::errc::value_too_large};
+                    *first++ = '-';
+                    magnitude = static_cast<Unsigned>(Unsigned{0} - magnitude);
+                }
+            }
+
+            const auto count = digit_count(magnitude, static_cast<unsigned>(base));
+            if (last - first < count)
+                return {last, std::errc::value_too_large};
+
+            auto* const end = first + count;
+            if (base == 10) {
+                write_decimal_backwards(end, magnitude);
+            } else {
+                auto* ptr = end;
+                do {
+                    *--ptr = digit_characters[static_cast<std::size_t>(magnitude % static_cast<unsigned>(base))];
+                    magnitude = static_cast<Unsigned>(magnitude / static_cast<unsigned>(base));
+                } while (magnitude != 0);
+            }
+            return {end, {}};
+        }
+
+        //Shortest decimal that rounds to a float, as significand * 10^exponent
+        struct ShortestDecimal
+        {
+            std::uint64_t significand{};
+            int exponent{};
+        };
+
+        //Upper 128 bits of 10^e, rounded down and incremented by one, normalized like power_of_five_128
+        [[nodiscard]] inline UInt128 power_of_ten_significand(int e) noexcept
+        {
+            const auto index = 2U * static_cast<std::size_t>(e - smallest_power_of_five);
+            UInt128 result{power_of_five_128[index + 1], power_of_five_128[index]};
+
+            //These entries are rounded up already
+            if (e >= -27 && e < 0)
+                return result;
+
+            if (++result.low == 0)
+                ++result.high;
+            return result;
+        }
+
+        //Upper 64 bits of g * cp / 2^64, with the lowest bit set if the result is inexact
+        [[nodiscard]] inline std::uint64_t round_to_odd(UInt128 g, std::uint64_t cp) noexcept
+        {
+            const auto low = full_multiplication(g.low, cp);
+            const auto high = full_multiplication(g.high, cp);
+            const auto middle = high.low + low.high;
+            const auto upper = high.high + (middle < high.low ? 1U : 0U);
+            return upper | (middle > 1 ? 1U : 0U);
+        }
+
+        /**
+        * \brief Find the shortest decimal that rounds to a positive float, using the Schubfach algorithm
+        *
+        * Of all decimals with the fewest digits that round to the float, the one closest to it is returned, ties to even.
+        * See Raffaello Giulietti, "The Schubfach way to render doubles".
+        *
+        * \param ieee_mantissa Mantissa bits of the float
+        * \param ieee_exponent Biased exponent bits of the float. The float must be finite and not zero
+        * \return The decimal, which may have trailing zeros
+        */
+        template <typename T>
+        [[nodiscard]] ShortestDecimal to_shortest_decimal(std::uint64_t ieee_mantissa, int ieee_exponent) noexcept
+        {
+            using Format = FloatFormat<T>;
+            constexpr auto hidden_bit = std::uint64_t{1} << Format::mantissa_bits;
+            constexpr auto exponent_bias = -Format::minimum_exponent + Format::mantissa_bits;
+
+            //The float is c * 2^q
+            std::uint64_t c{};
+            int q{};
+            if (ieee_exponent != 0) {
+                c = hidden_bit | ieee_mantissa;
+                q = ieee_exponent - exponent_bias;
+
+                //Integers that fit in the mantissa are their own shortest decimal
+                if (q <= 0 && -q <= Format::mantissa_bits && (c & ((std::uint64_t{1} << static_cast<unsigned>(-q)) - 1)) == 0)
+                    return {c >> static_cast<unsigned>(-q), 0};
+            } else {
+                c = ieee_mantissa;
+                q = 1 - exponent_bias;
+            }
+
+            const auto is_even = (c % 2) == 0;
+            //The float below a power of two is closer than the one above it
+            const auto lower_boundary_is_closer = ieee_mantissa == 0 && ieee_exponent > 1;
+
+            //The float and the boundaries of the decimals that round to it, scaled by 4
+            const auto cb_left = 4 * c - 2 + (lower_boundary_is_closer ? 1U : 0U);
+            const auto cb = 4 * c;
+            const auto cb_right = 4 * c + 2;
+
+            //k = floor(log10(2^q)), or floor(log10(3/4 * 2^q)) if the lower boundary is closer
+            const auto k = (q * 1262611 - (lower_boundary_is_closer ? 524031 : 0)) >> 22;
+            //h = q + floor(log2(10^-k)) + 1, which is in [1, 4]
+            const auto h = static_cast<unsigned>(q + ((-k * 1741647) >> 19) + 1);
+
+            const auto g = power_of_ten_significand(-k);
+            const auto v_left = round_to_odd(g, cb_left << h);
+            const auto v = round_to_odd(g, cb << h);
+            const auto v_right = round_to_odd(g, cb_right << h);
+
+            //The boundaries themselves round to the float if its mantissa is even
+            const auto lower = v_left + (is_even ? 0U : 1U);
+            const auto upper = v_right - (is_even ? 0U : 1U);
+
+            //Try one digit less first
+            const auto s = v / 4;
+            if (s >= 10) {
+                const auto shorter = s / 10;
+                const auto shorter_below_inside = lower <= 40 * shorter;
+                const auto shorter_above_inside = 40 * shorter + 40 <= upper;
+                if (shorter_below_inside != shorter_above_inside)
+                    return {shorter + (shorter_above_inside ? 1U : 0U), k + 1};
+            }
+
+            const auto below_inside = lower <= 4 * s;
+            const auto above_inside = 4 * s + 4 <= upper;
+            if (below_inside != above_inside)
+                return {s + (above_inside ? 1U : 0U), k};
+
+            //Both are inside, take the closer one
+            const auto middle = 4 * s + 2;
+            const auto round_up = v > middle || (v == middle && (s & 1U) != 0);
+            return {s + (round_up ? 1U : 0U), k};
+        }
+
+        [[nodiscard]] inline to_chars_result
+        write_fixed(char* first, char* last, bool negative, DecimalDigits digits, std::int64_t precision) noexcept
+        {
+            const std::int64_t integer_digits = std::max(digits.decimal_point, 1);
+            const auto length = (negative ? 1 : 0) + integer_digits + (precision > 0 ? precision + 1 : 0);
+            if (last - first < length)
+                return {last, std::errc::value_too_large};
+
+            if (negative)
+                *first++ = '-';
+
+            if (digits.decimal_point <= 0) {
+                *first++ = '0';
+            } else {
+                for (std::int64_t i{}; i != integer_digits; ++i) {
+                    *first++ = digits[i];
+                }
+            }
+            if (precision > 0) {
+                *first++ = '.';
+                for (std::int64_t i{}; i != precision; ++i) {
+                    *first++ = digits[digits.decimal_point + i];
+                }
+            }
+            return {first, {}};
+        }
+
+        [[nodiscard]] inline to_chars_result
+        write_scientific(char* first, char* last, bool negative, DecimalDigits digits, std::int64_t precision) noexcept
+        {
+            const auto exponent = digits.count == 0 ? 0 : digits.decimal_point - 1;
+            const auto exponent_magnitude = static_cast<unsigned>(exponent < 0 ? -exponent : exponent);
+            const auto exponent_digits = std::max(digit_count(exponent_magnitude, 10U), 2);
+
+            const auto length = (negative ? 1 : 0) + 1 + (precision > 0 ? precision + 1 : 0) + 2 + exponent_digits;
+            if (last - first < length)
+                return {last, std::errc::value_too_large};
+
+            if (negative)
+                *first++ = '-';
+
+            *first++ = digits[0];
+            if (precision > 0) {
+                *first++ = '.';
+                for (std::int64_t i{}; i != precision; ++i) {
+                    *first++ = digits[i + 1];
+                }
+            }
+
+            *first++ = 'e';
+            *first++ = exponent < 0 ? '-' : '+';
+            first += exponent_digits;
+            auto* const exponent_start = write_decimal_backwards(first, exponent_magnitude);
+            std::fill(first - exponent_digits, exponent_start, '0');
+            return {first, {}};
+        }
+
+        //Hexadecimal mantissa without the "0x" prefix and a binary exponent. A negative precision writes every digit that is
+        //not zero
+        template <typename T>
+        [[nodiscard]] to_chars_result
+        write_hex(char* first, char* last, bool negative, std::uint64_t ieee_mantissa, int ieee_exponent, int precision) noexcept
+        {
+            using Format = FloatFormat<T>;
+            constexpr int hex_digits = (Format::mantissa_bits + 3) / 4;
+
+            auto leading_digit = ieee_exponent == 0 ? 0U : 1U;
+            int exponent{};
+            if (ieee_exponent != 0) {
+                exponent = ieee_exponent + Format::minimum_exponent;
+            } else if (ieee_mantissa != 0) {
+                //Subnormals have the exponent of the smallest normal float
+                exponent = 1 + Format::minimum_exponent;
+            }
+
+            auto fraction = ieee_mantissa << static_cast<unsigned>(4 * hex_digits - Format::mantissa_bits);
+            int fraction_digits{hex_digits};
+            if (precision < 0) {
+                for (; fraction_digits != 0 && (fraction & 0xFU) == 0; --fraction_digits) {
+                    fraction >>= 4U;
+                }
+                precision = fraction_digits;
+            } else if (precision < hex_digits) {
+                const auto dropped = static_cast<unsigned>(4 * (hex_digits - precision));
+                const auto remainder = fraction & ((std::uint64_t{1} << dropped) - 1);
+                const auto half = std::uint64_t{1} << (dropped - 1);
+                fraction >>= dropped;
+                fraction_digits = precision;
+
+                const auto odd = ((precision == 0 ? leading_digit : fraction) & 1U) != 0;
+                if (remainder > half || (remainder == half && odd)) {
+                    //May carry into the leading digit
+                    if ((++fraction >> static_cast<unsigned>(4 * precision)) != 0) {
+                        fraction = 0;
+                        ++leading_digit;
+                    }
+                }
+            }
+
+            const auto exponent_magnitude = static_cast<unsigned>(exponent < 0 ? -exponent : exponent);
+            const auto exponent_digits = digit_count(exponent_magnitude, 10U);
+            const auto length = (negative ? 1 : 0) + 1 + (precision > 0 ? std::int64_t{precision} + 1 : 0) + 2 + exponent_digits;
+            if (last - first < length)
+                return {last, std::errc::value_too_large};
+
+            if (negative)
+                *first++ = '-';
+
+            *first++ = digit_characters[leading_digit];
+            if (precision > 0) {
+                *first++ = '.';
+                for (auto i = fraction_digits; i != 0; --i) {
+                    *first++ = digit_characters[(fraction >> static_cast<unsigned>(4 * (i - 1))) & 0xFU];
+                }
+                first = std::fill_n(first, precision - fraction_digits, '0');
+            }
+
+            *first++ = 'p';
+            *first++ = exponent < 0 ? '-' : '+';
+            first += exponent_digits;
+            write_decimal_backwards(first, exponent_magnitude);
+            return {first, {}};
+        }
+
+        //The float as sign, biased exponent and mantissa
+        struct FloatParts
+        {
+            bool negative{};
+            int exponent{};
+            std::uint64_t mantissa{};
+        };
+
+        template <typename T>
+        [[nodiscard]] FloatParts float_parts(T value) noexcept
+        {
+            using Format = FloatFormat<T>;
+            using Bits = typename Format::Bits;
+
+            Bits bits{};
+            std::memcpy(&bits, &value, sizeof(bits));
+
+            constexpr auto sign_shift = 8 * sizeof(Bits) - 1;
+            return {
+                (bits >> sign_shift) != 0,
+                static_cast<int>((bits >> Format::mantissa_bits) & static_cast<Bits>(Format::infinite_power)),
+                bits & ((Bits{1} << Format::mantissa_bits) - 1)};
+        }
+
+        //"inf" or "nan"
+        [[nodiscard]] inline to_chars_result write_special(char* first, char* last, const FloatParts& parts) noexcept
+        {
+            const std::string_view text = parts.mantissa == 0 ? "inf" : "nan";
+            if (last - first < static_cast<std::ptrdiff_t>(text.size()) + (parts.negative ? 1 : 0))
+                return {last, std::errc::value_too_large};
+
+            if (parts.negative)
+                *first++ = '-';
+            return {std::copy(text.begin(), text.end(), first), {}};
+        }
+
+        //The exact value of a float, which is c * 2^q
+        template <typename T>
+        [[nodiscard]] Decimal exact_decimal(const FloatParts& parts) noexcept
+        {
+            using Format = FloatFormat<T>;
+            constexpr auto exponent_bias = -Format::minimum_exponent + Format::mantissa_bits;
+
+            if (parts.exponent == 0) {
+                Decimal decimal{parts.mantissa};
+                decimal.shift(1 - exponent_bias);
+                return decimal;
+            }
+
+            Decimal decimal{parts.mantissa | (std::uint64_t{1} << Format::mantissa_bits)};
+            decimal.shift(parts.exponent - exponent_bias);
+            return decimal;
+        }
+
+        //Integers larger than the mantissa may have more digits than their shortest decimal. Formatting them in fixed
+        //notation writes every digit
+        template <typename T>
+        [[nodiscard]] bool is_large_integer(const FloatParts& parts) noexcept
+        {
+            using Format = FloatFormat<T>;
+            return parts.exponent > Format::mantissa_bits - Format::minimum_exponent;
+        }
+
+        //Shortest representation. fmt is empty for the overload without a format, which picks the shorter of fixed and
+        //scientific notation
+        template <typename T>
+        [[nodiscard]] to_chars_result
+        float_to_chars_shortest(char* first, char* last, T value, std::optional<chars_format> fmt) noexcept
+        {
+            const auto parts = float_parts(value);
+            if (parts.exponent == FloatFormat<T>::infinite_power)
+                return write_special(first, last, parts);
+
+            if (fmt == chars_format::hex)
+                return write_hex<T>(first, last, parts.negative, parts.mantissa, parts.exponent, -1);
+
+            std::array<std::uint8_t, 20> buffer{};
+            DecimalDigits digits{buffer.data(), 0, 0};
+            if (parts.exponent != 0 || parts.mantissa != 0) {
+                auto [significand, exponent] = to_shortest_decimal<T>(parts.mantissa, parts.exponent);
+                for (; significand % 10 == 0; significand /= 10) {
+                    ++exponent;
+                }
+
+                std::array<char, 20> characters{};
+                const auto* start = write_decimal_backwards(characters.data() + characters.size(), significand);
+                digits.count = static_cast<int>(characters.data() + characters.size() - start);
+                digits.decimal_point = digits.count + exponent;
+                for (int i{}; i != digits.count; ++i) {
+                    buffer[static_cast<std::size_t>(i)] = static_cast<std::uint8_t>(start[i] - '0');
+                }
+            }
+
+            const auto fixed_precision = std::max(digits.count - digits.decimal_point, 0);
+            const auto scientific_precision = std::max(digits.count - 1, 0);
+            const auto exponent = digits.count == 0 ? 0 : digits.decimal_point - 1;
+
+            auto use_fixed = false;
+            if (!fmt.has_value()) {
+                //Prefer fixed notation if both are equally long
+                const auto fixed_length = std::max(digits.decimal_point, 1) + (fixed_precision > 0 ? fixed_precision + 1 : 0);
+                const auto scientific_length =
+                    1 + (scientific_precision > 0 ? scientific_precision + 1 : 0) + (exponent <= -100 || exponent >= 100 ? 5 : 4);
+                use_fixed = fixed_length <= scientific_length;
+            } else if (*fmt == chars_format::general) {
+                //Like printf's %g with the default precision of 6
+                use_fixed = exponent >= -4 && exponent < 6;
+            } else {
+                use_fixed = *fmt == chars_format::fixed;
+            }
+
+            if (!use_fixed)
+                return write_scientific(first, last, parts.negative, digits, scientific_precision);
+
+            if (is_large_integer<T>(parts)) {
+                const auto decimal = exact_decimal<T>(parts);
+                return write_fixed(first, last, parts.negative, decimal.digits(), 0);
+            }
+            return write_fixed(first, last, parts.negative, digits, fixed_precision);
+        }
+
+        //Like printf with the given precision
+        template <typename T>
+        [[nodiscard]] to_chars_result
+        float_to_chars_precision(char* first, char* last, T value, chars_format fmt, int precision) noexcept
+        {
+            const auto parts = float_parts(value);
+            if (parts.exponent == FloatFormat<T>::infinite_power)
+                return write_special(first, last, parts);
+
+            if (fmt == chars_format::hex)
+                return write_hex<T>(first, last, parts.negative, parts.mantissa, parts.exponent, precision);
+
+            //printf uses a precision of 6 if none is given
+            if (precision < 0)
+                precision = 6;
+
+            auto decimal = exact_decimal<T>(parts);
+            switch (fmt) {
+                case chars_format::fixed:
+                    decimal.round_to(std::int64_t{decimal.digits().decimal_point} + precision);
+                    return write_fixed(first, last, parts.negative, decimal.digits(), precision);
+                case chars_format::scientific:
+                    decimal.round_to(std::int64_t{precision} + 1);
+                    return write_scientific(first, last, parts.negative, decimal.digits(), precision);
+                default: {
+                    //%g: scientific notation for very small and large exponents, without trailing zeros
+                    const auto significant_digits = std::max(precision, 1);
+                    decimal.round_to(significant_digits);
+
+                    const auto digits = decimal.digits();
+                    const auto exponent = digits.count == 0 ? 0 : digits.decimal_point - 1;
+                    if (exponent >= -4 && exponent < significant_digits)
+                        return write_fixed(first, last, parts.negative, digits, std::max(digits.count - digits.decimal_point, 0));
+                    return write_scientific(first, last, parts.negative, digits, std::max(digits.count - 1, 0));
+                }
+            }
+        }
+
     } // namespace details
 
-    template <typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+    /**
+    * \brief Replacement for std::from_chars for integers
+    *
+    * Accepts the bases 2 to 36 and does not allocate. Decimal numbers are parsed eight digits at a time where possible.
+    *
+    * \return Pointer to the first character that is not a digit. If there are no digits, begin and std::errc::invalid_argument.
+    *         If the number does not fit into T, std::errc::result_out_of_range and value is not changed
+    */
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
     from_chars_result from_chars(char const* const begin, char const* const end, T& value, int base = 10) noexcept
     {
         return details::int_from_chars_impl(begin, end, value, base);
     }
 
+    /**
+    * \brief Replacement for std::from_chars for floating-point numbers
+    *
+    * float and double are parsed without allocating and rounded correctly, like std::from_chars does.
+    * long double still goes through std::istringstream.
+    */
     template <typename T, typename = std::enable_if_t<std::is_floating_point_v<T>>>
     from_chars_result
     from_chars(char const* const begin, char const* const end, T& value, chars_format fmt = chars_format::general) noexcept
     {
-        switch (fmt) {
-            case chars_format::fixed:
-                return details::fp_from_chars_impl(begin, end, value, std::ios::fixed);
-            case chars_format::scientific:
-                return details::fp_from_chars_impl(begin, end, value, std::ios::scientific);
-            case chars_format::hex:
-                return details::fp_from_chars_impl(begin, end, value, std::ios::hex);
-            case chars_format::general:
-                return details::fp_from_chars_impl(begin, end, value, std::ios::dec);
-        }
-        return {begin, std::errc::invalid_argument};
+        if constexpr (std::is_same_v<T, long double>) {
+            switch (fmt) {
+                case chars_format::fixed:
+                    return details::fp_from_chars_impl(begin, end, value, std::ios::fixed);
+                case chars_format::scientific:
+                    return details::fp_from_chars_impl(begin, end, value, std::ios::scientific);
+                case chars_format::hex:
+                    return details::fp_from_chars_impl(begin, end, value, std::ios::hex);
+                case chars_format::general:
+                    return details::fp_from_chars_impl(begin, end, value, std::ios::dec);
+            }
+            return {begin, std::errc::invalid_argument};
+        } else {
+            return details::float_from_chars(begin, end, value, fmt);
+        }
+    }
+
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+    to_chars_result to_chars(char* const first, char* const last, T value, int base = 10) noexcept
+    {
+        return details::int_to_chars_impl(first, last, value, base);
+    }
+
+    /**
+    * \brief Replacement for std::to_chars for floating-point numbers
+    *
+    * Writes the shortest representation that parses back to value, in fixed or scientific notation, whichever is shorter.
+    * Only float and double are supported. Nothing is allocated.
+    *
+    * \return Pointer past the last character written. If the range is too small, last and std::errc::value_too_large
+    */
+    template <typename T, typename = std::enable_if_t<std::is_same_v<T, float> || std::is_same_v<T, double>>>
+    to_chars_result to_chars(char* const first, char* const last, T value) noexcept
+    {
+        return details::float_to_chars_shortest(first, last, value, std::nullopt);
+    }
+
+    //Shortest representation in the given format. chars_format::general uses scientific notation for exponents below -4
+    //and above 5, chars_format::hex writes no "0x" prefix
+    template <typename T, typename = std::enable_if_t<std::is_same_v<T, float> || std::is_same_v<T, double>>>
+    to_chars_result to_chars(char* const first, char* const last, T value, chars_format fmt) noexcept
+    {
+        return details::float_to_chars_shortest(first, last, value, fmt);
+    }
+
+    //Like std::printf with the %f, %e, %g or %a conversion and the given precision, rounded exactly
+    template <typename T, typename = std::enable_if_t<std::is_same_v<T, float> || std::is_same_v<T, double>>>
+    to_chars_result to_chars(char* const first, char* const last, T value, chars_format fmt, int precision) noexcept
+    {
+        return details::float_to_chars_precision(first, last, value, fmt, precision);
     }
 
 #endif
 
 } // namespace Raychel
 
-#endif //!RAYCHELCORE_CHARCONV_H
\ No newline at end of file
+#endif //!RAYCHELCORE_CHARCONV_H
@@ -105,6 +105,13 @@
     #define RAYCHEL_HAS_SPACESHIP_OP 0
 #endif
 
+//Hint that the memory at address will be read soon
+#if RAYCHEL_ACTIVE_COMPILER == RAYCHEL_COMPILER_GCC || RAYCHEL_ACTIVE_COMPILER == RAYCHEL_COMPILER_CLANG
+    #define RAYCHEL_PREFETCH(address) __builtin_prefetch(address)
+#else
+    #define RAYCHEL_PREFETCH(address) static_cast<void>(address)
+#endif
+
 #if __cpp_lib_to_chars >= 201611L && !defined(RAYCHELCORE_USE_CHARCONV_REPLACEMENT)
     #define RAYCHEL_HAS_CHARCONV 1
 #else
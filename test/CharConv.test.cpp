@@ -1,7 +1,21 @@
 #define RAYCHELCORE_USE_CHARCONV_REPLACEMENT 1
 #include "RaychelCore/charconv.h"
 #include <catch2/catch.hpp>
+#include <chrono>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 //NOLINTBEGIN
 
@@ -55,7 +69,23 @@ TEST_CASE("Raychel decimal charconv", "[RaychelCore][Compatibility]")
         REQUIRE(i == 12345L);
     }
 
-    //TODO: add tests for to_chars
+    SECTION("Double decimal to_chars")
+    {
+        char buffer[32]{};
+        const auto [ptr, ec] = Raychel::to_chars(std::begin(buffer), std::end(buffer), 1.2345);
+
+        REQUIRE(ec == std::errc{});
+        REQUIRE(std::string_view(buffer, ptr) == decimal_float);
+    }
+
+    SECTION("Integer decimal to_chars")
+    {
+        char buffer[32]{};
+        const auto [ptr, ec] = Raychel::to_chars(std::begin(buffer), std::end(buffer), 12345);
+
+        REQUIRE(ec == std::errc{});
+        REQUIRE(std::string_view(buffer, ptr) == decimal_int);
+    }
 }
 
 TEST_CASE("Raychel octal integer charconv", "[RaychelCore][Compatibility]")
@@ -119,4 +149,606 @@ TEST_CASE("Raychel hex integer charconv", "[RaychelCore][Compatibility]")
         REQUIRE(i == 0xBADB002);
     }
 }
+
+TEST_CASE("Raychel integer from_chars", "[RaychelCore][Compatibility]")
+{
+    const auto parse_int = []<typename T>(std::string_view input, T& value, int base = 10) {
+        return Raychel::from_chars(input.data(), input.data() + input.size(), value, base);
+    };
+
+    SECTION("All bases")
+    {
+        std::int64_t value{};
+        REQUIRE(parse_int("-101", value, 2).ec == std::errc{});
+        REQUIRE(value == -5);
+        REQUIRE(parse_int("zZ", value, 36).ec == std::errc{});
+        REQUIRE(value == 35 * 36 + 35);
+        REQUIRE(parse_int("12345678901234567", value, 10).ec == std::errc{});
+        REQUIRE(value == 12345678901234567);
+        REQUIRE(parse_int("-9223372036854775808", value).ec == std::errc{});
+        REQUIRE(value == std::numeric_limits<std::int64_t>::min());
+
+        std::uint64_t unsigned_value{};
+        REQUIRE(parse_int("0000000000000000000018446744073709551615", unsigned_value).ec == std::errc{});
+        REQUIRE(unsigned_value == std::numeric_limits<std::uint64_t>::max());
+
+        REQUIRE(parse_int("1", value, 1).ec == std::errc::invalid_argument);
+        REQUIRE(parse_int("1", value, 37).ec == std::errc::invalid_argument);
+    }
+
+    SECTION("End pointer")
+    {
+        constexpr std::string_view input = "123456789012x5";
+        int value{};
+        const auto [ptr, ec] = parse_int(input.substr(0, 10), value);
+        REQUIRE(ec == std::errc{});
+        REQUIRE(ptr == input.data() + 10);
+        REQUIRE(value == 1234567890);
+
+        std::uint64_t id{};
+        REQUIRE(parse_int(input, id).ptr == input.data() + 12);
+        REQUIRE(id == 123456789012U);
+
+        //Digits that are not valid in the base end the number
+        REQUIRE(parse_int("1239", value, 8).ptr[0] == '9');
+        REQUIRE(value == 0123);
+        REQUIRE(parse_int("ffg", value, 16).ptr[0] == 'g');
+    }
+
+    SECTION("Invalid input")
+    {
+        int value{42};
+        unsigned unsigned_value{42};
+        for (const std::string_view input : {"", "-", "+1", " 1", "x"}) {
+            const auto [ptr, ec] = parse_int(input, value, 16);
+            REQUIRE(ec == std::errc::invalid_argument);
+            REQUIRE(ptr == input.data());
+        }
+        REQUIRE(parse_int("-1", unsigned_value).ec == std::errc::invalid_argument);
+        REQUIRE(value == 42);
+        REQUIRE(unsigned_value == 42U);
+
+        //There is no prefix, so this is just a zero
+        REQUIRE(parse_int("0x1", value, 16).ptr[0] == 'x');
+        REQUIRE(value == 0);
+    }
+
+    SECTION("Out of range")
+    {
+        std::int8_t small{1};
+        constexpr std::string_view too_large = "128 ";
+        const auto [ptr, ec] = parse_int(too_large, small);
+        REQUIRE(ec == std::errc::result_out_of_range);
+        REQUIRE(ptr == too_large.data() + 3);
+        REQUIRE(small == 1);
+
+        REQUIRE(parse_int("-128", small).ec == std::errc{});
+        REQUIRE(parse_int("-129", small).ec == std::errc::result_out_of_range);
+        REQUIRE(small == -128);
+
+        std::uint32_t value{};
+        REQUIRE(parse_int("4294967296", value).ec == std::errc::result_out_of_range);
+        REQUIRE(parse_int("100000000", value, 16).ec == std::errc::result_out_of_range);
+
+        std::int64_t large{};
+        constexpr std::string_view long_input = "123456789012345678901234567890.5";
+        REQUIRE(parse_int(long_input, large).ptr == long_input.data() + 30);
+        REQUIRE(parse_int("9223372036854775808", large).ec == std::errc::result_out_of_range);
+    }
+
+    SECTION("Same as std::strtoll")
+    {
+        std::mt19937_64 rng{2468};
+        for (int i{}; i != 100'000; ++i) {
+            const auto base = i % 2 == 0 ? 10 : static_cast<int>(rng() % 35) + 2;
+            std::string input(rng() % 25, '0');
+            for (auto& c : input) {
+                c = "0123456789abcdefghijklmnopqrstuvwxyz"[rng() % static_cast<unsigned>(base)];
+            }
+            if (rng() % 2 == 0)
+                input.insert(input.begin(), '-');
+
+            errno = 0;
+            char* expected_end{};
+            const auto expected = std::strtoll(input.c_str(), &expected_end, base);
+            const auto expected_ec = expected_end == input.c_str() ? std::errc::invalid_argument
+                                     : errno == ERANGE             ? std::errc::result_out_of_range
+                                                                   : std::errc{};
+
+            long long value{};
+            const auto [ptr, ec] = parse_int(input, value, base);
+            REQUIRE(ec == expected_ec);
+            if (ec != std::errc::invalid_argument)
+                REQUIRE(ptr == expected_end);
+            if (ec == std::errc{})
+                REQUIRE(value == expected);
+        }
+    }
+}
+
+namespace {
+    template <typename T>
+    Raychel::from_chars_result parse(std::string_view input, T& value, Raychel::chars_format fmt = Raychel::chars_format::general)
+    {
+        return Raychel::from_chars(input.data(), input.data() + input.size(), value, fmt);
+    }
+
+    template <typename T, typename... Args>
+    std::string format(T value, Args... args)
+    {
+        char buffer[1100]{};
+        const auto [ptr, ec] = Raychel::to_chars(std::begin(buffer), std::end(buffer), value, args...);
+        REQUIRE(ec == std::errc{});
+        return std::string(buffer, ptr);
+    }
+
+    //std::strtod rounds correctly as well
+    template <typename T>
+    bool parses_like_strtod(const std::string& input)
+    {
+        T value{};
+        const auto [ptr, ec] = parse(input, value);
+
+        char* expected_end{};
+        T expected{};
+        errno = 0;
+        if constexpr (std::is_same_v<T, float>) {
+            expected = std::strtof(input.c_str(), &expected_end);
+        } else {
+            expected = std::strtod(input.c_str(), &expected_end);
+        }
+        if (ptr != input.data() + (expected_end - input.c_str()))
+            return false;
+
+        //Overflow to infinity or underflow to zero
+        if (errno == ERANGE && (expected == 0 || std::isinf(expected)))
+            return ec == std::errc::result_out_of_range;
+        return ec == std::errc{} && std::memcmp(&value, &expected, sizeof(T)) == 0;
+    }
+} // namespace
+
+TEST_CASE("Raychel float charconv: rounding", "[RaychelCore][Compatibility]")
+{
+    std::mt19937_64 rng{42};
+    char buffer[128]{};
+
+    SECTION("Random floats")
+    {
+        for (int i{}; i != 100'000; ++i) {
+            const auto bits = rng();
+            double d{};
+            std::memcpy(&d, &bits, sizeof(d));
+            if (!std::isfinite(d))
+                continue;
+
+            std::snprintf(buffer, sizeof(buffer), "%.*g", static_cast<int>(rng() % 20U) + 1, d);
+            REQUIRE(parses_like_strtod<double>(buffer));
+            REQUIRE(parses_like_strtod<float>(buffer));
+        }
+    }
+
+    SECTION("Halfway between two floats")
+    {
+        //Needs more than 19 digits, so these may take the slow path
+        for (int i{}; i != 10'000; ++i) {
+            const auto bits = rng() & 0x7FFF'FFFF'FFFF'FFFFU;
+            double d{};
+            std::memcpy(&d, &bits, sizeof(d));
+            if (!std::isfinite(d) || !std::isfinite(std::nextafter(d, INFINITY)))
+                continue;
+
+            const auto halfway = (static_cast<long double>(d) + std::nextafter(d, INFINITY)) / 2;
+            std::snprintf(buffer, sizeof(buffer), "%.40Le", halfway);
+            REQUIRE(parses_like_strtod<double>(buffer));
+
+            const auto f = static_cast<float>(d);
+            if (!std::isfinite(std::nextafter(f, INFINITY)))
+                continue;
+            std::snprintf(buffer, sizeof(buffer), "%.60e", (static_cast<double>(f) + std::nextafter(f, INFINITY)) / 2);
+            REQUIRE(parses_like_strtod<float>(buffer));
+        }
+    }
+
+    SECTION("Edge cases")
+    {
+        for (const auto* input :
+             {"0",
+              "-0.0",
+              "4.9406564584124654e-324",
+              "2.4703282292062328e-324",
+              "2.2250738585072011e-308",
+              "1.7976931348623157e308",
+              "1.7976931348623158e308",
+              "9007199254740993",
+              "1.00000000000000011102230246251565404236316680908203125",
+              "1.00000000000000011102230246251565404236316680908203124",
+              ".5",
+              "1.e5",
+              "0.0000000000000000000000000000000000000000000000000000000000012345678901234567890123"}) {
+            REQUIRE(parses_like_strtod<double>(input));
+        }
+        for (const auto* input :
+             {"3.4028235e38", "3.40282356e38", "3.40282357e38", "1.17549435e-38", "1.4e-45", "7.1e-46", "16777217"}) {
+            REQUIRE(parses_like_strtod<float>(input));
+        }
+
+        //Exactly halfway between 0 and the smallest subnormal double, the digits after the first 800 decide the rounding
+        const auto halfway = "2.4703282292062327208828439643411068618252990130716238221279284125033775363510437593264991"
+                             "818081799618989828234772285886546332835517796989819938739800539093906315035659515570226392"
+                             "290858392449105184435931802849936536152500319370457678249219365623669863658480757001585769"
+                             "269903706311928279558551332927834338409351978015531246597263579574622766465272827220056374"
+                             "006485499977096599470454020828166226237857393450736339007967761930577506740176324673600968"
+                             "951340535537458516661134223766678604162159680461914467291840300530057530849048765391711386"
+                             "591646239524912623653881879636239373280423891018672348497668235089863388587925628302755995"
+                             "657524455507255189313690836254779186948667994968324049705821028513185451396213837722826145"
+                             "437693412532098591327667236328125";
+        double d{};
+        REQUIRE(parse(std::string{halfway} + "e-324", d).ec == std::errc::result_out_of_range);
+        REQUIRE(parse(std::string{halfway} + "001e-324", d).ec == std::errc{});
+        REQUIRE(d == std::numeric_limits<double>::denorm_min());
+    }
+}
+
+TEST_CASE("Raychel float charconv: formats", "[RaychelCore][Compatibility]")
+{
+    double d{};
+
+    SECTION("General")
+    {
+        constexpr std::string_view input = "-12.5e-1x";
+        REQUIRE(parse(input, d).ptr == input.data() + 8);
+        REQUIRE(d == -1.25);
+
+        //An exponent without digits is not part of the number
+        constexpr std::string_view incomplete_exponent = "3e+";
+        REQUIRE(parse(incomplete_exponent, d).ptr == incomplete_exponent.data() + 1);
+        REQUIRE(d == 3.);
+    }
+
+    SECTION("Fixed")
+    {
+        constexpr std::string_view input = "1.5e3";
+        REQUIRE(parse(input, d, Raychel::chars_format::fixed).ptr == input.data() + 3);
+        REQUIRE(d == 1.5);
+    }
+
+    SECTION("Scientific")
+    {
+        constexpr std::string_view input = "1.5e3";
+        REQUIRE(parse(input, d, Raychel::chars_format::scientific).ptr == input.data() + input.size());
+        REQUIRE(d == 1500.);
+
+        constexpr std::string_view no_exponent = "1.5";
+        REQUIRE(parse(no_exponent, d, Raychel::chars_format::scientific) ==
+                Raychel::from_chars_result{no_exponent.data(), std::errc::invalid_argument});
+    }
+
+    SECTION("Hex")
+    {
+        REQUIRE(parse("1.8p1", d, Raychel::chars_format::hex).ec == std::errc{});
+        REQUIRE(d == 3.);
+        REQUIRE(parse("-A.Bp-4", d, Raychel::chars_format::hex).ec == std::errc{});
+        REQUIRE(d == -0xA.Bp-4);
+        REQUIRE(parse("1p-1074", d, Raychel::chars_format::hex).ec == std::errc{});
+        REQUIRE(d == std::numeric_limits<double>::denorm_min());
+
+        //Rounded to even
+        REQUIRE(parse("1.00000000000008p0", d, Raychel::chars_format::hex).ec == std::errc{});
+        REQUIRE(d == 1.);
+        REQUIRE(parse("1.000000000000080000001p0", d, Raychel::chars_format::hex).ec == std::errc{});
+        REQUIRE(d == 0x1.0000000000001p0);
+
+        //There is no "0x" prefix
+        constexpr std::string_view prefixed = "0x10";
+        REQUIRE(parse(prefixed, d, Raychel::chars_format::hex).ptr == prefixed.data() + 1);
+        REQUIRE(d == 0.);
+    }
+}
+
+TEST_CASE("Raychel float charconv: special values and errors", "[RaychelCore][Compatibility]")
+{
+    double d{};
+
+    constexpr std::string_view infinity = "-Infinity";
+    REQUIRE(parse(infinity, d).ptr == infinity.data() + infinity.size());
+    REQUIRE(d == -std::numeric_limits<double>::infinity());
+
+    constexpr std::string_view inf = "infinite";
+    REQUIRE(parse(inf, d).ptr == inf.data() + 3);
+
+    constexpr std::string_view nan = "nan(payload_1)";
+    REQUIRE(parse(nan, d).ptr == nan.data() + nan.size());
+    REQUIRE(std::isnan(d));
+
+    constexpr std::string_view unterminated_nan = "NaN(abc";
+    REQUIRE(parse(unterminated_nan, d).ptr == unterminated_nan.data() + 3);
+
+    for (const std::string_view invalid : {"", "-", "+1", " 1", ".", "e5", "-.e1", "x"}) {
+        d = 42.;
+        REQUIRE(parse(invalid, d) == Raychel::from_chars_result{invalid.data(), std::errc::invalid_argument});
+        REQUIRE(d == 42.);
+    }
+
+    //The value is not changed, but the whole number is consumed
+    for (const std::string_view out_of_range : {"1e309", "-2e308", "1e-400", "2e-324"}) {
+        d = 42.;
+        const auto* end = out_of_range.data() + out_of_range.size();
+        REQUIRE(parse(out_of_range, d) == Raychel::from_chars_result{end, std::errc::result_out_of_range});
+        REQUIRE(d == 42.);
+    }
+
+    float f{};
+    REQUIRE(parse("1e39", f).ec == std::errc::result_out_of_range);
+    REQUIRE(parse("0e999999999999", d).ec == std::errc{});
+    REQUIRE(d == 0.);
+}
+
+TEST_CASE("Raychel integer to_chars", "[RaychelCore][Compatibility]")
+{
+    REQUIRE(format(0) == "0");
+    REQUIRE(format(-42) == "-42");
+    REQUIRE(format(std::numeric_limits<std::int64_t>::min()) == "-9223372036854775808");
+    REQUIRE(format(std::numeric_limits<std::uint64_t>::max()) == "18446744073709551615");
+    REQUIRE(format(std::int8_t{-128}) == "-128");
+
+    REQUIRE(format(255, 16) == "ff");
+    REQUIRE(format(-255, 2) == "-11111111");
+    REQUIRE(format(std::uint16_t{35}, 36) == "z");
+    REQUIRE(format(std::numeric_limits<std::int32_t>::min(), 8) == "-20000000000");
+
+    char buffer[4]{};
+    REQUIRE(Raychel::to_chars(std::begin(buffer), std::end(buffer), 12345).ec == std::errc::value_too_large);
+    REQUIRE(Raychel::to_chars(std::begin(buffer), std::end(buffer), -1234).ec == std::errc::value_too_large);
+    REQUIRE(Raychel::to_chars(std::begin(buffer), std::end(buffer), 1234).ptr == std::end(buffer));
+}
+
+TEST_CASE("Raychel float to_chars: shortest round trip", "[RaychelCore][Compatibility]")
+{
+    REQUIRE(format(0.1) == "0.1");
+    REQUIRE(format(0.3) == "0.3");
+    REQUIRE(format(0.1 + 0.2) == "0.30000000000000004");
+    REQUIRE(format(1e23) == "1e+23");
+    REQUIRE(format(5e-324) == "5e-324");
+    REQUIRE(format(1.7976931348623157e308) == "1.7976931348623157e+308");
+    REQUIRE(format(3.4028235e38F) == "3.4028235e+38");
+    REQUIRE(format(1e-45F) == "1e-45");
+    REQUIRE(format(0.1F) == "0.1");
+
+    //Fixed or scientific notation, whichever is shorter
+    REQUIRE(format(100.) == "100");
+    REQUIRE(format(1e-4) == "1e-04");
+    REQUIRE(format(123456789.) == "123456789");
+    REQUIRE(format(-0.) == "-0");
+
+    std::mt19937_64 rng{4321};
+    const auto round_trips = [&]<typename T, typename Bits>() {
+        for (int i{}; i != 100'000; ++i) {
+            const auto bits = static_cast<Bits>(rng());
+            T value{};
+            std::memcpy(&value, &bits, sizeof(T));
+            if (!std::isfinite(value))
+                continue;
+
+            const auto text = format(value);
+            T parsed{};
+            const auto [ptr, ec] = parse(text, parsed);
+            if (ec != std::errc{} || ptr != text.data() + text.size() || std::memcmp(&parsed, &value, sizeof(T)) != 0) {
+                FAIL(text);
+            }
+        }
+    };
+    round_trips.operator()<double, std::uint64_t>();
+    round_trips.operator()<float, std::uint32_t>();
+}
+
+TEST_CASE("Raychel float to_chars: formats", "[RaychelCore][Compatibility]")
+{
+    using Raychel::chars_format;
+
+    SECTION("General")
+    {
+        REQUIRE(format(123456., chars_format::general) == "123456");
+        REQUIRE(format(1234567., chars_format::general) == "1.234567e+06");
+        REQUIRE(format(1e-4, chars_format::general) == "0.0001");
+        REQUIRE(format(1e-5, chars_format::general) == "1e-05");
+    }
+
+    SECTION("Fixed")
+    {
+        //Large values are printed exactly
+        REQUIRE(format(1e23, chars_format::fixed) == "99999999999999991611392");
+        REQUIRE(format(3e38F, chars_format::fixed) == "300000000549775575777803994281145270272");
+        REQUIRE(format(1e-7, chars_format::fixed) == "0.0000001");
+        REQUIRE(format(0., chars_format::fixed) == "0");
+    }
+
+    SECTION("Scientific")
+    {
+        REQUIRE(format(0., chars_format::scientific) == "0e+00");
+        REQUIRE(format(1.5, chars_format::scientific) == "1.5e+00");
+        REQUIRE(format(1e100, chars_format::scientific) == "1e+100");
+        REQUIRE(format(-2.5e-300, chars_format::scientific) == "-2.5e-300");
+    }
+
+    SECTION("Hex")
+    {
+        REQUIRE(format(1.5, chars_format::hex) == "1.8p+0");
+        REQUIRE(format(9007199254740992., chars_format::hex) == "1p+53");
+        REQUIRE(format(-0., chars_format::hex) == "-0p+0");
+        REQUIRE(format(5e-324, chars_format::hex) == "0.0000000000001p-1022");
+        REQUIRE(format(1e-45F, chars_format::hex) == "0.000002p-126");
+    }
+
+    SECTION("Special values")
+    {
+        const auto inf = std::numeric_limits<double>::infinity();
+        REQUIRE(format(inf) == "inf");
+        REQUIRE(format(-inf, chars_format::fixed) == "-inf");
+        REQUIRE(format(std::numeric_limits<float>::quiet_NaN(), chars_format::hex) == "nan");
+        REQUIRE(format(inf, chars_format::scientific, 3) == "inf");
+    }
+
+    SECTION("Too small buffer")
+    {
+        char buffer[8]{};
+        auto result = Raychel::to_chars(std::begin(buffer), std::end(buffer), 0.1 + 0.2);
+        REQUIRE(result.ec == std::errc::value_too_large);
+        REQUIRE(result.ptr == std::end(buffer));
+
+        result = Raychel::to_chars(std::begin(buffer), std::end(buffer), 1., chars_format::fixed, 7);
+        REQUIRE(result.ec == std::errc::value_too_large);
+
+        result = Raychel::to_chars(std::begin(buffer), std::end(buffer), 1., chars_format::fixed, 6);
+        REQUIRE(result.ec == std::errc{});
+        REQUIRE(std::string_view(buffer, result.ptr) == "1.000000");
+    }
+}
+
+TEST_CASE("Raychel float to_chars: precision", "[RaychelCore][Compatibility]")
+{
+    using Raychel::chars_format;
+
+    REQUIRE(format(0.125, chars_format::fixed, 2) == "0.12");
+    REQUIRE(format(0.375, chars_format::fixed, 2) == "0.38");
+    REQUIRE(format(9.5, chars_format::fixed, 0) == "10");
+    REQUIRE(format(1e23, chars_format::scientific, 25) == "9.9999999999999991611392000e+22");
+    REQUIRE(format(1.5, chars_format::general, 0) == "2");
+    REQUIRE(format(0.0001, chars_format::general, 3) == "0.0001");
+    REQUIRE(format(9.9999e-5, chars_format::general, 3) == "0.0001");
+    REQUIRE(format(123456., chars_format::general, 3) == "1.23e+05");
+    REQUIRE(format(3.0, chars_format::hex, 3) == "1.800p+1");
+    REQUIRE(format(std::ldexp(0x1.fffffffffffffp0, 51), chars_format::hex, 3) == "2.000p+51");
+
+    //Rounded exactly like std::printf
+    std::mt19937_64 rng{8765};
+    std::uniform_int_distribution<int> exponents{-40, 40};
+    std::uniform_int_distribution<int> precisions{0, 30};
+    for (int i{}; i != 20'000; ++i) {
+        const auto value = std::ldexp(static_cast<double>(rng() >> 11), exponents(rng) - 53);
+        const auto precision = precisions(rng);
+
+        for (const auto& [fmt, conversion] : {std::pair{chars_format::fixed, "%.*f"},
+                                             std::pair{chars_format::scientific, "%.*e"},
+                                             std::pair{chars_format::general, "%.*g"}}) {
+            char expected[128]{};
+            std::snprintf(expected, sizeof(expected), conversion, precision, value);
+            REQUIRE(format(value, fmt, precision) == expected);
+        }
+    }
+}
+
+TEST_CASE("Raychel float charconv: benchmark", "[.][benchmark]")
+{
+    std::mt19937_64 rng{1234};
+    std::uniform_real_distribution<double> dist{-1000., 1000.};
+
+    std::vector<std::string> inputs{};
+    for (int i{}; i != 1'000'000; ++i) {
+        char buffer[32]{};
+        std::snprintf(buffer, sizeof(buffer), "%.17g", dist(rng));
+        inputs.emplace_back(buffer);
+    }
+
+    const auto measure = [&](const char* name, auto&& parse_one) {
+        const auto start = std::chrono::steady_clock::now();
+        double total{};
+        for (const auto& input : inputs) {
+            total += parse_one(input);
+        }
+        const auto duration = std::chrono::steady_clock::now() - start;
+        std::cerr << name << ": " << duration_cast<std::chrono::milliseconds>(duration) << '\n';
+        return total;
+    };
+
+    const auto expected = measure("std::strtod", [](const std::string& input) { return std::strtod(input.c_str(), nullptr); });
+    const auto stream_total = measure("std::istringstream", [](const std::string& input) {
+        double value{};
+        Raychel::details::fp_from_chars_impl(input.data(), input.data() + input.size(), value, std::ios::dec);
+        return value;
+    });
+    const auto total = measure("Raychel::from_chars", [](const std::string& input) {
+        double value{};
+        Raychel::from_chars(input.data(), input.data() + input.size(), value);
+        return value;
+    });
+
+    REQUIRE(stream_total == expected);
+    REQUIRE(total == expected);
+}
+
+TEST_CASE("Raychel integer from_chars: benchmark", "[.][benchmark]")
+{
+    std::mt19937_64 rng{9876};
+    std::uniform_int_distribution<std::uint64_t> dist{1'000'000'000, 999'999'999'999'999};
+
+    std::vector<std::string> inputs{};
+    for (int i{}; i != 1'000'000; ++i) {
+        inputs.push_back(std::to_string(dist(rng)));
+    }
+
+    const auto measure = [&](const char* name, auto&& parse_one) {
+        const auto start = std::chrono::steady_clock::now();
+        std::uint64_t total{};
+        for (const auto& input : inputs) {
+            total += parse_one(input);
+        }
+        const auto duration = std::chrono::steady_clock::now() - start;
+        std::cerr << name << ": " << duration_cast<std::chrono::milliseconds>(duration) << '\n';
+        return total;
+    };
+
+    const auto expected =
+        measure("std::strtoull", [](const std::string& input) { return std::strtoull(input.c_str(), nullptr, 10); });
+    const auto stream_total = measure("std::istringstream", [](const std::string& input) {
+        std::istringstream stream{input};
+        std::uint64_t value{};
+        stream >> value;
+        return value;
+    });
+    const auto total = measure("Raychel::from_chars", [](const std::string& input) {
+        std::uint64_t value{};
+        Raychel::from_chars(input.data(), input.data() + input.size(), value);
+        return value;
+    });
+
+    REQUIRE(stream_total == expected);
+    REQUIRE(total == expected);
+}
+
+TEST_CASE("Raychel float to_chars: benchmark", "[.][benchmark]")
+{
+    std::mt19937_64 rng{5678};
+    std::uniform_real_distribution<double> dist{-1000., 1000.};
+
+    std::vector<double> values(1'000'000);
+    for (auto& value : values) {
+        value = dist(rng);
+    }
+
+    const auto measure = [&](const char* name, auto&& format_one) {
+        const auto start = std::chrono::steady_clock::now();
+        std::size_t total{};
+        for (const auto value : values) {
+            total += format_one(value);
+        }
+        const auto duration = std::chrono::steady_clock::now() - start;
+        std::cerr << name << ": " << duration_cast<std::chrono::milliseconds>(duration) << '\n';
+        return total;
+    };
+
+    char buffer[32]{};
+    measure("std::snprintf %.17g", [&](double value) {
+        return static_cast<std::size_t>(std::snprintf(buffer, sizeof(buffer), "%.17g", value));
+    });
+    measure("std::ostringstream", [&](double value) {
+        std::ostringstream stream{};
+        stream << std::setprecision(17) << value;
+        return stream.str().size();
+    });
+    const auto total = measure("Raychel::to_chars", [&](double value) {
+        return static_cast<std::size_t>(Raychel::to_chars(std::begin(buffer), std::end(buffer), value).ptr - buffer);
+    });
+
+    REQUIRE(total > values.size());
+}
 //NOLINTEND
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "RaychelCore/CompactOcTree.h"
+
+#include "catch2/catch.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+namespace {
+    struct point
+    {
+        point() = delete;
+
+        point(double _x, double _y, double _z) : x{_x}, y{_y}, z{_z}
+        {}
+
+        constexpr auto operator<=>(const point&) const noexcept = default;
+
+        double x, y, z;
+    };
+
+    struct Segment
+    {
+        constexpr auto operator<=>(const Segment&) const noexcept = default;
+
+        point a, b;
+    };
+
+    struct SegmentBoundingBox
+    {
+        Raychel::BasicBoundingBox<point> operator()(const Segment& s) const noexcept
+        {
+            return Raychel::make_bounding_box(s.a, s.b);
+        }
+    };
+
+    struct SegmentDistance
+    {
+        double operator()(const Segment& s, const point& p) const noexcept
+        {
+            return std::min(Raychel::details::GetDistanceToPoint{}(s.a, p), Raychel::details::GetDistanceToPoint{}(s.b, p));
+        }
+    };
+} // namespace
+
+TEMPLATE_TEST_CASE("CompactOcTree: same results as OcTree", "", std::uint8_t, std::uint16_t)
+{
+    using Tree = Raychel::OcTree<point, 8, 8>;
+
+    std::mt19937 rng{98765};
+    std::uniform_real_distribution<double> dist{-50., 50.};
+
+    Tree tree{point{-50, -50, -50}, point{50, 50, 50}};
+
+    {
+        const Raychel::CompactOcTree<Tree, TestType> empty{tree};
+        REQUIRE_FALSE(empty.closest_to(point{0, 0, 0}).has_value());
+    }
+
+    for (std::size_t i{}; i != 2'000; ++i) {
+        REQUIRE(tree.insert(point{dist(rng), dist(rng), dist(rng) / 10}));
+    }
+    tree.optimize_layout();
+
+    const Raychel::CompactOcTree<Tree, TestType> compact{tree};
+
+    REQUIRE(compact.size() == tree.size());
+    REQUIRE(compact.node_count() > 1U);
+
+    std::uniform_real_distribution<double> query_dist{-80., 80.};
+    for (std::size_t i{}; i != 500; ++i) {
+        const point where{query_dist(rng), query_dist(rng), query_dist(rng)};
+
+        const auto expected = tree.closest_to(where);
+        const auto actual = compact.closest_to(where);
+
+        REQUIRE(expected.has_value());
+        REQUIRE(actual.has_value());
+        REQUIRE(&expected->value - tree.elements().data() == &actual->value - compact.elements().data());
+        REQUIRE(expected->distance == actual->distance);
+    }
+}
+
+TEST_CASE("CompactOcTree: elements with bounding boxes")
+{
+    using Tree = Raychel::OcTree<Segment, 4, 6, point, SegmentBoundingBox, SegmentDistance>;
+
+    std::mt19937 rng{5555};
+    std::uniform_real_distribution<double> dist{0., 100.};
+    std::uniform_real_distribution<double> length_dist{-5., 5.};
+
+    Tree tree{point{0, 0, 0}, point{100, 100, 100}};
+    for (std::size_t i{}; i != 500; ++i) {
+        const point a{dist(rng), dist(rng), dist(rng)};
+        const point b{a.x + length_dist(rng), a.y + length_dist(rng), a.z + length_dist(rng)};
+        REQUIRE(tree.insert(Segment{a, b}));
+    }
+
+    const Raychel::CompactOcTree<Tree> compact{tree};
+
+    for (std::size_t i{}; i != 200; ++i) {
+        const point where{dist(rng), dist(rng), dist(rng)};
+
+        const auto expected = tree.closest_to(where);
+        const auto actual = compact.closest_to(where);
+
+        REQUIRE(expected.has_value());
+        REQUIRE(actual.has_value());
+        REQUIRE(expected->value == actual->value);
+        REQUIRE(expected->distance == actual->distance);
+    }
+}
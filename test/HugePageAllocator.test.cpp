@@ -0,0 +1,132 @@
+#include "RaychelCore/HugePageAllocator.h"
+#include "RaychelCore/OctTree.h"
+
+#include "catch2/catch.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct point
+    {
+        point() = delete;
+
+        point(double _x, double _y, double _z) : x{_x}, y{_y}, z{_z}
+        {}
+
+        constexpr auto operator<=>(const point&) const noexcept = default;
+
+        double x, y, z;
+    };
+} // namespace
+
+TEST_CASE("HugePageAllocator: parsing NUMA id lists")
+{
+    using Raychel::details::parse_id_list;
+
+    REQUIRE(parse_id_list("0") == std::vector<std::size_t>{0});
+    REQUIRE(parse_id_list("0-3") == std::vector<std::size_t>{0, 1, 2, 3});
+    REQUIRE(parse_id_list("0-1,4,6-7\n") == std::vector<std::size_t>{0, 1, 4, 6, 7});
+    REQUIRE(parse_id_list("").empty());
+
+    REQUIRE(Raychel::numa_node_count() >= 1);
+    REQUIRE(Raychel::current_numa_node() < Raychel::numa_node_count());
+
+    //Interleaving is only ever attempted for NumaPolicy::interleave
+    Raychel::HugePageAllocator<int, Raychel::NumaPolicy::interleave> allocator{};
+    allocator.deallocate(allocator.allocate(1'000'000), 1'000'000);
+    if (Raychel::numa_interleaving_failed())
+        WARN("The kernel does not support interleaving memory over NUMA nodes");
+}
+
+TEMPLATE_TEST_CASE(
+    "HugePageAllocator: allocating memory", "", (Raychel::HugePageAllocator<int>),
+    (Raychel::HugePageAllocator<int, Raychel::NumaPolicy::interleave>),
+    (Raychel::HugePageAllocator<int, Raychel::NumaPolicy::local, Raychel::HugePageMode::reserved>))
+{
+    TestType allocator{};
+
+    SECTION("Small blocks are reused")
+    {
+        auto* const a = allocator.allocate(10);
+        allocator.deallocate(a, 10);
+
+        auto* const b = allocator.allocate(12);
+        REQUIRE(a == b);
+        REQUIRE(reinterpret_cast<std::uintptr_t>(b) % 64U == 0U);
+        allocator.deallocate(b, 12);
+    }
+
+    SECTION("Blocks go back to the pool of the NUMA node they came from")
+    {
+        using Pool = Raychel::details::HugePagePool<TestType::policy, TestType::mode>;
+
+        auto* const a = allocator.allocate(10);
+        REQUIRE(Pool::instance().numa_node_of(a) == Raychel::current_numa_node());
+
+        std::thread{[&] { allocator.deallocate(a, 10); }}.join();
+
+        auto* const b = allocator.allocate(10);
+        REQUIRE(a == b);
+        allocator.deallocate(b, 10);
+    }
+
+    SECTION("Large blocks are aligned to huge pages")
+    {
+        auto* const memory = allocator.allocate(1'000'000);
+        REQUIRE(reinterpret_cast<std::uintptr_t>(memory) % Raychel::details::huge_page_size == 0U);
+        memory[0] = 1;
+        memory[999'999] = 2;
+        allocator.deallocate(memory, 1'000'000);
+    }
+
+    SECTION("Containers")
+    {
+        std::vector<int, TestType> numbers{};
+        for (int i{}; i != 100'000; ++i) {
+            numbers.push_back(i);
+        }
+
+        for (int i{}; i != 100'000; ++i) {
+            REQUIRE(numbers[static_cast<std::size_t>(i)] == i);
+        }
+    }
+}
+
+TEST_CASE("HugePageAllocator: OcTree storage")
+{
+    using Allocator = Raychel::HugePageAllocator<point>;
+    using Tree = Raychel::OcTree<
+        point, 8, 10, point, Raychel::details::BoundingBoxFromCoordinate, Raychel::details::GetDistanceToPoint,
+        Raychel::details::NoAggregate, Allocator>;
+
+    std::mt19937 rng{6};
+    std::uniform_real_distribution<double> dist{0., 100.};
+
+    std::vector<point> points{};
+    for (std::size_t i{}; i != 10'000; ++i) {
+        points.emplace_back(dist(rng), dist(rng), dist(rng));
+    }
+
+    const Raychel::OcTree<point, 8, 10> reference{point{0, 0, 0}, point{100, 100, 100}, points};
+
+    Tree tree{point{0, 0, 0}, point{100, 100, 100}};
+    for (const auto& p : points) {
+        REQUIRE(tree.insert(p));
+    }
+
+    const Tree copy{tree};
+
+    for (std::size_t i{}; i != 100; ++i) {
+        const point where{dist(rng), dist(rng), dist(rng)};
+
+        const auto expected = reference.closest_to(where);
+        const auto actual = copy.closest_to(where);
+        REQUIRE(expected.has_value());
+        REQUIRE(actual.has_value());
+        REQUIRE(actual->value == expected->value);
+    }
+}
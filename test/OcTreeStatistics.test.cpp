@@ -0,0 +1,98 @@
+#define RAYCHELCORE_OCTREE_STATISTICS 1
+#include "RaychelCore/OctTree.h"
+
+#include "catch2/catch.hpp"
+
+#include <cstddef>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct point
+    {
+        point() = delete;
+
+        point(double _x, double _y, double _z) : x{_x}, y{_y}, z{_z}
+        {}
+
+        constexpr auto operator<=>(const point&) const noexcept = default;
+
+        double x, y, z;
+    };
+
+    using Tree = Raychel::OcTree<point, 8, 8>;
+} // namespace
+
+TEST_CASE("OcTree statistics: per query counters")
+{
+    std::mt19937 rng{1};
+    std::uniform_real_distribution<double> dist{0., 100.};
+
+    std::vector<point> points{};
+    for (std::size_t i{}; i != 1'000; ++i) {
+        points.emplace_back(dist(rng), dist(rng), dist(rng));
+    }
+
+    const Tree tree{point{0, 0, 0}, point{100, 100, 100}, points};
+
+    Raychel::reset_octree_statistics();
+
+    REQUIRE(tree.closest_to(point{50, 50, 50}).has_value());
+
+    const auto query = Raychel::last_octree_query_statistics();
+    REQUIRE(query.nodes_visited > query.leaves_scanned);
+    REQUIRE(query.leaves_scanned > 0);
+    REQUIRE(query.distance_evaluations >= query.leaves_scanned);
+    REQUIRE(query.distance_evaluations < points.size());
+    REQUIRE(query.max_depth > 1);
+    REQUIRE(query.max_depth <= 9);
+
+    //A brute force query has to look at every element
+    const auto all = tree.elements_within(point{50, 50, 50}, 1'000.);
+    REQUIRE(all.size() == points.size());
+    REQUIRE(Raychel::last_octree_query_statistics().distance_evaluations == points.size());
+
+    const auto total = Raychel::octree_statistics();
+    REQUIRE(total.queries == 2);
+    REQUIRE(total.nodes_visited == query.nodes_visited + Raychel::last_octree_query_statistics().nodes_visited);
+    REQUIRE(total.distance_evaluations == query.distance_evaluations + points.size());
+    REQUIRE(total.max_nodes_visited == Raychel::last_octree_query_statistics().nodes_visited);
+}
+
+TEST_CASE("OcTree statistics: accumulating over threads")
+{
+    std::mt19937 rng{2};
+    std::uniform_real_distribution<double> dist{0., 100.};
+
+    std::vector<point> points{};
+    for (std::size_t i{}; i != 1'000; ++i) {
+        points.emplace_back(dist(rng), dist(rng), dist(rng));
+    }
+
+    const Tree tree{point{0, 0, 0}, point{100, 100, 100}, points};
+
+    Raychel::reset_octree_statistics();
+
+    std::vector<std::thread> threads{};
+    for (std::size_t t{}; t != 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (std::size_t i{}; i != 100; ++i) {
+                const auto coordinate = static_cast<double>(t * 100 + i) / 4.;
+                (void)tree.closest_to(point{coordinate, coordinate, coordinate});
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    //The threads have exited, so their totals must have been retired
+    const auto total = Raychel::octree_statistics();
+    REQUIRE(total.queries == 400);
+    REQUIRE(total.leaves_scanned >= 400);
+    REQUIRE(total.nodes_visited > total.leaves_scanned);
+
+    Raychel::reset_octree_statistics();
+    REQUIRE(Raychel::octree_statistics().queries == 0);
+}
@@ -2,12 +2,14 @@
 
 #include "catch2/catch.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <cstddef>
 #include <memory_resource>
 #include <numbers>
 #include <ostream>
 #include <random>
+#include <thread>
 
 //Non-default constructible vec3
 struct vec3
@@ -237,3 +239,925 @@ TEST_CASE("OcTree: Ts with bounding boxes")
         REQUIRE(object == closest);
     }
 }
+
+TEST_CASE("OcTree: Morton order layout")
+{
+    std::mt19937 rng{4321};
+    std::uniform_real_distribution<double> dist{0., 100.};
+
+    std::vector<vec3> points{};
+    for (std::size_t i{}; i != 1'000; ++i) {
+        points.emplace_back(dist(rng), dist(rng), dist(rng));
+    }
+
+    OctTree tree{vec3{0, 0, 0}, vec3{100, 100, 100}, points};
+
+    const auto permutation = tree.optimize_layout();
+
+    REQUIRE(permutation.size() == points.size());
+    REQUIRE(tree.size() == points.size());
+
+    std::vector<bool> seen(points.size(), false);
+    for (std::size_t i{}; i != permutation.size(); ++i) {
+        REQUIRE(permutation[i] < points.size());
+        REQUIRE_FALSE(seen[permutation[i]]);
+        seen[permutation[i]] = true;
+
+        REQUIRE(tree.elements()[i] == points[permutation[i]]);
+    }
+
+    for (std::size_t i{}; i != 100; ++i) {
+        const vec3 where{dist(rng), dist(rng), dist(rng)};
+
+        const auto expected =
+            std::min_element(points.begin(), points.end(), [&](const vec3& a, const vec3& b) {
+                return Raychel::details::GetDistanceToPoint{}(a, where) < Raychel::details::GetDistanceToPoint{}(b, where);
+            });
+
+        const auto maybe_closest = tree.closest_to(where);
+        REQUIRE(maybe_closest.has_value());
+        REQUIRE(maybe_closest->value == *expected);
+    }
+
+    SECTION("Layout at construction")
+    {
+        OctTree morton_tree{vec3{0, 0, 0}, vec3{100, 100, 100}, points, Raychel::OcTreeLayout::morton_order};
+
+        REQUIRE(morton_tree.elements() == tree.elements());
+    }
+}
+
+TEST_CASE("OcTree: query points outside of the tree")
+{
+    OctTree tree{vec3{0, 0, 0}, vec3{100, 100, 100}};
+
+    REQUIRE(tree.insert(vec3{90, 90, 90}));
+    for (std::size_t i{}; i != 20; ++i) {
+        const auto offset = static_cast<double>(i);
+        REQUIRE(tree.insert(vec3{80 + offset / 2, 95, 60 + offset}));
+    }
+
+    const auto maybe_closest = tree.closest_to(vec3{-500, -500, -500});
+    REQUIRE(maybe_closest.has_value());
+    REQUIRE(maybe_closest->value == vec3{80, 95, 60});
+}
+
+TEST_CASE("OcTree: all pairs within a distance")
+{
+    std::mt19937 rng{2468};
+    std::uniform_real_distribution<double> dist{0., 100.};
+
+    OctTree tree{vec3{0, 0, 0}, vec3{100, 100, 100}};
+    for (std::size_t i{}; i != 1'000; ++i) {
+        REQUIRE(tree.insert(vec3{dist(rng), dist(rng), dist(rng)}));
+    }
+    //Points on the boundaries between nodes end up in more than one leaf
+    REQUIRE(tree.insert(vec3{50, 50, 50}));
+    REQUIRE(tree.insert(vec3{50, 50, 50}));
+    REQUIRE(tree.insert(vec3{50, 51, 50}));
+
+    const auto max_distance = 4.0;
+
+    std::vector<std::pair<std::size_t, std::size_t>> expected{};
+    const auto& elements = tree.elements();
+    for (std::size_t i{}; i != elements.size(); ++i) {
+        for (std::size_t j{i + 1}; j != elements.size(); ++j) {
+            if (Raychel::details::distance_squared(elements[i], elements[j]) <= max_distance * max_distance)
+                expected.emplace_back(i, j);
+        }
+    }
+
+    REQUIRE_FALSE(expected.empty());
+
+    SECTION("Sequential")
+    {
+        REQUIRE(tree.pairs_within(max_distance) == expected);
+    }
+
+    SECTION("Parallel")
+    {
+        REQUIRE(tree.pairs_within(max_distance, Raychel::OcTreeExecution::parallel) == expected);
+    }
+
+    SECTION("Overlapping bounding boxes")
+    {
+        const auto pairs = tree.overlapping_pairs();
+        REQUIRE(pairs.size() == 1U);
+        REQUIRE(pairs.front() == std::pair<std::size_t, std::size_t>{1'000, 1'001});
+    }
+}
+
+struct CentroidAggregate
+{
+    void add(const vec3& v) noexcept
+    {
+        count += 1;
+        sum_x += v.x;
+        sum_y += v.y;
+        sum_z += v.z;
+    }
+
+    [[nodiscard]] vec3 centroid() const noexcept
+    {
+        return vec3{sum_x / count, sum_y / count, sum_z / count};
+    }
+
+    double count{};
+    double sum_x{}, sum_y{}, sum_z{};
+};
+
+TEST_CASE("OcTree: aggregates and approximate traversal")
+{
+    using AggregateTree = Raychel::OcTree<
+        vec3, 10, 8, vec3, Raychel::details::BoundingBoxFromCoordinate, Raychel::details::GetDistanceToPoint, CentroidAggregate>;
+
+    std::mt19937 rng{1122};
+    std::uniform_real_distribution<double> dist{0., 100.};
+
+    AggregateTree tree{vec3{0, 0, 0}, vec3{100, 100, 100}};
+    for (std::size_t i{}; i != 2'000; ++i) {
+        REQUIRE(tree.insert(vec3{dist(rng), dist(rng), dist(rng)}));
+    }
+
+    REQUIRE(tree.aggregate().count == 2'000.0);
+
+    const auto potential_at = [](const vec3& where, const vec3& v, double mass) {
+        return mass / Raychel::details::GetDistanceToPoint{}(where, v);
+    };
+
+    SECTION("Far away queries only see the root")
+    {
+        std::size_t aggregate_count{};
+        std::size_t element_count{};
+        tree.approximate(vec3{10'000, 10'000, 10'000}, 0.5, [&]<typename U>(const U&) {
+            if constexpr (std::is_same_v<U, CentroidAggregate>) {
+                ++aggregate_count;
+            } else {
+                ++element_count;
+            }
+        });
+
+        REQUIRE(aggregate_count == 1U);
+        REQUIRE(element_count == 0U);
+    }
+
+    SECTION("Opening angle of zero visits every element")
+    {
+        std::size_t element_count{};
+        tree.approximate(vec3{200, 50, 50}, 0.0, [&]<typename U>(const U&) {
+            if constexpr (std::is_same_v<U, vec3>) {
+                ++element_count;
+            }
+        });
+
+        REQUIRE(element_count == tree.size());
+    }
+
+    SECTION("Approximation is close to the exact value")
+    {
+        const vec3 where{50, 50, 150};
+
+        double exact{};
+        for (const auto& v : tree.elements()) {
+            exact += potential_at(where, v, 1.0);
+        }
+
+        double approximate{};
+        std::size_t visit_count{};
+        tree.approximate(where, 0.5, [&]<typename U>(const U& value) {
+            ++visit_count;
+            if constexpr (std::is_same_v<U, CentroidAggregate>) {
+                approximate += potential_at(where, value.centroid(), value.count);
+            } else {
+                approximate += potential_at(where, value, 1.0);
+            }
+        });
+
+        REQUIRE(visit_count < tree.size());
+        REQUIRE(std::abs(approximate - exact) < exact * 1e-2);
+    }
+}
+
+TEST_CASE("OcTree: growing bounds")
+{
+    OctTree tree{vec3{0, 0, 0}, vec3{1, 1, 1}};
+
+    REQUIRE_FALSE(tree.insert(vec3{10, 10, 10}));
+
+    tree.set_bounds_policy(Raychel::OcTreeBoundsPolicy::grow);
+
+    std::mt19937 rng{777};
+    std::uniform_real_distribution<double> dist{0., 1.};
+    std::uniform_real_distribution<double> wide_dist{-1'000., 1'000.};
+
+    std::vector<vec3> points{};
+    for (std::size_t i{}; i != 200; ++i) {
+        points.emplace_back(dist(rng), dist(rng), dist(rng));
+    }
+    for (std::size_t i{}; i != 200; ++i) {
+        points.emplace_back(wide_dist(rng), wide_dist(rng), wide_dist(rng));
+    }
+
+    for (const auto& p : points) {
+        REQUIRE(tree.insert(p));
+    }
+    REQUIRE(tree.size() == points.size());
+
+    const auto box = tree.bounding_box();
+    for (const auto& p : points) {
+        REQUIRE(Raychel::details::contains(box, p));
+    }
+
+    REQUIRE_FALSE(tree.insert(vec3{std::numeric_limits<double>::infinity(), 0, 0}));
+
+    const OctTree copy{tree};
+    REQUIRE(copy.bounds_policy() == Raychel::OcTreeBoundsPolicy::grow);
+
+    for (std::size_t i{}; i != 100; ++i) {
+        const vec3 where{wide_dist(rng), wide_dist(rng), wide_dist(rng)};
+
+        const auto expected = std::min_element(points.begin(), points.end(), [&](const vec3& a, const vec3& b) {
+            return Raychel::details::distance_squared(a, where) < Raychel::details::distance_squared(b, where);
+        });
+
+        const auto maybe_closest = copy.closest_to(where);
+        REQUIRE(maybe_closest.has_value());
+        REQUIRE(maybe_closest->value == *expected);
+    }
+}
+
+TEST_CASE("OcTree: sparse children")
+{
+    using Raychel::details::overlapped_children;
+    using Box = Raychel::BasicBoundingBox<vec3>;
+
+    const Box box{vec3{0, 0, 0}, vec3{2, 2, 2}};
+    const vec3 midpoint{1, 1, 1};
+
+    REQUIRE(overlapped_children(box, midpoint, Box{vec3{0.1, 0.1, 0.1}, vec3{0.2, 0.2, 0.2}}) == 0b0000'0001U);
+    REQUIRE(overlapped_children(box, midpoint, Box{vec3{1.5, 1.5, 1.5}, vec3{1.6, 1.6, 1.6}}) == 0b1000'0000U);
+    REQUIRE(overlapped_children(box, midpoint, Box{vec3{0.5, 1.5, 0.5}, vec3{1.5, 1.6, 0.6}}) == 0b0000'1100U);
+    REQUIRE(overlapped_children(box, midpoint, Box{vec3{0.5, 0.5, 0.5}, vec3{1.5, 1.5, 1.5}}) == 0b1111'1111U);
+    REQUIRE(overlapped_children(box, midpoint, Box{vec3{3, 3, 3}, vec3{4, 4, 4}}) == 0U);
+
+    //All points are in one corner of the tree, so most children are never created
+    OctTree tree{vec3{-1, -1, -1}, vec3{1, 1, 1}};
+
+    std::mt19937 rng{4242};
+    std::uniform_real_distribution<double> dist{0.5, 0.75};
+    std::uniform_real_distribution<double> query_dist{-1., 1.};
+
+    std::vector<vec3> points{};
+    for (std::size_t i{}; i != 1'000; ++i) {
+        points.emplace_back(dist(rng), dist(rng), dist(rng));
+        REQUIRE(tree.insert(points.back()));
+    }
+
+    for (std::size_t i{}; i != 100; ++i) {
+        const vec3 where{query_dist(rng), query_dist(rng), query_dist(rng)};
+
+        const auto expected = std::min_element(points.begin(), points.end(), [&](const vec3& a, const vec3& b) {
+            return Raychel::details::distance_squared(a, where) < Raychel::details::distance_squared(b, where);
+        });
+
+        const auto maybe_closest = tree.closest_to(where);
+        REQUIRE(maybe_closest.has_value());
+        REQUIRE(maybe_closest->value == *expected);
+    }
+
+    REQUIRE(tree.overlapping_pairs().empty());
+}
+
+TEST_CASE("OcTree: overfull leaves at the maximum depth")
+{
+    using ShallowTree = Raychel::OcTree<vec3, 4, 2>;
+
+    std::mt19937 rng{99};
+    std::uniform_real_distribution<double> cluster_dist{1., 1.01};
+    std::uniform_real_distribution<double> dist{0., 10.};
+
+    //The cluster is much smaller than a leaf at the maximum depth, so its leaf has to hold more than BucketSize elements
+    std::vector<vec3> points{};
+    for (std::size_t i{}; i != 50; ++i) {
+        points.emplace_back(cluster_dist(rng), cluster_dist(rng), cluster_dist(rng));
+    }
+    for (std::size_t i{}; i != 50; ++i) {
+        points.emplace_back(dist(rng), dist(rng), dist(rng));
+    }
+
+    const ShallowTree original{vec3{0, 0, 0}, vec3{10, 10, 10}, points};
+    ShallowTree copy{original};
+    copy.optimize_layout();
+    const ShallowTree moved{std::move(copy)};
+
+    for (const auto* tree : {&original, &moved}) {
+        REQUIRE(tree->size() == points.size());
+
+        for (std::size_t i{}; i != 100; ++i) {
+            const vec3 where = i % 2 == 0 ? vec3{cluster_dist(rng), cluster_dist(rng), cluster_dist(rng)}
+                                          : vec3{dist(rng), dist(rng), dist(rng)};
+
+            const auto expected = std::min_element(points.begin(), points.end(), [&](const vec3& a, const vec3& b) {
+                return Raychel::details::distance_squared(a, where) < Raychel::details::distance_squared(b, where);
+            });
+
+            const auto maybe_closest = tree->closest_to(where);
+            REQUIRE(maybe_closest.has_value());
+            REQUIRE(maybe_closest->value == *expected);
+        }
+    }
+}
+
+TEST_CASE("OcTree: filtered queries")
+{
+    std::mt19937 rng{31337};
+    std::uniform_real_distribution<double> dist{0., 100.};
+
+    std::vector<vec3> points{};
+    for (std::size_t i{}; i != 1'000; ++i) {
+        points.emplace_back(dist(rng), dist(rng), dist(rng));
+    }
+
+    const OctTree tree{vec3{0, 0, 0}, vec3{100, 100, 100}, points};
+
+    const auto in_upper_half = [](const vec3& v) { return v.z > 50.; };
+
+    const auto sorted_by_distance = [&](const vec3& where, auto predicate) {
+        std::vector<std::pair<double, vec3>> expected{};
+        for (const auto& p : points) {
+            if (predicate(p))
+                expected.emplace_back(Raychel::details::GetDistanceToPoint{}(p, where), p);
+        }
+        std::sort(expected.begin(), expected.end());
+        return expected;
+    };
+
+    SECTION("Closest element")
+    {
+        for (std::size_t i{}; i != 100; ++i) {
+            const vec3 where{dist(rng), dist(rng), dist(rng)};
+
+            const auto expected = sorted_by_distance(where, in_upper_half);
+
+            const auto maybe_closest = tree.closest_to(where, in_upper_half);
+            REQUIRE(maybe_closest.has_value());
+            REQUIRE(maybe_closest->value == expected.front().second);
+
+            //Ignore the element itself, like when tracing a ray from its surface
+            const auto& origin = maybe_closest->value;
+            const auto maybe_neighbour = tree.closest_to(origin, [&](const vec3& v) { return &v != &origin; });
+            REQUIRE(maybe_neighbour.has_value());
+            REQUIRE(&maybe_neighbour->value != &origin);
+            REQUIRE(maybe_neighbour->distance > 0.);
+        }
+
+        REQUIRE_FALSE(tree.closest_to(vec3{0, 0, 0}, [](const vec3&) { return false; }).has_value());
+    }
+
+    SECTION("k closest elements")
+    {
+        REQUIRE(tree.k_closest_to(vec3{0, 0, 0}, 0).empty());
+        REQUIRE(tree.k_closest_to(vec3{0, 0, 0}, 2'000).size() == points.size());
+
+        for (std::size_t i{}; i != 100; ++i) {
+            const vec3 where{dist(rng), dist(rng), dist(rng)};
+
+            const auto expected = sorted_by_distance(where, in_upper_half);
+            const auto closest = tree.k_closest_to(where, 10, in_upper_half);
+
+            REQUIRE(closest.size() == 10);
+            for (std::size_t j{}; j != closest.size(); ++j) {
+                REQUIRE(closest[j].value == expected[j].second);
+                REQUIRE(closest[j].distance == expected[j].first);
+            }
+        }
+    }
+
+    SECTION("Elements within a distance")
+    {
+        for (std::size_t i{}; i != 100; ++i) {
+            const vec3 where{dist(rng), dist(rng), dist(rng)};
+
+            const auto expected = sorted_by_distance(where, [&](const vec3& v) {
+                return in_upper_half(v) && Raychel::details::GetDistanceToPoint{}(v, where) <= 15.;
+            });
+            const auto within = tree.elements_within(where, 15., in_upper_half);
+
+            REQUIRE(within.size() == expected.size());
+            for (std::size_t j{}; j != within.size(); ++j) {
+                REQUIRE(within[j].value == expected[j].second);
+            }
+        }
+
+        REQUIRE(tree.elements_within(vec3{50, 50, 50}, 1'000.).size() == points.size());
+    }
+}
+
+TEST_CASE("OcTree: k closest elements with elements outside of the tree")
+{
+    std::mt19937 rng{4242};
+    std::uniform_real_distribution<double> dist{0., 100.};
+
+    std::vector<vec3> points{};
+    for (std::size_t i{}; i != 200; ++i) {
+        points.emplace_back(dist(rng), dist(rng), dist(rng));
+    }
+    //Stored in every leaf around the center
+    points.emplace_back(50, 50, 50);
+    //Stored in no leaf at all, which cancels out the extra entries of the element above
+    for (std::size_t i{}; i != 7; ++i) {
+        points.emplace_back(500, 500, 500);
+    }
+
+    const Raychel::OcTree<vec3, 10, 5> tree{vec3{0, 0, 0}, vec3{100, 100, 100}, points};
+    REQUIRE(tree.quality().duplicate_entries != 0U);
+
+    const auto closest = tree.k_closest_to(vec3{50, 50, 50}, 3);
+    REQUIRE(closest.size() == 3);
+    REQUIRE(closest[0].value == vec3{50, 50, 50});
+    REQUIRE(closest[1].value != vec3{50, 50, 50});
+    REQUIRE(closest[2].value != vec3{50, 50, 50});
+}
+
+TEST_CASE("OcTree: filtered queries with elements in several leaves")
+{
+    using TriangleTree = Raychel::OcTree<Triangle, 2, 6, vec3, TriangleBoundingBox, TriangleDistance>;
+
+    std::mt19937 rng{5150};
+    std::uniform_real_distribution<double> dist{0., 10.};
+    std::uniform_real_distribution<double> offset_dist{-2., 2.};
+
+    std::vector<Triangle> triangles{};
+    for (std::size_t i{}; i != 300; ++i) {
+        const vec3 a{dist(rng), dist(rng), dist(rng)};
+        triangles.push_back(Triangle{
+            a,
+            vec3{a.x + offset_dist(rng), a.y + offset_dist(rng), a.z + offset_dist(rng)},
+            vec3{a.x + offset_dist(rng), a.y + offset_dist(rng), a.z + offset_dist(rng)}});
+    }
+
+    const TriangleTree tree{vec3{-2, -2, -2}, vec3{12, 12, 12}, triangles};
+
+    for (std::size_t i{}; i != 50; ++i) {
+        const vec3 where{dist(rng), dist(rng), dist(rng)};
+
+        const auto closest = tree.k_closest_to(where, 20);
+        REQUIRE(closest.size() == 20);
+        for (std::size_t j{1}; j != closest.size(); ++j) {
+            REQUIRE(&closest[j - 1].value != &closest[j].value);
+            REQUIRE(closest[j - 1].distance <= closest[j].distance);
+        }
+
+        //Duplicates must not push out elements that belong into the result
+        std::vector<double> distances{};
+        for (const auto& triangle : triangles) {
+            distances.push_back(TriangleDistance{}(triangle, where));
+        }
+        std::nth_element(distances.begin(), distances.begin() + 19, distances.end());
+        REQUIRE(closest.back().distance == distances[19]);
+
+        const auto within = tree.elements_within(where, 3.);
+        const auto expected_count = std::count_if(triangles.begin(), triangles.end(), [&](const Triangle& t) {
+            return TriangleDistance{}(t, where) <= 3.;
+        });
+        REQUIRE(within.size() == static_cast<std::size_t>(expected_count));
+    }
+}
+
+namespace {
+    //Distance to the closest corner of a triangle. Counts how often it is evaluated
+    struct CornerDistance
+    {
+        [[nodiscard]] double squared(const Triangle& triangle, const vec3& v) const noexcept
+        {
+            ++evaluations;
+            return std::min({
+                Raychel::details::distance_squared(triangle.a, v),
+                Raychel::details::distance_squared(triangle.b, v),
+                Raychel::details::distance_squared(triangle.c, v),
+            });
+        }
+
+        [[nodiscard]] double operator()(const Triangle& triangle, const vec3& v) const noexcept
+        {
+            return std::sqrt(squared(triangle, v));
+        }
+
+        [[nodiscard]] double lower_bound(const Raychel::BasicBoundingBox<vec3>& box, const vec3& v) const noexcept
+        {
+            return std::sqrt(Raychel::details::distance_squared_to_box(box, v));
+        }
+
+        static inline std::size_t evaluations{};
+    };
+} // namespace
+
+TEST_CASE("OcTree: squared distances and lower bounds")
+{
+    using CornerTree = Raychel::OcTree<Triangle, 8, 8, vec3, TriangleBoundingBox, CornerDistance>;
+
+    STATIC_REQUIRE(Raychel::details::SquaredDistance<CornerDistance, Triangle, vec3>);
+    STATIC_REQUIRE(Raychel::details::DistanceLowerBound<CornerDistance, vec3>);
+    STATIC_REQUIRE(Raychel::details::SquaredDistance<Raychel::details::GetDistanceToPoint, vec3, vec3>);
+
+    std::mt19937 rng{8080};
+    std::uniform_real_distribution<double> dist{0., 100.};
+    std::uniform_real_distribution<double> offset_dist{-3., 3.};
+
+    std::vector<Triangle> triangles{};
+    for (std::size_t i{}; i != 2'000; ++i) {
+        const vec3 a{dist(rng), dist(rng), dist(rng)};
+        triangles.push_back(Triangle{
+            a,
+            vec3{a.x + offset_dist(rng), a.y + offset_dist(rng), a.z + offset_dist(rng)},
+            vec3{a.x + offset_dist(rng), a.y + offset_dist(rng), a.z + offset_dist(rng)}});
+    }
+
+    const CornerTree tree{vec3{-5, -5, -5}, vec3{105, 105, 105}, triangles};
+
+    for (std::size_t i{}; i != 100; ++i) {
+        const vec3 where{dist(rng), dist(rng), dist(rng)};
+
+        const auto expected = std::min_element(triangles.begin(), triangles.end(), [&](const auto& a, const auto& b) {
+            return CornerDistance{}.squared(a, where) < CornerDistance{}.squared(b, where);
+        });
+        const auto expected_distance = CornerDistance{}(*expected, where);
+
+        CornerDistance::evaluations = 0;
+        const auto maybe_closest = tree.closest_to(where);
+
+        REQUIRE(maybe_closest.has_value());
+        REQUIRE(maybe_closest->value == *expected);
+        REQUIRE(maybe_closest->distance == expected_distance);
+        //Only a few elements can beat the best distance found so far
+        REQUIRE(CornerDistance::evaluations < 100);
+
+        const auto within = tree.elements_within(where, 10.);
+        const auto expected_count = std::count_if(
+            triangles.begin(), triangles.end(), [&](const Triangle& t) { return CornerDistance{}(t, where) <= 10.; });
+        REQUIRE(within.size() == static_cast<std::size_t>(expected_count));
+        for (const auto& [value, distance] : within) {
+            REQUIRE(distance <= 10.);
+        }
+    }
+}
+
+TEST_CASE("OcTree: batch queries")
+{
+    std::mt19937 rng{2468};
+    std::uniform_real_distribution<double> dist{0., 100.};
+    std::uniform_real_distribution<double> query_dist{-20., 120.};
+
+    std::vector<vec3> points{};
+    for (std::size_t i{}; i != 5'000; ++i) {
+        points.emplace_back(dist(rng), dist(rng), dist(rng));
+    }
+
+    const OctTree tree{vec3{0, 0, 0}, vec3{100, 100, 100}, points};
+
+    std::vector<vec3> queries{};
+    for (std::size_t i{}; i != 1'000; ++i) {
+        queries.emplace_back(query_dist(rng), query_dist(rng), query_dist(rng));
+    }
+
+    const auto sequential = tree.closest_to_each(queries, Raychel::OcTreeBatchMode::sequential);
+    const auto interleaved = tree.closest_to_each(queries);
+    const auto single_group = tree.closest_to_each<1>(queries);
+    const auto large_group = tree.closest_to_each<32>(std::span{queries}.first(10));
+
+    REQUIRE(sequential.size() == queries.size());
+    REQUIRE(interleaved.size() == queries.size());
+    REQUIRE(single_group.size() == queries.size());
+    REQUIRE(large_group.size() == 10);
+
+    for (std::size_t i{}; i != queries.size(); ++i) {
+        REQUIRE(sequential[i].has_value());
+        REQUIRE(interleaved[i].has_value());
+        REQUIRE(single_group[i].has_value());
+
+        REQUIRE(&interleaved[i]->value == &sequential[i]->value);
+        REQUIRE(interleaved[i]->distance == sequential[i]->distance);
+        REQUIRE(&single_group[i]->value == &sequential[i]->value);
+        if (i < large_group.size()) {
+            REQUIRE(&large_group[i]->value == &sequential[i]->value);
+        }
+    }
+
+    const OctTree empty_tree{vec3{0, 0, 0}, vec3{100, 100, 100}};
+    const auto empty_results = empty_tree.closest_to_each(queries);
+    REQUIRE(empty_results.size() == queries.size());
+    REQUIRE(std::none_of(empty_results.begin(), empty_results.end(), [](const auto& r) { return r.has_value(); }));
+
+    REQUIRE(tree.closest_to_each(std::span<const vec3>{}).empty());
+}
+
+TEST_CASE("OcTree: mixed precision")
+{
+    using MixedTree = Raychel::OcTree<
+        vec3, 10, 5, vec3, Raychel::details::BoundingBoxFromCoordinate, Raychel::details::GetDistanceToPoint,
+        Raychel::details::NoAggregate, std::allocator<vec3>, Raychel::OcTreePrecision::mixed>;
+
+    using Raychel::details::round_down_to_float;
+    using Raychel::details::round_up_to_float;
+
+    REQUIRE(round_down_to_float(0.1) < 0.1);
+    REQUIRE(round_up_to_float(0.1) > 0.1);
+    REQUIRE(round_down_to_float(0.5) == 0.5F);
+    REQUIRE(round_up_to_float(-0.1) > -0.1);
+    REQUIRE(round_down_to_float(1e300) == std::numeric_limits<float>::max());
+    REQUIRE(round_up_to_float(1e300) == std::numeric_limits<float>::infinity());
+    REQUIRE(round_down_to_float(-1e300) == -std::numeric_limits<float>::infinity());
+
+    //Far away from the origin, neighbouring floats are further apart than the points
+    const double offset = GENERATE(0., 1e6);
+
+    std::mt19937 rng{97531};
+    std::uniform_real_distribution<double> dist{offset, offset + 100.};
+    std::uniform_real_distribution<double> query_dist{offset - 20., offset + 120.};
+
+    std::vector<vec3> points{};
+    for (std::size_t i{}; i != 5'000; ++i) {
+        points.emplace_back(dist(rng), dist(rng), dist(rng));
+    }
+    //Points on the boundaries between nodes
+    for (std::size_t i{}; i != 100; ++i) {
+        points.emplace_back(offset + 50., dist(rng), offset + 25.);
+    }
+
+    const vec3 min{offset, offset, offset};
+    const vec3 max{offset + 100., offset + 100., offset + 100.};
+    const OctTree exact{min, max, points};
+    const MixedTree mixed{min, max, points};
+
+    std::vector<vec3> queries{};
+    for (std::size_t i{}; i != 500; ++i) {
+        queries.emplace_back(query_dist(rng), query_dist(rng), query_dist(rng));
+    }
+    //Queries right next to elements
+    for (std::size_t i{}; i != 100; ++i) {
+        const auto& p = points[i * 37U];
+        queries.emplace_back(p.x, std::nextafter(p.y, 0.), p.z);
+    }
+
+    const auto mixed_batch = mixed.closest_to_each(queries);
+
+    for (std::size_t i{}; i != queries.size(); ++i) {
+        const auto& where = queries[i];
+
+        const auto expected = exact.closest_to(where);
+        const auto actual = mixed.closest_to(where);
+        REQUIRE(expected.has_value());
+        REQUIRE(actual.has_value());
+        REQUIRE(actual->value == expected->value);
+        REQUIRE(actual->distance == expected->distance);
+        REQUIRE(mixed_batch[i]->value == expected->value);
+
+        const auto expected_k = exact.k_closest_to(where, 5);
+        const auto actual_k = mixed.k_closest_to(where, 5);
+        REQUIRE(actual_k.size() == expected_k.size());
+        for (std::size_t j{}; j != expected_k.size(); ++j) {
+            REQUIRE(actual_k[j].value == expected_k[j].value);
+        }
+
+        REQUIRE(mixed.elements_within(where, 3.).size() == exact.elements_within(where, 3.).size());
+    }
+
+    REQUIRE(mixed.pairs_within(0.5) == exact.pairs_within(0.5));
+
+    using ExactNode = Raychel::details::OctNode<
+        10, 5, vec3, Raychel::details::GetDistanceToPoint, Raychel::details::NoAggregate, std::allocator<vec3>,
+        Raychel::OcTreePrecision::exact, OctTree>;
+    using MixedNode = Raychel::details::OctNode<
+        10, 5, vec3, Raychel::details::GetDistanceToPoint, Raychel::details::NoAggregate, std::allocator<vec3>,
+        Raychel::OcTreePrecision::mixed, MixedTree>;
+    STATIC_REQUIRE(sizeof(MixedNode) < sizeof(ExactNode));
+}
+
+TEST_CASE("OcTree: rebuilding degraded trees")
+{
+    std::mt19937 rng{1234};
+    std::uniform_real_distribution<double> dist{0., 100.};
+
+    const auto check_closest = [&](const auto& tree, const std::vector<vec3>& points) {
+        for (std::size_t i{}; i != 50; ++i) {
+            const vec3 where{dist(rng), dist(rng), dist(rng)};
+
+            const auto expected = std::min_element(points.begin(), points.end(), [&](const vec3& a, const vec3& b) {
+                return Raychel::details::distance_squared(a, where) < Raychel::details::distance_squared(b, where);
+            });
+
+            const auto maybe_closest = tree.closest_to(where);
+            REQUIRE(maybe_closest.has_value());
+            REQUIRE(maybe_closest->value == *expected);
+        }
+    };
+
+    SECTION("Quality of a freshly built tree")
+    {
+        std::vector<vec3> points{};
+        for (std::size_t i{}; i != 2'000; ++i) {
+            points.emplace_back(dist(rng), dist(rng), dist(rng));
+        }
+
+        OctTree tree{vec3{0, 0, 0}, vec3{100, 100, 100}, points};
+
+        const auto quality = tree.quality();
+        REQUIRE(quality.elements == points.size());
+        REQUIRE(quality.stored_entries == points.size());
+        REQUIRE(quality.duplicate_entries == 0U);
+        REQUIRE(quality.duplication() == 1.0);
+        REQUIRE(quality.overfull_entries == 0U);
+        REQUIRE(quality.unordered_elements == 0U);
+        REQUIRE_FALSE(tree.needs_rebuild());
+        REQUIRE_FALSE(tree.rebuild_if_needed());
+
+        //Overlapping elements are stored once per leaf
+        REQUIRE(tree.insert(vec3{50, 50, 50}));
+        REQUIRE(tree.quality().stored_entries > points.size() + 1U);
+        REQUIRE(tree.quality().duplicate_entries == tree.quality().stored_entries - points.size() - 1U);
+        REQUIRE(tree.quality().unordered_elements == 1U);
+    }
+
+    SECTION("Overfull leaves are counted")
+    {
+        std::vector<vec3> points{};
+        for (std::size_t i{}; i != 100; ++i) {
+            points.emplace_back(1., 1., 1.);
+        }
+
+        const Raychel::OcTree<vec3, 4, 2> tree{vec3{0, 0, 0}, vec3{10, 10, 10}, points};
+        REQUIRE(tree.quality().overfull_entries == points.size() - 4U);
+        REQUIRE(tree.quality().stored_entries == points.size());
+
+        //The tree cannot get any better, so it is not degraded
+        REQUIRE_FALSE(tree.needs_rebuild(Raychel::OcTreeRebuildPolicy{.min_size = 0U}));
+    }
+
+    SECTION("Immediate rebuilds")
+    {
+        //The tree has to grow a lot, so it ends up much larger than its elements
+        OctTree tree{vec3{0, 0, 0}, vec3{0.5, 0.5, 0.5}};
+        tree.set_bounds_policy(Raychel::OcTreeBoundsPolicy::grow);
+
+        std::vector<vec3> points{};
+        for (std::size_t i{}; i != 2'000; ++i) {
+            points.emplace_back(dist(rng), dist(rng), dist(rng));
+            REQUIRE(tree.insert(points.back()));
+        }
+
+        REQUIRE(tree.quality().unordered_elements == points.size());
+        REQUIRE(tree.needs_rebuild());
+        REQUIRE_FALSE(tree.needs_rebuild(Raychel::OcTreeRebuildPolicy{.min_size = 10'000U}));
+
+        REQUIRE(tree.rebuild_if_needed());
+        REQUIRE(tree.size() == points.size());
+        REQUIRE(tree.quality().unordered_elements == 0U);
+        REQUIRE(tree.bounds_policy() == Raychel::OcTreeBoundsPolicy::grow);
+        REQUIRE_FALSE(tree.needs_rebuild());
+
+        //The tree is fitted to its elements again
+        const auto box = tree.bounding_box();
+        REQUIRE(box.bottom_front_left.x >= 0.);
+        REQUIRE(box.top_back_right.x <= 100.);
+
+        check_closest(tree, points);
+
+        //Fixed trees keep their bounding box
+        OctTree fixed{vec3{-100, -100, -100}, vec3{200, 200, 200}};
+        for (const auto& p : points) {
+            REQUIRE(fixed.insert(p));
+        }
+        fixed.rebuild();
+        REQUIRE(fixed.bounding_box().bottom_front_left == vec3{-100, -100, -100});
+        REQUIRE(fixed.bounding_box().top_back_right == vec3{200, 200, 200});
+        check_closest(fixed, points);
+    }
+
+    SECTION("Background rebuilds")
+    {
+        OctTree tree{vec3{0, 0, 0}, vec3{100, 100, 100}};
+
+        std::vector<vec3> points{};
+        for (std::size_t i{}; i != 2'000; ++i) {
+            points.emplace_back(dist(rng), dist(rng), dist(rng));
+            REQUIRE(tree.insert(points.back()));
+        }
+
+        const Raychel::OcTreeRebuildPolicy policy{.mode = Raychel::OcTreeRebuildMode::background};
+
+        REQUIRE_FALSE(tree.rebuild_if_needed(policy));
+        REQUIRE(tree.rebuild_pending());
+
+        //The tree stays usable, and elements inserted in the meantime are not lost
+        for (std::size_t i{}; i != 100; ++i) {
+            points.emplace_back(dist(rng), dist(rng), dist(rng));
+            REQUIRE(tree.insert(points.back()));
+        }
+        check_closest(tree, points);
+
+        while (!tree.rebuild_if_needed(policy)) {
+            REQUIRE(tree.rebuild_pending());
+            std::this_thread::yield();
+        }
+
+        REQUIRE_FALSE(tree.rebuild_pending());
+        REQUIRE(tree.size() == points.size());
+        REQUIRE(tree.quality().unordered_elements == 100U);
+        check_closest(tree, points);
+
+        //Copies never share a pending rebuild
+        REQUIRE_FALSE(tree.rebuild_if_needed(Raychel::OcTreeRebuildPolicy{
+            .min_size = 0U, .max_unordered_fraction = 0., .mode = Raychel::OcTreeRebuildMode::background}));
+        const OctTree copy{tree};
+        REQUIRE(tree.rebuild_pending());
+        REQUIRE_FALSE(copy.rebuild_pending());
+        check_closest(copy, points);
+
+        //Dropping a pending rebuild leaves the tree intact
+        tree.rebuild();
+        REQUIRE_FALSE(tree.rebuild_pending());
+        check_closest(tree, points);
+
+        REQUIRE_FALSE(tree.rebuild_if_needed(Raychel::OcTreeRebuildPolicy{
+            .min_size = 0U, .max_unordered_fraction = 0., .mode = Raychel::OcTreeRebuildMode::background}));
+        tree = copy;
+        REQUIRE_FALSE(tree.rebuild_pending());
+        check_closest(tree, points);
+
+        //Reordering the elements drops a pending rebuild, which would otherwise miss the elements inserted meanwhile
+        const Raychel::OcTreeRebuildPolicy eager_policy{
+            .min_size = 0U, .max_unordered_fraction = 0., .mode = Raychel::OcTreeRebuildMode::background};
+        REQUIRE_FALSE(tree.rebuild_if_needed(eager_policy));
+        for (std::size_t i{}; i != 100; ++i) {
+            points.emplace_back(dist(rng), dist(rng), dist(rng));
+            REQUIRE(tree.insert(points.back()));
+        }
+        (void)tree.optimize_layout();
+        REQUIRE_FALSE(tree.rebuild_pending());
+
+        REQUIRE(tree.insert(vec3{50, 50, 50}));
+        points.emplace_back(50, 50, 50);
+        while (!tree.rebuild_if_needed(eager_policy)) {
+            std::this_thread::yield();
+        }
+
+        std::vector<vec3> elements(tree.begin(), tree.end());
+        std::sort(elements.begin(), elements.end());
+        std::vector<vec3> expected = points;
+        std::sort(expected.begin(), expected.end());
+        REQUIRE(elements == expected);
+        check_closest(tree, points);
+    }
+}
+
+TEST_CASE("OcTree: batch query benchmark", "[.][benchmark]")
+{
+    //Large enough to not fit into the last level cache
+    using LargeTree = Raychel::OcTree<vec3, 8, 20>;
+
+    std::mt19937 rng{1357};
+    std::uniform_real_distribution<double> dist{0., 1'000.};
+
+    std::vector<vec3> points{};
+    for (std::size_t i{}; i != 4'000'000; ++i) {
+        points.emplace_back(dist(rng), dist(rng), dist(rng));
+    }
+    const LargeTree tree{vec3{0, 0, 0}, vec3{1'000, 1'000, 1'000}, std::move(points)};
+
+    std::vector<vec3> queries{};
+    for (std::size_t i{}; i != 1'000'000; ++i) {
+        queries.emplace_back(dist(rng), dist(rng), dist(rng));
+    }
+
+    const auto measure = [&](const char* name, auto&& run) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto results = run();
+        const auto duration = std::chrono::steady_clock::now() - start;
+        std::cerr << name << ": " << duration_cast<std::chrono::milliseconds>(duration) << '\n';
+        return results;
+    };
+
+    const auto sequential =
+        measure("sequential", [&] { return tree.closest_to_each(queries, Raychel::OcTreeBatchMode::sequential); });
+    const auto interleaved = measure("interleaved (8)", [&] { return tree.closest_to_each(queries); });
+    const auto interleaved_16 = measure("interleaved (16)", [&] { return tree.closest_to_each<16>(queries); });
+
+    for (std::size_t i{}; i != queries.size(); ++i) {
+        REQUIRE(&interleaved[i]->value == &sequential[i]->value);
+        REQUIRE(&interleaved_16[i]->value == &sequential[i]->value);
+    }
+
+    using MixedTree = Raychel::OcTree<
+        vec3, 8, 20, vec3, Raychel::details::BoundingBoxFromCoordinate, Raychel::details::GetDistanceToPoint,
+        Raychel::details::NoAggregate, std::allocator<vec3>, Raychel::OcTreePrecision::mixed>;
+    const MixedTree mixed{vec3{0, 0, 0}, vec3{1'000, 1'000, 1'000}, {tree.begin(), tree.end()}};
+
+    const auto mixed_sequential = measure(
+        "mixed precision, sequential", [&] { return mixed.closest_to_each(queries, Raychel::OcTreeBatchMode::sequential); });
+    const auto mixed_interleaved = measure("mixed precision, interleaved (8)", [&] { return mixed.closest_to_each(queries); });
+
+    for (std::size_t i{}; i != queries.size(); ++i) {
+        REQUIRE(mixed_sequential[i]->value == sequential[i]->value);
+        REQUIRE(mixed_interleaved[i]->value == sequential[i]->value);
+    }
+}
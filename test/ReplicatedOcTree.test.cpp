@@ -0,0 +1,58 @@
+#include "RaychelCore/OctTree.h"
+#include "RaychelCore/ReplicatedOcTree.h"
+
+#include "catch2/catch.hpp"
+
+#include <cstddef>
+#include <random>
+#include <vector>
+
+namespace {
+    struct point
+    {
+        point() = delete;
+
+        point(double _x, double _y, double _z) : x{_x}, y{_y}, z{_z}
+        {}
+
+        constexpr auto operator<=>(const point&) const noexcept = default;
+
+        double x, y, z;
+    };
+
+    using Tree = Raychel::OcTree<
+        point, 8, 10, point, Raychel::details::BoundingBoxFromCoordinate, Raychel::details::GetDistanceToPoint,
+        Raychel::details::NoAggregate, Raychel::HugePageAllocator<point>>;
+} // namespace
+
+TEST_CASE("ReplicatedOcTree: one copy per NUMA node")
+{
+    std::mt19937 rng{7};
+    std::uniform_real_distribution<double> dist{0., 100.};
+
+    std::vector<point> points{};
+    for (std::size_t i{}; i != 5'000; ++i) {
+        points.emplace_back(dist(rng), dist(rng), dist(rng));
+    }
+
+    const Tree tree{point{0, 0, 0}, point{100, 100, 100}, {points.begin(), points.end()}};
+    const Raychel::ReplicatedOcTree replicated{tree};
+
+    REQUIRE(replicated.replica_count() == Raychel::numa_node_count());
+
+    for (std::size_t node{}; node != replicated.replica_count(); ++node) {
+        const auto& replica = replicated.replica(node);
+        REQUIRE(&replica != &tree);
+        REQUIRE(replica.size() == tree.size());
+    }
+
+    for (std::size_t i{}; i != 100; ++i) {
+        const point where{dist(rng), dist(rng), dist(rng)};
+
+        const auto expected = tree.closest_to(where);
+        const auto actual = replicated.local().closest_to(where);
+        REQUIRE(expected.has_value());
+        REQUIRE(actual.has_value());
+        REQUIRE(actual->value == expected->value);
+    }
+}
@@ -0,0 +1,242 @@
+#include "RaychelCore/SmallAny.h"
+
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct Light
+{
+    Light() = default;
+    Light(const Light&) = default;
+    Light(Light&&) noexcept = default;
+    Light& operator=(const Light&) = default;
+    Light& operator=(Light&&) noexcept = default;
+    virtual ~Light() = default;
+
+    [[nodiscard]] virtual double power() const noexcept = 0;
+};
+
+struct PointLight final : Light
+{
+    explicit PointLight(double _intensity) noexcept : intensity{_intensity}
+    {}
+
+    [[nodiscard]] double power() const noexcept override
+    {
+        return intensity;
+    }
+
+    double intensity{};
+};
+
+struct AreaLight final : Light
+{
+    AreaLight(double _intensity, double _area) noexcept : intensity{_intensity}, area{_area}
+    {}
+
+    [[nodiscard]] double power() const noexcept override
+    {
+        return intensity * area;
+    }
+
+    double intensity{};
+    double area{};
+};
+
+//Too large to be stored inline
+struct EnvironmentLight final : Light
+{
+    explicit EnvironmentLight(double _power) noexcept
+    {
+        samples[0] = _power;
+    }
+
+    [[nodiscard]] double power() const noexcept override
+    {
+        return samples[0];
+    }
+
+    std::array<double, 16> samples{};
+};
+
+//Light is not the first base, so the pointer to it has to be adjusted
+struct Named
+{
+    std::string name{"named"};
+};
+
+struct NamedLight final : Named, Light
+{
+    [[nodiscard]] double power() const noexcept override
+    {
+        return static_cast<double>(name.size());
+    }
+};
+
+using Any = Raychel::SmallAny<>;
+using AnyLight = Raychel::SmallPolymorphic<Light>;
+
+TEST_CASE("SmallAny")
+{
+    Any any{};
+    REQUIRE_FALSE(any.has_value());
+    REQUIRE_FALSE(any.holds<int>());
+    REQUIRE(any.get_if<int>() == nullptr);
+
+    any = 42;
+    REQUIRE(any.holds<int>());
+    REQUIRE_FALSE(any.holds<unsigned>());
+    REQUIRE(any.get<int>() == 42);
+    REQUIRE(any.get_if<long>() == nullptr);
+
+    any.emplace<std::string>(3U, 'a');
+    REQUIRE(any.get<std::string>() == "aaa");
+
+    const Any copy = any;
+    REQUIRE(*copy.get_if<std::string>() == "aaa");
+
+    any.emplace<std::array<double, 16>>();
+    REQUIRE(any.is_heap());
+    REQUIRE(any.holds<std::array<double, 16>>());
+
+    any.reset();
+    REQUIRE_FALSE(any.has_value());
+
+    //Like std::any, arrays decay to pointers
+    const char* const hello = "hello";
+    const Any string_literal{"hello"};
+    REQUIRE(string_literal.holds<const char*>());
+    REQUIRE(std::string_view{string_literal.get<const char*>()} == hello);
+
+    any.emplace<const char[6]>(hello);
+    REQUIRE(any.holds<const char*>());
+
+    //Like std::any, only copyable types can be stored
+    STATIC_REQUIRE_FALSE(std::is_constructible_v<Any, std::unique_ptr<int>>);
+}
+
+TEST_CASE("SmallPolymorphic")
+{
+    AnyLight light{};
+    REQUIRE_FALSE(light);
+    REQUIRE(light.get() == nullptr);
+
+    light = PointLight{2.};
+    REQUIRE(light);
+    REQUIRE_FALSE(light.is_heap());
+    REQUIRE(light->power() == 2.);
+    REQUIRE(light.holds<PointLight>());
+    REQUIRE_FALSE(light.holds<AreaLight>());
+    REQUIRE_FALSE(light.holds<Light>());
+    REQUIRE(light.get_if<PointLight>()->intensity == 2.);
+
+    light.emplace<AreaLight>(2., 3.);
+    REQUIRE((*light).power() == 6.);
+
+    auto copy = light;
+    copy.get_if<AreaLight>()->area = 1.;
+    REQUIRE(copy->power() == 2.);
+    REQUIRE(light->power() == 6.);
+
+    light = EnvironmentLight{4.};
+    REQUIRE(light.is_heap());
+    REQUIRE(light->power() == 4.);
+
+    light.emplace<NamedLight>();
+    REQUIRE(light->power() == 5.);
+    const auto moved = std::move(light);
+    REQUIRE(moved->power() == 5.);
+    REQUIRE_FALSE(light); //NOLINT(bugprone-use-after-move)
+
+    STATIC_REQUIRE_FALSE(std::is_constructible_v<AnyLight, std::string>);
+}
+
+TEST_CASE("SmallAny: visit")
+{
+    const auto power = [](const auto& light) { return light.power(); };
+
+    //Types that are not listed are called through the base class
+    const std::vector<AnyLight> lights{PointLight{1.}, AreaLight{2., 2.}, EnvironmentLight{3.}};
+    REQUIRE(Raychel::visit<PointLight, AreaLight>(power, lights[0]) == 1.);
+    REQUIRE(Raychel::visit<PointLight, AreaLight>(power, lights[1]) == 4.);
+    REQUIRE(Raychel::visit<PointLight, AreaLight>(power, lights[2]) == 3.);
+
+    Any any{std::string{"string"}};
+    const auto size = Raychel::visit<int, std::string>(
+        [](auto& value) {
+            if constexpr (std::is_same_v<std::remove_cvref_t<decltype(value)>, std::string>) {
+                value += "s";
+                return value.size();
+            } else {
+                return std::size_t{};
+            }
+        },
+        any);
+    REQUIRE(size == 7U);
+    REQUIRE(any.get<std::string>() == "strings");
+}
+
+TEST_CASE("SmallPolymorphic: benchmark", "[.][benchmark]")
+{
+    constexpr std::size_t light_count = 4'000'000;
+
+    std::mt19937 rng{2468};
+    std::uniform_int_distribution<int> kind{0, 1};
+    std::uniform_real_distribution<double> dist{0., 1.};
+
+    std::vector<std::unique_ptr<Light>> pointers{};
+    std::vector<AnyLight> values{};
+    for (std::size_t i{}; i != light_count; ++i) {
+        const auto intensity = dist(rng);
+        if (kind(rng) == 0) {
+            pointers.push_back(std::make_unique<PointLight>(intensity));
+            values.emplace_back(PointLight{intensity});
+        } else {
+            pointers.push_back(std::make_unique<AreaLight>(intensity, 2.));
+            values.emplace_back(AreaLight{intensity, 2.});
+        }
+    }
+    //Objects created one after another are often adjacent on the heap, which is not the case in a real scene
+    std::shuffle(pointers.begin(), pointers.end(), rng);
+    std::shuffle(values.begin(), values.end(), rng);
+
+    const auto measure = [&](const char* name, auto&& run) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto total = run();
+        const auto duration = std::chrono::steady_clock::now() - start;
+        std::cerr << name << ": " << duration_cast<std::chrono::milliseconds>(duration) << '\n';
+        return total;
+    };
+
+    const auto expected = measure("std::unique_ptr", [&] {
+        double total{};
+        for (const auto& light : pointers) {
+            total += light->power();
+        }
+        return total;
+    });
+    const auto virtual_total = measure("SmallPolymorphic", [&] {
+        double total{};
+        for (const auto& light : values) {
+            total += light->power();
+        }
+        return total;
+    });
+    const auto visited_total = measure("SmallPolymorphic, visit", [&] {
+        double total{};
+        for (const auto& light : values) {
+            total += Raychel::visit<PointLight, AreaLight>([](const auto& l) { return l.power(); }, light);
+        }
+        return total;
+    });
+
+    REQUIRE(virtual_total == Approx(expected));
+    REQUIRE(visited_total == Approx(expected));
+}
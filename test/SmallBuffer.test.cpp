@@ -4,6 +4,9 @@
 #include <cstddef>
 #include <cstdint>
 #include <iostream>
+#include <memory>
+#include <type_traits>
+#include <utility>
 
 using Buffer = Raychel::SmallBuffer<16>;
 
@@ -67,3 +70,256 @@ TEST_CASE("SmallBuffer: move")
     REQUIRE(move.unsafe_get_value<BigStruct>().data[0] == 0);
     REQUIRE(move.is_heap());
 }
+
+struct alignas(32) Vector8f
+{
+    float values[8]{};
+};
+
+struct alignas(64) CacheLine
+{
+    std::uint64_t values[8]{};
+};
+
+struct InstanceCounter
+{
+    InstanceCounter() noexcept
+    {
+        ++instances;
+    }
+
+    InstanceCounter(const InstanceCounter&) noexcept
+    {
+        ++instances;
+    }
+
+    InstanceCounter(InstanceCounter&&) noexcept
+    {
+        ++instances;
+    }
+
+    InstanceCounter& operator=(const InstanceCounter&) = default;
+    InstanceCounter& operator=(InstanceCounter&&) = default;
+
+    ~InstanceCounter() noexcept
+    {
+        --instances;
+    }
+
+    static inline int instances{};
+};
+
+template <typename B, typename T>
+constexpr bool can_emplace = requires(B buffer, T value) { buffer.emplace(std::move(value)); };
+
+TEST_CASE("SmallBuffer: move-only objects")
+{
+    using Pointer = std::unique_ptr<int>;
+    using MoveOnlyBuffer = Raychel::MoveOnlySmallBuffer<16>;
+
+    //A copyable buffer must never hold something it cannot copy
+    STATIC_REQUIRE_FALSE(Buffer::can_store<Pointer>);
+    STATIC_REQUIRE_FALSE(can_emplace<Buffer, Pointer>);
+    STATIC_REQUIRE(std::is_copy_constructible_v<Buffer>);
+
+    STATIC_REQUIRE_FALSE(std::is_copy_constructible_v<MoveOnlyBuffer>);
+    STATIC_REQUIRE_FALSE(std::is_copy_assignable_v<MoveOnlyBuffer>);
+    STATIC_REQUIRE(std::is_nothrow_move_constructible_v<MoveOnlyBuffer>);
+
+    MoveOnlyBuffer buffer{std::make_unique<int>(3)};
+    MoveOnlyBuffer moved{std::move(buffer)};
+    REQUIRE(*moved.unsafe_get_value<Pointer>() == 3);
+}
+
+TEST_CASE("SmallBuffer: overhead")
+{
+    STATIC_REQUIRE(sizeof(Raychel::SmallBuffer<24, 8>) == 24 + sizeof(void*));
+    STATIC_REQUIRE(sizeof(Raychel::SmallBuffer<64, 64>) == 128);
+    STATIC_REQUIRE(alignof(Raychel::SmallBuffer<32, 32>) == 32);
+}
+
+TEST_CASE("SmallBuffer: no statistics by default")
+{
+    //SmallBufferStatistics.test.cpp stores doubles in the same buffer type with statistics enabled
+    Raychel::SmallBuffer<24, 8> buffer{};
+    for (int i{}; i != 10; ++i) {
+        buffer.emplace(static_cast<double>(i));
+    }
+    REQUIRE(buffer.unsafe_get_value<double>() == 9.);
+    REQUIRE(Raychel::small_buffer_statistics().empty());
+}
+
+TEST_CASE("SmallBuffer: over-aligned types")
+{
+    SECTION("Inline")
+    {
+        Raychel::SmallBuffer<32, 32> buffer{Vector8f{{1, 2, 3, 4, 5, 6, 7, 8}}};
+        REQUIRE_FALSE(buffer.is_heap());
+        REQUIRE(reinterpret_cast<std::uintptr_t>(buffer.unsafe_get_ptr()) % 32U == 0U);
+
+        auto copy = buffer;
+        REQUIRE_FALSE(copy.is_heap());
+        REQUIRE(copy.unsafe_get_value<Vector8f>().values[7] == 8.F);
+
+        Raychel::SmallBuffer<64, 64> cache_line{CacheLine{{1, 2, 3, 4, 5, 6, 7, 8}}};
+        REQUIRE_FALSE(cache_line.is_heap());
+        REQUIRE(reinterpret_cast<std::uintptr_t>(cache_line.unsafe_get_ptr()) % 64U == 0U);
+
+        const auto moved = std::move(cache_line);
+        REQUIRE(moved.unsafe_get_value<CacheLine>().values[7] == 8U);
+        REQUIRE(cache_line.unsafe_get_ptr() == nullptr);
+    }
+
+    SECTION("Heap")
+    {
+        //Large enough, but not aligned enough
+        Raychel::SmallBuffer<64, 16> buffer{CacheLine{{1, 2, 3, 4, 5, 6, 7, 8}}};
+        REQUIRE(buffer.is_heap());
+        REQUIRE(reinterpret_cast<std::uintptr_t>(buffer.unsafe_get_ptr()) % 64U == 0U);
+
+        const auto copy = buffer;
+        REQUIRE(copy.is_heap());
+        REQUIRE(reinterpret_cast<std::uintptr_t>(copy.unsafe_get_ptr()) % 64U == 0U);
+        REQUIRE(copy.unsafe_get_value<CacheLine>().values[7] == 8U);
+    }
+}
+
+TEST_CASE("SmallBuffer: object lifetime")
+{
+    REQUIRE(InstanceCounter::instances == 0);
+    {
+        Buffer buffer{InstanceCounter{}};
+        REQUIRE(InstanceCounter::instances == 1);
+
+        Buffer copy{buffer};
+        REQUIRE(InstanceCounter::instances == 2);
+
+        Buffer moved{std::move(buffer)};
+        REQUIRE(InstanceCounter::instances == 2);
+
+        moved.emplace(BigStruct{});
+        REQUIRE(InstanceCounter::instances == 1);
+
+        copy = moved;
+        REQUIRE(InstanceCounter::instances == 0);
+
+        const InstanceCounter counter{};
+        moved.emplace(counter);
+        REQUIRE(InstanceCounter::instances == 2);
+    }
+    REQUIRE(InstanceCounter::instances == 0);
+}
+
+//Points into itself, like a string in small string mode. Copying its bytes would leave it pointing into the old object
+struct SelfPointer
+{
+    SelfPointer() noexcept = default;
+
+    SelfPointer(const SelfPointer& other) noexcept : value{other.value}
+    {}
+
+    SelfPointer(SelfPointer&& other) noexcept : value{other.value}
+    {}
+
+    SelfPointer& operator=(const SelfPointer&) = delete;
+    SelfPointer& operator=(SelfPointer&&) = delete;
+
+    ~SelfPointer() = default;
+
+    std::uint32_t value{};
+    std::uint32_t* self{&value};
+};
+
+struct ThrowingMove
+{
+    ThrowingMove() = default;
+
+    ThrowingMove(const ThrowingMove&) = default;
+
+    //NOLINTNEXTLINE: this is supposed to be potentially throwing
+    ThrowingMove(ThrowingMove&& other) : value{other.value}
+    {}
+
+    ThrowingMove& operator=(const ThrowingMove&) = delete;
+    ThrowingMove& operator=(ThrowingMove&&) = delete;
+
+    ~ThrowingMove() = default;
+
+    std::uint32_t value{};
+};
+
+//Not trivially copyable, but safe to move byte by byte
+struct Relocatable
+{
+    Relocatable() = default;
+
+    Relocatable(const Relocatable& other) noexcept : value{other.value}
+    {}
+
+    Relocatable(Relocatable&& other) noexcept : value{other.value}
+    {
+        ++moves;
+    }
+
+    Relocatable& operator=(const Relocatable&) = delete;
+    Relocatable& operator=(Relocatable&&) = delete;
+
+    ~Relocatable() = default;
+
+    std::uint32_t value{};
+
+    static inline int moves{};
+};
+
+template <>
+struct Raychel::is_trivially_relocatable<Relocatable> : std::true_type
+{};
+
+TEST_CASE("SmallBuffer: relocation")
+{
+    STATIC_REQUIRE(Raychel::is_trivially_relocatable_v<SmallStruct>);
+    STATIC_REQUIRE_FALSE(Raychel::is_trivially_relocatable_v<SelfPointer>);
+    STATIC_REQUIRE(Raychel::is_trivially_relocatable_v<Relocatable>);
+
+    SECTION("Objects that point into themselves")
+    {
+        Buffer buffer{SelfPointer{}};
+        REQUIRE_FALSE(buffer.is_heap());
+        buffer.unsafe_get_value<SelfPointer>().value = 42;
+
+        Buffer moved{std::move(buffer)};
+        auto& object = moved.unsafe_get_value<SelfPointer>();
+        REQUIRE(object.self == &object.value);
+        REQUIRE(*object.self == 42);
+
+        Buffer assigned{};
+        assigned = std::move(moved);
+        auto& assigned_object = assigned.unsafe_get_value<SelfPointer>();
+        REQUIRE(assigned_object.self == &assigned_object.value);
+    }
+
+    SECTION("Objects that may throw while being moved")
+    {
+        STATIC_REQUIRE_FALSE(Buffer::stores_inline<ThrowingMove>);
+
+        Buffer buffer{ThrowingMove{}};
+        REQUIRE(buffer.is_heap());
+
+        const auto* object = buffer.unsafe_get_ptr();
+        const Buffer moved{std::move(buffer)};
+        REQUIRE(moved.unsafe_get_ptr() == object);
+    }
+
+    SECTION("Trivially relocatable objects")
+    {
+        Relocatable::moves = 0;
+
+        Buffer buffer{Relocatable{}};
+        REQUIRE(Relocatable::moves == 1);
+        buffer.unsafe_get_value<Relocatable>().value = 7;
+
+        const Buffer moved{std::move(buffer)};
+        REQUIRE(Relocatable::moves == 1);
+        REQUIRE(moved.unsafe_get_value<Relocatable>().value == 7);
+    }
+}
@@ -0,0 +1,143 @@
+#include "RaychelCore/SmallBufferResources.h"
+
+#include <catch2/catch.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+
+struct Payload
+{
+    std::uint32_t data[16]{};
+};
+
+//Counts the bytes that are currently allocated through it
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    std::size_t allocated{};
+    std::size_t allocations{};
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        allocated += bytes;
+        ++allocations;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override
+    {
+        allocated -= bytes;
+        std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+    }
+
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+TEST_CASE("SmallBuffer resources: overhead")
+{
+    using Default = Raychel::SmallBuffer<16, 8>;
+    STATIC_REQUIRE(sizeof(Raychel::SmallBuffer<16, 8, Raychel::ThreadLocalPoolResource>) == sizeof(Default));
+    STATIC_REQUIRE(sizeof(Raychel::SmallBuffer<16, 8, Raychel::PmrResource>) == sizeof(Default) + sizeof(void*));
+}
+
+TEST_CASE("SmallBuffer resources: memory_resource")
+{
+    using Buffer = Raychel::SmallBuffer<16, alignof(std::max_align_t), Raychel::PmrResource>;
+
+    CountingResource resource{};
+    CountingResource other_resource{};
+    {
+        Buffer buffer{std::allocator_arg, &resource, Payload{{1, 2, 3}}};
+        REQUIRE(buffer.is_heap());
+        REQUIRE(resource.allocated == sizeof(Payload));
+
+        //Objects that fit are never allocated
+        Buffer small{std::allocator_arg, &resource, std::uint32_t{4}};
+        REQUIRE(resource.allocations == 1U);
+
+        //Copies allocate from the resource of the original
+        const Buffer copy{buffer};
+        REQUIRE(copy.resource().resource() == &resource);
+        REQUIRE(resource.allocated == 2 * sizeof(Payload));
+
+        //Copy assignment keeps the target resource
+        Buffer assigned{std::allocator_arg, &other_resource};
+        assigned = buffer;
+        REQUIRE(assigned.resource().resource() == &other_resource);
+        REQUIRE(other_resource.allocated == sizeof(Payload));
+        REQUIRE(assigned.unsafe_get_value<Payload>().data[2] == 3U);
+
+        //Moves take the resource along
+        assigned = std::move(buffer);
+        REQUIRE(assigned.resource().resource() == &resource);
+        REQUIRE(other_resource.allocated == 0U);
+        REQUIRE(resource.allocated == 2 * sizeof(Payload));
+        REQUIRE(assigned.unsafe_get_value<Payload>().data[2] == 3U);
+    }
+    REQUIRE(resource.allocated == 0U);
+    REQUIRE(other_resource.allocated == 0U);
+}
+
+TEST_CASE("SmallBuffer resources: thread local pool")
+{
+    using Pool = Raychel::details::ThreadLocalPool;
+    REQUIRE(Pool::size_class(1) == 0U);
+    REQUIRE(Pool::size_class(16) == 0U);
+    REQUIRE(Pool::size_class(17) == 1U);
+    REQUIRE(Pool::size_class(64) == 2U);
+    REQUIRE(Pool::size_class(Pool::max_block_size) == Pool::size_classes - 1U);
+
+    using Buffer = Raychel::SmallBuffer<16, alignof(std::max_align_t), Raychel::ThreadLocalPoolResource>;
+
+    SECTION("Blocks are recycled")
+    {
+        const void* first_block{};
+        {
+            Buffer buffer{Payload{{1, 2, 3}}};
+            first_block = buffer.unsafe_get_ptr();
+        }
+        Buffer buffer{Payload{{4, 5, 6}}};
+        REQUIRE(buffer.unsafe_get_ptr() == first_block);
+        REQUIRE(buffer.unsafe_get_value<Payload>().data[2] == 6U);
+
+        //Same size class, different type
+        buffer = Buffer{};
+        struct Similar
+        {
+            std::uint32_t data[13]{};
+        };
+        const Buffer similar{Similar{}};
+        REQUIRE(similar.unsafe_get_ptr() == first_block);
+    }
+
+    SECTION("Large objects")
+    {
+        struct Large
+        {
+            std::byte data[Pool::max_block_size + 1]{};
+        };
+        Buffer buffer{Large{}};
+        REQUIRE(buffer.is_heap());
+        auto copy = buffer;
+        REQUIRE(copy.is_heap());
+    }
+
+    SECTION("Release on a different thread")
+    {
+        std::vector<Buffer> buffers{};
+        for (std::uint32_t i{}; i != 2 * Pool::max_cached_blocks; ++i) {
+            buffers.emplace_back(Payload{{i}});
+        }
+        std::thread{[&buffers] { buffers.clear(); }}.join();
+
+        Buffer buffer{Payload{{42}}};
+        REQUIRE(buffer.unsafe_get_value<Payload>().data[0] == 42U);
+    }
+}
@@ -0,0 +1,115 @@
+#define RAYCHELCORE_SMALL_BUFFER_STATISTICS 1
+#include "RaychelCore/SmallBuffer.h"
+
+#include "catch2/catch.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <sstream>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct Small
+    {
+        std::uint32_t value{};
+    };
+
+    struct Large
+    {
+        std::array<std::uint32_t, 16> values{};
+    };
+
+    using Buffer = Raychel::SmallBuffer<24, 8>;
+
+    [[nodiscard]] const Raychel::SmallBufferSpillStatistics* find(
+        const std::vector<Raychel::SmallBufferSpillStatistics>& statistics, std::string_view type)
+    {
+        const auto it = std::ranges::find_if(statistics, [&](const auto& entry) { return entry.type.ends_with(type); });
+        return it == statistics.end() ? nullptr : &*it;
+    }
+} // namespace
+
+TEST_CASE("SmallBuffer statistics: counters")
+{
+    Raychel::reset_small_buffer_statistics();
+
+    Buffer buffer{};
+    for (std::uint32_t i{}; i != 10; ++i) {
+        buffer.emplace(Small{i});
+    }
+    for (std::uint32_t i{}; i != 3; ++i) {
+        buffer.emplace(Large{});
+    }
+
+    //Copies are not counted
+    const auto copy = buffer;
+    REQUIRE(copy.is_heap());
+
+    const auto statistics = Raychel::small_buffer_statistics();
+    const auto* small = find(statistics, "Small");
+    const auto* large = find(statistics, "Large");
+    REQUIRE(small != nullptr);
+    REQUIRE(large != nullptr);
+
+    REQUIRE(small->stores == 10U);
+    REQUIRE(small->spills == 0U);
+    REQUIRE(small->object_size == sizeof(Small));
+    REQUIRE(small->buffer_size == 24U);
+    REQUIRE(small->buffer_alignment == 8U);
+
+    REQUIRE(large->stores == 3U);
+    REQUIRE(large->spills == 3U);
+    REQUIRE(large->object_size == sizeof(Large));
+    REQUIRE(large->buffer.find("SmallBuffer") != std::string_view::npos);
+
+    //Most spills first
+    REQUIRE(large < small);
+
+    Raychel::reset_small_buffer_statistics();
+    REQUIRE(find(Raychel::small_buffer_statistics(), "Large")->stores == 0U);
+}
+
+TEST_CASE("SmallBuffer statistics: types also stored without statistics")
+{
+    Raychel::reset_small_buffer_statistics();
+
+    //SmallBuffer.test.cpp stores doubles in the same buffer type with statistics disabled
+    Buffer buffer{};
+    for (int i{}; i != 5; ++i) {
+        buffer.emplace(static_cast<double>(i));
+    }
+
+    const auto statistics = Raychel::small_buffer_statistics();
+    const auto* doubles = find(statistics, "double");
+    REQUIRE(doubles != nullptr);
+    REQUIRE(doubles->stores == 5U);
+}
+
+TEST_CASE("SmallBuffer statistics: threads and printing")
+{
+    Raychel::reset_small_buffer_statistics();
+
+    std::vector<std::thread> threads{};
+    for (int i{}; i != 4; ++i) {
+        threads.emplace_back([] {
+            Buffer buffer{};
+            for (int j{}; j != 1'000; ++j) {
+                buffer.emplace(Large{});
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    const auto statistics = Raychel::small_buffer_statistics();
+    REQUIRE(find(statistics, "Large")->spills == 4'000U);
+
+    std::ostringstream stream{};
+    Raychel::print_small_buffer_statistics(stream);
+    REQUIRE(stream.str().find("Large") != std::string::npos);
+    REQUIRE(stream.str().find("4000 of 4000 spilled") != std::string::npos);
+}
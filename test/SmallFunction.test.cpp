@@ -0,0 +1,161 @@
+#include "RaychelCore/SmallFunction.h"
+
+#include <catch2/catch.hpp>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using Function = Raychel::SmallFunction<int(int)>;
+
+static int twice(int value)
+{
+    return 2 * value;
+}
+
+TEST_CASE("SmallFunction: construction")
+{
+    Function empty{};
+    REQUIRE_FALSE(empty);
+    REQUIRE(empty == nullptr);
+
+    const Function pointer{&twice};
+    REQUIRE(pointer);
+    REQUIRE(pointer(21) == 42);
+
+    int (*null_pointer)(int) = nullptr;
+    const Function from_null{null_pointer};
+    REQUIRE_FALSE(from_null);
+
+    const int offset = 3;
+    Function lambda{[offset](int value) { return value + offset; }};
+    REQUIRE(lambda(1) == 4);
+    REQUIRE_FALSE(lambda.is_heap());
+
+    lambda = [](int value) { return -value; };
+    REQUIRE(lambda(1) == -1);
+
+    lambda = nullptr;
+    REQUIRE_FALSE(lambda);
+
+    //The result is converted to the return type
+    const Raychel::SmallFunction<void(int)> discard{&twice};
+    discard(1);
+    const Raychel::SmallFunction<long(short)> convert{&twice};
+    REQUIRE(convert(short{4}) == 8L);
+}
+
+TEST_CASE("SmallFunction: state")
+{
+    Raychel::SmallFunction<int()> counter{[count = 0]() mutable { return ++count; }};
+    REQUIRE(counter() == 1);
+    REQUIRE(counter() == 2);
+
+    auto copy = counter;
+    REQUIRE(copy() == 3);
+    REQUIRE(counter() == 3);
+
+    auto moved = std::move(counter);
+    REQUIRE_FALSE(counter); //NOLINT(bugprone-use-after-move)
+    REQUIRE(moved() == 4);
+
+    //References are forwarded, not copied
+    const Raychel::SmallFunction<void(std::vector<int>&)> append{[](std::vector<int>& values) { values.push_back(1); }};
+    std::vector<int> values{};
+    append(values);
+    REQUIRE(values.size() == 1U);
+}
+
+TEST_CASE("SmallFunction: storage")
+{
+    std::array<std::byte, 64> big_capture{};
+    big_capture[63] = std::byte{7};
+    const auto big = [big_capture](int value) { return value + static_cast<int>(big_capture[63]); };
+
+    const Function heap{big};
+    REQUIRE(heap.is_heap());
+    REQUIRE(heap(1) == 8);
+
+    const Raychel::SmallFunction<int(int), 64> large_buffer{big};
+    REQUIRE_FALSE(large_buffer.is_heap());
+    REQUIRE(large_buffer(1) == 8);
+
+    using NoHeap = Raychel::SmallFunction<int(int), 16, Raychel::SmallFunctionStorage::inline_only>;
+    STATIC_REQUIRE(std::is_constructible_v<NoHeap, decltype(&twice)>);
+    STATIC_REQUIRE_FALSE(std::is_constructible_v<NoHeap, decltype(big)>);
+    STATIC_REQUIRE_FALSE(std::is_assignable_v<NoHeap&, decltype(big)>);
+
+    //Signatures are checked, too
+    STATIC_REQUIRE_FALSE(std::is_constructible_v<Function, int (*)(int, int)>);
+}
+
+TEST_CASE("SmallFunction: move-only callables")
+{
+    auto pointer = std::make_unique<int>(5);
+    const auto capture = [pointer = std::move(pointer)](int value) { return *pointer + value; };
+
+    using MoveOnly = Raychel::MoveOnlySmallFunction<int(int)>;
+    STATIC_REQUIRE_FALSE(std::is_constructible_v<Function, decltype(capture)>);
+    STATIC_REQUIRE_FALSE(std::is_copy_constructible_v<MoveOnly>);
+    STATIC_REQUIRE(std::is_nothrow_move_constructible_v<MoveOnly>);
+
+    MoveOnly function{[pointer = std::make_unique<int>(5)](int value) { return *pointer + value; }};
+    REQUIRE(function(1) == 6);
+
+    MoveOnly moved{std::move(function)};
+    REQUIRE_FALSE(function); //NOLINT(bugprone-use-after-move)
+    REQUIRE(moved(2) == 7);
+
+    //Copyable callables work as well
+    moved = &twice;
+    REQUIRE(moved(2) == 4);
+}
+
+TEST_CASE("SmallFunction: benchmark", "[.][benchmark]")
+{
+    constexpr std::size_t job_count = 4'194'304;
+
+    //A typical job: a few pointers and indices, too large for the inline buffer of std::function
+    struct Job
+    {
+        const int* input{};
+        int* output{};
+        std::size_t begin{};
+        std::size_t end{};
+    };
+
+    std::vector<int> input(1024, 1);
+    std::vector<int> output(1024);
+
+    const auto measure = [&]<typename Queue>(const char* name) {
+        Queue queue{};
+        queue.reserve(job_count);
+
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t i{}; i != job_count; ++i) {
+            const Job job{input.data(), output.data(), i % 1024, i % 1024 + 1};
+            queue.emplace_back([job]() {
+                for (auto j = job.begin; j != job.end; ++j) {
+                    job.output[j] += job.input[j];
+                }
+            });
+        }
+        const auto enqueued = std::chrono::steady_clock::now();
+        for (const auto& function : queue) {
+            function();
+        }
+        const auto invoked = std::chrono::steady_clock::now();
+
+        std::cerr << name << ": enqueue " << duration_cast<std::chrono::milliseconds>(enqueued - start) << ", invoke "
+                  << duration_cast<std::chrono::milliseconds>(invoked - enqueued) << '\n';
+    };
+
+    measure.operator()<std::vector<std::function<void()>>>("std::function");
+    measure.operator()<std::vector<Raychel::SmallFunction<void()>>>("SmallFunction");
+    measure.operator()<std::vector<Raychel::MoveOnlySmallFunction<void()>>>("MoveOnlySmallFunction");
+
+    REQUIRE(output[0] == 3 * static_cast<int>(job_count / 1024));
+}
@@ -0,0 +1,261 @@
+#include "RaychelCore/SmallVector.h"
+
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using Vector = Raychel::SmallVector<int, 4>;
+
+//Points into itself, so it has to be moved with its move constructor
+struct Tracked
+{
+    explicit Tracked(int _value) noexcept : value{_value}
+    {
+        ++instances;
+    }
+
+    Tracked(const Tracked& other) noexcept : value{other.value}
+    {
+        ++instances;
+    }
+
+    Tracked(Tracked&& other) noexcept : value{other.value}
+    {
+        ++instances;
+    }
+
+    Tracked& operator=(const Tracked& other) noexcept
+    {
+        value = other.value;
+        return *this;
+    }
+
+    Tracked& operator=(Tracked&& other) noexcept
+    {
+        value = other.value;
+        return *this;
+    }
+
+    ~Tracked() noexcept
+    {
+        REQUIRE(self == this);
+        --instances;
+    }
+
+    int value{};
+    Tracked* self{this};
+
+    static inline int instances{};
+};
+
+struct ThrowOnCopy
+{
+    ThrowOnCopy() = default;
+
+    ThrowOnCopy(const ThrowOnCopy& other) : value{other.value}
+    {
+        if (value == 3)
+            throw std::runtime_error{"copy"};
+    }
+
+    //May throw, so growing has to copy instead
+    ThrowOnCopy(ThrowOnCopy&& other) : value{other.value} //NOLINT(performance-noexcept-move-constructor)
+    {}
+
+    ThrowOnCopy& operator=(const ThrowOnCopy&) = default;
+    ThrowOnCopy& operator=(ThrowOnCopy&&) = default;
+    ~ThrowOnCopy() = default;
+
+    int value{};
+};
+
+TEST_CASE("SmallVector: construction")
+{
+    const Vector empty{};
+    REQUIRE(empty.empty());
+    REQUIRE(empty.capacity() == 4U);
+    REQUIRE_FALSE(empty.is_heap());
+
+    const Vector values{1, 2, 3};
+    REQUIRE(values.size() == 3U);
+    REQUIRE(values.front() == 1);
+    REQUIRE(values.back() == 3);
+    REQUIRE_FALSE(values.is_heap());
+
+    const Vector many{1, 2, 3, 4, 5};
+    REQUIRE(many.size() == 5U);
+    REQUIRE(many.is_heap());
+    REQUIRE(many[4] == 5);
+
+    const Vector filled(6, 7);
+    REQUIRE(filled.size() == 6U);
+    REQUIRE(std::all_of(filled.begin(), filled.end(), [](int value) { return value == 7; }));
+
+    const std::vector<int> source{5, 4, 3};
+    const Vector from_range(source.begin(), source.end());
+    REQUIRE(std::equal(from_range.rbegin(), from_range.rend(), Vector{3, 4, 5}.begin()));
+
+    STATIC_REQUIRE(sizeof(Raychel::SmallVector<std::uint64_t, 4>) == 4 * sizeof(std::uint64_t) + 2 * sizeof(std::size_t));
+    STATIC_REQUIRE(Raychel::is_trivially_relocatable_v<Vector>);
+    STATIC_REQUIRE_FALSE(Raychel::is_trivially_relocatable_v<Raychel::SmallVector<Tracked, 4>>);
+}
+
+TEST_CASE("SmallVector: modification")
+{
+    Vector vector{};
+    for (int i{}; i != 10; ++i) {
+        vector.push_back(i);
+    }
+    REQUIRE(vector.size() == 10U);
+    REQUIRE(vector.is_heap());
+    REQUIRE(std::accumulate(vector.begin(), vector.end(), 0) == 45);
+
+    //Arguments may refer to the vector itself, even if it has to grow
+    vector.resize(vector.capacity());
+    vector.push_back(vector[9]);
+    REQUIRE(vector.back() == 9);
+
+    vector.erase(vector.begin() + 1, vector.end() - 1);
+    REQUIRE(vector == Vector{0, 9});
+
+    vector.insert(vector.begin() + 1, 5);
+    vector.insert(vector.end(), 10);
+    REQUIRE(vector == Vector{0, 5, 9, 10});
+
+    vector.erase(vector.begin());
+    vector.pop_back();
+    REQUIRE(vector == Vector{5, 9});
+
+    vector.shrink_to_fit();
+    REQUIRE_FALSE(vector.is_heap());
+    REQUIRE(vector == Vector{5, 9});
+
+    vector.resize(4);
+    REQUIRE(vector == Vector{5, 9, 0, 0});
+
+    vector.clear();
+    REQUIRE(vector.empty());
+}
+
+TEST_CASE("SmallVector: copy and move")
+{
+    SECTION("Inline")
+    {
+        Vector vector{1, 2, 3};
+        Vector copy{vector};
+        REQUIRE(copy == vector);
+
+        const Vector moved{std::move(vector)};
+        REQUIRE(moved == copy);
+        REQUIRE(vector.empty()); //NOLINT(bugprone-use-after-move)
+
+        copy = Vector{4, 5, 6, 7, 8};
+        REQUIRE(copy.is_heap());
+        REQUIRE(copy.size() == 5U);
+    }
+
+    SECTION("Heap")
+    {
+        Vector vector{1, 2, 3, 4, 5};
+        const auto* data = vector.data();
+
+        Vector copy{};
+        copy = vector;
+        REQUIRE(copy == vector);
+        REQUIRE(copy.data() != data);
+
+        //Heap storage is handed over
+        const Vector moved{std::move(vector)};
+        REQUIRE(moved.data() == data);
+        REQUIRE_FALSE(vector.is_heap()); //NOLINT(bugprone-use-after-move)
+        REQUIRE(vector.empty());
+    }
+}
+
+TEST_CASE("SmallVector: relocation")
+{
+    REQUIRE(Tracked::instances == 0);
+    {
+        Raychel::SmallVector<Tracked, 2> vector{};
+        for (int i{}; i != 5; ++i) {
+            vector.emplace_back(i);
+        }
+        REQUIRE(Tracked::instances == 5);
+
+        auto copy = vector;
+        REQUIRE(Tracked::instances == 10);
+
+        Raychel::SmallVector<Tracked, 2> small{};
+        small.emplace_back(42);
+        auto moved = std::move(small);
+        REQUIRE(moved.front().value == 42);
+        REQUIRE(Tracked::instances == 11);
+
+        copy.erase(copy.begin(), copy.begin() + 3);
+        copy.shrink_to_fit();
+        REQUIRE_FALSE(copy.is_heap());
+        REQUIRE(copy.back().value == 4);
+        REQUIRE(Tracked::instances == 8);
+    }
+    REQUIRE(Tracked::instances == 0);
+
+    //Strings may point into themselves, they are moved normally
+    Raychel::SmallVector<std::string, 2> strings{"a", "b"};
+    strings.emplace_back("a string that is too long for the small string optimization");
+    REQUIRE(strings[0] == "a");
+    REQUIRE(strings[2].size() > 20U);
+
+    //Copying is used if moving might throw, so a failed growth leaves the vector unchanged
+    Raychel::SmallVector<ThrowOnCopy, 4> throwing(4);
+    throwing[2].value = 3;
+    REQUIRE_THROWS(throwing.emplace_back());
+    REQUIRE(throwing.size() == 4U);
+    REQUIRE(throwing[2].value == 3);
+    REQUIRE_FALSE(throwing.is_heap());
+}
+
+TEST_CASE("SmallVector: benchmark", "[.][benchmark]")
+{
+    constexpr std::size_t vector_count = 1'000'000;
+    constexpr int element_count = 8;
+
+    const auto measure = [&]<typename Vec>(const char* name) {
+        std::vector<Vec> vectors(vector_count);
+
+        const auto start = std::chrono::steady_clock::now();
+        for (auto& vector : vectors) {
+            for (int i{}; i != element_count; ++i) {
+                vector.push_back(i);
+            }
+        }
+        const auto pushed = std::chrono::steady_clock::now();
+
+        long sum{};
+        for (const auto& vector : vectors) {
+            for (const auto value : vector) {
+                sum += value;
+            }
+        }
+        const auto iterated = std::chrono::steady_clock::now();
+
+        const auto copies = vectors;
+        const auto copied = std::chrono::steady_clock::now();
+
+        std::cerr << name << ": push " << duration_cast<std::chrono::milliseconds>(pushed - start) << ", iterate "
+                  << duration_cast<std::chrono::milliseconds>(iterated - pushed) << ", copy "
+                  << duration_cast<std::chrono::milliseconds>(copied - iterated) << '\n';
+
+        REQUIRE(sum == 28L * static_cast<long>(vector_count));
+        REQUIRE(copies.back().size() == element_count);
+    };
+
+    measure.operator()<std::vector<int>>("std::vector");
+    measure.operator()<Raychel::SmallVector<int, element_count>>("SmallVector");
+}
@@ -0,0 +1,224 @@
+#include "RaychelCore/StreamingOcTree.h"
+
+#include "catch2/catch.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+    struct point
+    {
+        constexpr auto operator<=>(const point&) const noexcept = default;
+
+        double x, y, z;
+    };
+
+    //Live bytes allocated through any counting_allocator
+    std::size_t counted_bytes{};
+
+    template <typename T>
+    struct counting_allocator
+    {
+        using value_type = T;
+
+        counting_allocator() = default;
+
+        template <typename U>
+        constexpr counting_allocator(const counting_allocator<U>& /*unused*/) noexcept
+        {}
+
+        T* allocate(std::size_t n)
+        {
+            counted_bytes += n * sizeof(T);
+            return std::allocator<T>{}.allocate(n);
+        }
+
+        void deallocate(T* p, std::size_t n) noexcept
+        {
+            counted_bytes -= n * sizeof(T);
+            std::allocator<T>{}.deallocate(p, n);
+        }
+
+        template <typename U>
+        constexpr bool operator==(const counting_allocator<U>& /*unused*/) const noexcept
+        {
+            return true;
+        }
+    };
+} // namespace
+
+TEST_CASE("StreamingOcTree: same results as OcTree")
+{
+    const auto directory = std::filesystem::temp_directory_path() / "RaychelCore_StreamingOcTree_test";
+
+    std::mt19937 rng{13579};
+    std::uniform_real_distribution<double> dist{-100., 100.};
+
+    std::vector<point> points{};
+    for (std::size_t i{}; i != 5'000; ++i) {
+        points.push_back(point{dist(rng), dist(rng), dist(rng)});
+    }
+
+    //Small enough that only a few chunks fit into memory at once
+    constexpr std::size_t memory_budget = 64U * 1024U;
+
+    Raychel::StreamingOcTree<point, 2> streaming_tree{point{-100, -100, -100}, point{100, 100, 100}, directory, memory_budget};
+    const Raychel::OcTree<point> tree{point{-100, -100, -100}, point{100, 100, 100}, points};
+
+    REQUIRE(streaming_tree.insert(points.begin(), points.end()));
+    REQUIRE(streaming_tree.size() == points.size());
+    REQUIRE(streaming_tree.pending_bytes() <= memory_budget);
+
+    REQUIRE_FALSE(streaming_tree.insert(point{1000, 1000, 1000}));
+
+    std::uniform_real_distribution<double> query_dist{-150., 150.};
+    for (std::size_t i{}; i != 200; ++i) {
+        const point where{query_dist(rng), query_dist(rng), query_dist(rng)};
+
+        const auto expected = tree.closest_to(where);
+        const auto [actual, ec] = streaming_tree.closest_to(where);
+
+        REQUIRE_FALSE(ec);
+        REQUIRE(expected.has_value());
+        REQUIRE(actual.has_value());
+        REQUIRE(expected->value == actual->value);
+        REQUIRE(expected->distance == actual->distance);
+
+        REQUIRE(streaming_tree.loaded_bytes() + streaming_tree.pending_bytes() <= memory_budget);
+    }
+
+    SECTION("Predicates, k closest elements and ranges")
+    {
+        const auto above_zero = [](const point& p) { return p.z > 0.; };
+
+        for (std::size_t i{}; i != 50; ++i) {
+            const point where{query_dist(rng), query_dist(rng), query_dist(rng)};
+
+            const auto expected = tree.closest_to(where, above_zero);
+            const auto [actual, ec] = streaming_tree.closest_to(where, above_zero);
+            REQUIRE_FALSE(ec);
+            REQUIRE(actual.has_value());
+            REQUIRE(actual->value == expected->value);
+
+            const auto expected_k = tree.k_closest_to(where, 20, above_zero);
+            const auto [actual_k, k_ec] = streaming_tree.k_closest_to(where, 20, above_zero);
+            REQUIRE_FALSE(k_ec);
+            REQUIRE(actual_k.size() == expected_k.size());
+            for (std::size_t j{}; j != actual_k.size(); ++j) {
+                REQUIRE(actual_k[j].distance == expected_k[j].distance);
+            }
+
+            const auto expected_within = tree.elements_within(where, 30.);
+            const auto [actual_within, within_ec] = streaming_tree.elements_within(where, 30.);
+            REQUIRE_FALSE(within_ec);
+            REQUIRE(actual_within.size() == expected_within.size());
+            for (std::size_t j{}; j != actual_within.size(); ++j) {
+                REQUIRE(actual_within[j].distance == expected_within[j].distance);
+            }
+        }
+    }
+
+    SECTION("Flushing all pending elements")
+    {
+        REQUIRE(streaming_tree.flush());
+        REQUIRE(streaming_tree.pending_bytes() == 0U);
+
+        const auto [actual, ec] = streaming_tree.closest_to(points.front());
+        REQUIRE_FALSE(ec);
+        REQUIRE(actual.has_value());
+        REQUIRE(actual->value == points.front());
+    }
+}
+
+TEST_CASE("StreamingOcTree: I/O errors")
+{
+    const auto directory = std::filesystem::temp_directory_path() / "RaychelCore_StreamingOcTree_errors_test";
+    constexpr std::size_t memory_budget = 1024U;
+
+    Raychel::StreamingOcTree<point, 1> streaming_tree{point{-1, -1, -1}, point{1, 1, 1}, directory, memory_budget};
+    for (std::size_t i{}; i != 100; ++i) {
+        REQUIRE(streaming_tree.insert(point{0.5, 0.5, 0.5}));
+    }
+    REQUIRE(streaming_tree.flush());
+
+    SECTION("Missing chunk files")
+    {
+        std::filesystem::remove_all(directory);
+
+        const auto [closest, ec] = streaming_tree.closest_to(point{0, 0, 0});
+        REQUIRE(ec);
+        REQUIRE_FALSE(closest.has_value());
+        REQUIRE(streaming_tree.k_closest_to(point{0, 0, 0}, 5).ec);
+
+        //The write buffers are full and cannot be written, so nothing more is accepted
+        std::size_t inserted{};
+        for (std::size_t i{}; i != 100; ++i) {
+            inserted += streaming_tree.insert(point{-0.5, -0.5, -0.5}) ? 1U : 0U;
+        }
+        REQUIRE(inserted < 100U);
+        REQUIRE(streaming_tree.size() == 100U + inserted);
+        REQUIRE(streaming_tree.pending_bytes() <= memory_budget / 2U);
+
+        std::filesystem::create_directories(directory);
+    }
+
+    SECTION("Truncated chunk files")
+    {
+        for (const auto& entry : std::filesystem::directory_iterator{directory}) {
+            std::filesystem::resize_file(entry.path(), sizeof(point) * 10U);
+        }
+
+        const auto [items, ec] = streaming_tree.elements_within(point{0, 0, 0}, 2.);
+        REQUIRE(ec == std::errc::io_error);
+        REQUIRE(items.empty());
+    }
+}
+
+TEST_CASE("StreamingOcTree: memory accounting")
+{
+    const auto directory = std::filesystem::temp_directory_path() / "RaychelCore_StreamingOcTree_memory_test";
+    //Large enough for a chunk next to full write buffers
+    constexpr std::size_t memory_budget = 64U * 1024U;
+
+    std::mt19937 rng{24680};
+    std::uniform_real_distribution<double> dist{-100., 100.};
+
+    const auto bytes_before = counted_bytes;
+    {
+        Raychel::StreamingOcTree<
+            point, 2, 10, 20, point, Raychel::details::BoundingBoxFromCoordinate, Raychel::details::GetDistanceToPoint,
+            counting_allocator<point>>
+            streaming_tree{point{-100, -100, -100}, point{100, 100, 100}, directory, memory_budget};
+
+        //The allocator sees everything the tree allocates, so both must agree
+        const auto check_accounting = [&] {
+            REQUIRE(counted_bytes - bytes_before == streaming_tree.loaded_bytes() + streaming_tree.pending_bytes());
+            REQUIRE(counted_bytes - bytes_before <= memory_budget);
+        };
+
+        for (std::size_t i{}; i != 3'000; ++i) {
+            REQUIRE(streaming_tree.insert(point{dist(rng), dist(rng), dist(rng)}));
+            check_accounting();
+        }
+
+        for (std::size_t i{}; i != 100; ++i) {
+            const point where{dist(rng), dist(rng), dist(rng)};
+            REQUIRE_FALSE(streaming_tree.closest_to(where).ec);
+            check_accounting();
+            REQUIRE_FALSE(streaming_tree.k_closest_to(where, 10).ec);
+            check_accounting();
+
+            //Unloads the chunk it lands in
+            REQUIRE(streaming_tree.insert(where));
+            check_accounting();
+        }
+
+        REQUIRE(streaming_tree.flush());
+        check_accounting();
+        REQUIRE(streaming_tree.pending_bytes() == 0U);
+    }
+    REQUIRE(counted_bytes == bytes_before);
+}